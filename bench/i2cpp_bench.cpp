@@ -0,0 +1,357 @@
+/**
+ * @file i2cpp_bench.cpp
+ * @author Scott Fasone
+ *
+ * Microbenchmarks for I2CPP and its devices, run against i2cpp::SimulatedBus so results are reproducible
+ * on any Linux machine. For every operation it reports wall time, transport calls (standing in for
+ * system calls), bus bytes and bus time per operation, and latency percentiles.
+ *
+ * Usage: i2cpp_bench [--iterations N] [--clock HZ] [--realtime] [--filter TEXT] [--json]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/simulated_bus.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** Command line settings */
+    struct Options
+    {
+        std::size_t iterations = 20000;
+        uint32_t clock = 400000;
+        bool realtime = false;
+        bool json = false;
+        std::string filter;
+    };
+
+    /** Measurements of one benchmark */
+    struct Result
+    {
+        std::string name;
+        uint64_t ops;
+        double ns_per_op;
+        double calls_per_op;
+        double address_changes_per_op;
+        double bytes_per_op;
+        double bus_ns_per_op;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+    };
+
+    /** A simulated bus attached as an adapter, with PCA9555 models at 0x20 and up */
+    struct BenchBus
+    {
+        SimulatedBus::SharedPtr bus;
+        std::string name;
+        std::vector<PCA9555::SharedPtr> devices;
+        int adapter;
+    };
+
+    Options options;
+    std::vector<Result> results;
+
+    uint64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    BenchBus make_bus(std::size_t devices)
+    {
+        static int count = 0;
+        BenchBus result;
+        result.bus = std::make_shared<SimulatedBus>();
+        result.bus->set_clock(options.clock, options.realtime);
+        result.name = "i2cpp-bench-" + std::to_string(count++);
+        for(std::size_t i = 0; i < devices; i++) {
+            result.bus->attach(int(0x20 + i), std::make_shared<SimulatedPCA9555>());
+        }
+        result.adapter = I2CPP::attach_adapter(result.name, result.bus);
+        for(std::size_t i = 0; i < devices; i++) {
+            result.devices.push_back(std::make_shared<PCA9555>(result.name, uint_fast8_t(0x20 + i)));
+        }
+        return result;
+    }
+
+    uint64_t percentile(std::vector<uint64_t>& samples, double fraction)
+    {
+        if(samples.empty()) {
+            return 0;
+        }
+        std::size_t index = std::min(samples.size() - 1, std::size_t(fraction * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    void report(const std::string& name, uint64_t ops, uint64_t elapsed, const std::vector<SimulatedBus::SharedPtr>& buses,
+                std::vector<uint64_t>& samples)
+    {
+        SimulatedBus::Statistics total = {};
+        for(const SimulatedBus::SharedPtr& bus : buses)
+        {
+            SimulatedBus::Statistics stats = bus->get_statistics();
+            total.calls += stats.calls;
+            total.address_changes += stats.address_changes;
+            total.bytes += stats.bytes;
+            total.bus_time += stats.bus_time;
+        }
+        Result result;
+        result.name = name;
+        result.ops = ops;
+        result.ns_per_op = double(elapsed) / ops;
+        result.calls_per_op = double(total.calls) / ops;
+        result.address_changes_per_op = double(total.address_changes) / ops;
+        result.bytes_per_op = double(total.bytes) / ops;
+        result.bus_ns_per_op = double(total.bus_time) / ops;
+        result.p50 = percentile(samples, 0.50);
+        result.p99 = percentile(samples, 0.99);
+        result.p999 = percentile(samples, 0.999);
+        results.push_back(result);
+    }
+
+    bool selected(const std::string& name)
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    /** Time op on the calling thread, one latency sample per call */
+    void bench(const std::string& name, const std::vector<SimulatedBus::SharedPtr>& buses, std::function<void()> op)
+    {
+        if(!selected(name)) {
+            return;
+        }
+        for(std::size_t i = 0; i < options.iterations / 10; i++) {
+            op();
+        }
+        for(const SimulatedBus::SharedPtr& bus : buses) {
+            bus->reset_statistics();
+        }
+
+        std::vector<uint64_t> samples(options.iterations);
+        uint64_t start = now_ns();
+        for(std::size_t i = 0; i < options.iterations; i++)
+        {
+            uint64_t before = now_ns();
+            op();
+            samples[i] = now_ns() - before;
+        }
+        uint64_t elapsed = now_ns() - start;
+        report(name, options.iterations, elapsed, buses, samples);
+    }
+
+    /** Time op on several threads at once, op receives the thread's index */
+    void bench_threads(const std::string& name, std::size_t threads, const std::vector<SimulatedBus::SharedPtr>& buses,
+                       std::function<void(std::size_t)> op)
+    {
+        if(!selected(name)) {
+            return;
+        }
+        for(const SimulatedBus::SharedPtr& bus : buses) {
+            bus->reset_statistics();
+        }
+
+        std::vector<std::vector<uint64_t>> samples(threads, std::vector<uint64_t>(options.iterations));
+        std::vector<std::thread> workers;
+        uint64_t start = now_ns();
+        for(std::size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]() {
+                for(std::size_t i = 0; i < options.iterations; i++)
+                {
+                    uint64_t before = now_ns();
+                    op(t);
+                    samples[t][i] = now_ns() - before;
+                }
+            });
+        }
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+        uint64_t elapsed = now_ns() - start;
+
+        std::vector<uint64_t> merged;
+        for(const std::vector<uint64_t>& thread_samples : samples) {
+            merged.insert(merged.end(), thread_samples.begin(), thread_samples.end());
+        }
+        // Wall time per operation across all threads, so scaling shows as a lower ns/op
+        report(name, threads * options.iterations, elapsed, buses, merged);
+    }
+
+    void bench_pca9555(bool shadow)
+    {
+        BenchBus target = make_bus(1);
+        PCA9555& pca = *target.devices[0];
+        pca.write_config(0x00ff);
+        pca.enable_shadow(shadow);
+        std::string prefix = shadow ? "pca9555.shadow." : "pca9555.";
+        std::vector<SimulatedBus::SharedPtr> buses = { target.bus };
+
+        bench(prefix + "read_input", buses, [&]() { pca.read_input(); });
+        bench(prefix + "read_input_pin", buses, [&]() { pca.read_input_pin(3); });
+        bench(prefix + "read_output", buses, [&]() { pca.read_output(); });
+        bench(prefix + "read_output_pin", buses, [&]() { pca.read_output_pin(9); });
+        bench(prefix + "read_polarity", buses, [&]() { pca.read_polarity(); });
+        bench(prefix + "read_polarity_pin", buses, [&]() { pca.read_polarity_pin(3); });
+        bench(prefix + "read_config", buses, [&]() { pca.read_config(); });
+        bench(prefix + "read_config_pin", buses, [&]() { pca.read_config_pin(3); });
+
+        uint_fast16_t value = 0;
+        bench(prefix + "write_output", buses, [&]() { pca.write_output(value++ & 0xff00); });
+        bench(prefix + "write_output_pin", buses, [&]() { pca.write_output_pin(9, (value++ & 1) != 0); });
+        bench(prefix + "write_output_range", buses, [&]() { pca.write_output_range(8, 12, value++ & 0x0f); });
+        bench(prefix + "flip_output_pin", buses, [&]() { pca.flip_output_pin(10); });
+        bench(prefix + "write_polarity", buses, [&]() { pca.write_polarity(value++ & 0x00ff); });
+        bench(prefix + "write_polarity_pin", buses, [&]() { pca.write_polarity_pin(2, (value++ & 1) != 0); });
+        bench(prefix + "write_polarity_range", buses, [&]() { pca.write_polarity_range(0, 4, value++ & 0x0f); });
+        bench(prefix + "flip_polarity_pin", buses, [&]() { pca.flip_polarity_pin(2); });
+        bench(prefix + "write_config", buses, [&]() { pca.write_config(0x00ff); });
+        bench(prefix + "write_config_pin", buses, [&]() { pca.write_config_pin(0, true); });
+        bench(prefix + "write_config_range", buses, [&]() { pca.write_config_range(0, 8, 0xff); });
+        bench(prefix + "flip_config_pin", buses, [&]() { pca.flip_config_pin(7); });
+        bench(prefix + "update_8_pins", buses, [&]() {
+            PCA9555::Update update(pca);
+            for(uint_fast8_t pin = 8; pin < 16; pin++) {
+                pca.flip_output_pin(pin);
+            }
+        });
+    }
+
+    void bench_raw()
+    {
+        BenchBus target = make_bus(2);
+        std::vector<SimulatedBus::SharedPtr> buses = { target.bus };
+        uint_fast8_t buffer[3] = { 0x02, 0x00, 0x00 };
+        uint_fast8_t command = 0x00;
+
+        bench("i2cpp.write_i2c", buses, [&]() { I2CPP::write_i2c(target.adapter, 0x20, buffer, 3); });
+        bench("i2cpp.read_i2c", buses, [&]() { I2CPP::read_i2c(target.adapter, 0x20, buffer, 2); });
+        bench("i2cpp.write_read_i2c", buses, [&]() { I2CPP::write_read_i2c(target.adapter, 0x20, &command, 1, buffer, 2); });
+        int address = 0x20;
+        bench("i2cpp.read_i2c.alternating_address", buses, [&]() {
+            I2CPP::read_i2c(target.adapter, address, buffer, 2);
+            address ^= 0x01;
+        });
+    }
+
+    void bench_round_robin()
+    {
+        const std::size_t count = 8;
+        BenchBus target = make_bus(count);
+        std::vector<SimulatedBus::SharedPtr> buses = { target.bus };
+
+        bench("round_robin.8x_read_input", buses, [&]() {
+            for(const PCA9555::SharedPtr& device : target.devices) {
+                device->read_input();
+            }
+        });
+
+        uint_fast8_t command = 0x00;
+        uint_fast8_t inputs[count][2];
+        std::vector<Message> batch;
+        for(std::size_t i = 0; i < count; i++)
+        {
+            batch.push_back({ uint_fast8_t(0x20 + i), false, &command, 1, 0 });
+            batch.push_back({ uint_fast8_t(0x20 + i), true, inputs[i], 2, 0 });
+        }
+        bench("round_robin.8x_submit_batch", buses, [&]() { I2CPP::submit_batch(target.adapter, batch); });
+    }
+
+    void bench_threads()
+    {
+        const std::size_t threads = 4;
+        std::vector<BenchBus> separate;
+        std::vector<SimulatedBus::SharedPtr> separate_buses;
+        for(std::size_t t = 0; t < threads; t++)
+        {
+            separate.push_back(make_bus(1));
+            separate_buses.push_back(separate.back().bus);
+        }
+        BenchBus shared = make_bus(threads);
+
+        bench_threads("threads.1x_read_input", 1, { separate_buses[0] }, [&](std::size_t) {
+            separate[0].devices[0]->read_input();
+        });
+        bench_threads("threads.4x_read_input.separate_buses", threads, separate_buses, [&](std::size_t t) {
+            separate[t].devices[0]->read_input();
+        });
+        bench_threads("threads.4x_read_input.shared_bus", threads, { shared.bus }, [&](std::size_t t) {
+            shared.devices[t]->read_input();
+        });
+    }
+
+    void print_results()
+    {
+        if(options.json) {
+            std::printf("[\n");
+            for(std::size_t i = 0; i < results.size(); i++)
+            {
+                const Result& r = results[i];
+                std::printf("  {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.1f, \"syscalls_per_op\": %.3f, "
+                            "\"address_changes_per_op\": %.3f, \"bus_bytes_per_op\": %.2f, \"bus_ns_per_op\": %.1f, "
+                            "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu}%s\n",
+                            r.name.c_str(), (unsigned long long)r.ops, r.ns_per_op, r.calls_per_op,
+                            r.address_changes_per_op, r.bytes_per_op, r.bus_ns_per_op,
+                            (unsigned long long)r.p50, (unsigned long long)r.p99, (unsigned long long)r.p999,
+                            i + 1 < results.size() ? "," : "");
+            }
+            std::printf("]\n");
+            return;
+        }
+
+        std::printf("%-42s %10s %9s %9s %9s %11s %9s %9s %9s\n",
+                    "benchmark", "ns/op", "sys/op", "addr/op", "bytes/op", "bus ns/op", "p50", "p99", "p999");
+        for(const Result& r : results)
+        {
+            std::printf("%-42s %10.1f %9.3f %9.3f %9.2f %11.1f %9llu %9llu %9llu\n",
+                        r.name.c_str(), r.ns_per_op, r.calls_per_op, r.address_changes_per_op, r.bytes_per_op,
+                        r.bus_ns_per_op, (unsigned long long)r.p50, (unsigned long long)r.p99, (unsigned long long)r.p999);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::strtoul(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            options.clock = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if(std::strcmp(argv[i], "--realtime") == 0) {
+            options.realtime = true;
+        } else if(std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if(std::strcmp(argv[i], "--json") == 0) {
+            options.json = true;
+        } else {
+            std::fprintf(stderr, "Usage: %s [--iterations N] [--clock HZ] [--realtime] [--filter TEXT] [--json]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(options.iterations == 0) {
+        options.iterations = 1;
+    }
+
+    bench_raw();
+    bench_pca9555(false);
+    bench_pca9555(true);
+    bench_round_robin();
+    bench_threads();
+
+    print_results();
+    return 0;
+}
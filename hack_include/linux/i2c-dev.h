@@ -7,6 +7,26 @@
 #ifndef HACK_I2C_DEV_H
 #define HACK_I2C_DEV_H
 
-#define I2C_SLAVE 0
+#include <cstdint>
 
-#endif
\ No newline at end of file
+#define I2C_SLAVE 0x0703
+#define I2C_FUNCS 0x0705
+#define I2C_RDWR 0x0707
+#define I2C_PEC 0x0708
+#define I2C_SMBUS 0x0720
+
+struct i2c_rdwr_ioctl_data {
+    struct i2c_msg *msgs;
+    uint32_t nmsgs;
+};
+
+#define I2C_RDWR_IOCTL_MAX_MSGS 42
+
+struct i2c_smbus_ioctl_data {
+    uint8_t read_write;
+    uint8_t command;
+    uint32_t size;
+    union i2c_smbus_data *data;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file ads1115_sampler.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_ADS1115_SAMPLER_HPP
+#define I2CPP_ADS1115_SAMPLER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "i2cpp/devices/ads1115.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Overlapped round-robin scanning of several ADS1115s on one adapter.
+     * Scanning chip by chip leaves the bus idle for every conversion in turn. Instead, a scan runs in passes:
+     * each pass reads every chip's previous result and starts its next single-shot conversion, all in one
+     * i2cpp::I2CPP::submit_batch() call, then waits a single conversion period while every chip converts
+     * at once. A scan of N chips with C channels each costs C + 1 batches and C conversion periods,
+     * instead of N * C of each.
+     *
+     * Each chip's gain and data rate come from its cached configuration, so set them on the ADS1115 objects
+     * first. Waits allow for the datasheet's 10% oscillator tolerance on the slowest chip's data rate.
+     * @note The chips must not be used elsewhere, or streamed, while a scan is running
+     */
+    class ADS1115Sampler
+    {
+        public:
+            /** @brief One conversion result from a scan */
+            struct Reading
+            {
+                /** Index of the chip, in the order added */
+                std::size_t device;
+                /** Index of the channel in the chip's channel list */
+                std::size_t channel;
+                /** Inputs measured */
+                ADS1115::Mux mux;
+                /** Raw conversion result */
+                int_fast16_t value;
+                /** False if starting the conversion or reading its result failed */
+                bool valid;
+            };
+
+            ADS1115Sampler();
+            ADS1115Sampler(ADS1115Sampler const&) = delete;
+            void operator=(ADS1115Sampler const&) = delete;
+
+            /**
+             * Add a chip to the scan.
+             * @param device The chip, on the same adapter as every other chip added
+             * @param channels Inputs to measure on each scan, in order
+             * @returns True if added, false if the chip is on a different adapter
+             */
+            bool add(ADS1115::SharedPtr device, const std::vector<ADS1115::Mux>& channels);
+            /**
+             * Get the File Descriptor of the adapter being scanned.
+             * @returns Adapter File Descriptor, -1 before the first chip is added
+             */
+            int get_adapter() const;
+
+            /**
+             * Measure every channel of every chip once.
+             * @param[in] readings Receives one reading per channel, grouped by chip in the order added.
+             *                     Reusing the vector across scans avoids reallocating it
+             * @returns True if every reading is valid, false otherwise
+             */
+            bool scan(std::vector<Reading>& readings);
+
+        private:
+            /** A chip, its channel list and the buffers of its in-flight messages */
+            struct Entry
+            {
+                ADS1115::SharedPtr device;
+                std::vector<ADS1115::Mux> channels;
+                /** Index of the chip's first reading */
+                std::size_t offset;
+                /** Conversion register pointer, written before each result read */
+                uint_fast8_t pointer;
+                uint_fast8_t result[2];
+                /** Configuration write starting the next conversion */
+                uint_fast8_t command[3];
+                /** Configuration being written by command */
+                ADS1115::Config config;
+                /** Index of this pass's result read in messages, or std::size_t(-1) if none */
+                std::size_t read_index;
+                /** Index of this pass's configuration write in messages, or std::size_t(-1) if none */
+                std::size_t start_index;
+                /** Whether the conversion being read was started successfully */
+                bool started;
+            };
+
+            int adapter;
+            std::size_t total;
+            std::vector<Entry> entries;
+            /** Messages of the current pass, reused between passes */
+            std::vector<Message> messages;
+    };
+}
+
+#endif //I2CPP_ADS1115_SAMPLER_HPP
@@ -0,0 +1,149 @@
+/**
+ * @file arbiter.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_ARBITER_HPP
+#define I2CPP_ARBITER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "i2cpp/statistics.hpp"
+
+namespace i2cpp
+{
+    /** @brief Priority classes for access to an adapter, most urgent first */
+    enum class BusPriority
+    {
+        /** Safety-relevant transactions, such as de-energizing a relay */
+        URGENT,
+        /** Ordinary device control, the default */
+        CONTROL,
+        /** Background polling and bulk reads */
+        BULK
+    };
+    /** Number of BusPriority classes */
+    static constexpr std::size_t bus_priorities = 3;
+
+    /**
+     * @brief Sets the BusPriority of the calling thread's transactions for its lifetime.
+     * Every i2cpp::I2CPP transaction the thread starts while the scope is alive, including those of
+     * device methods, competes for its adapter in the given class. Scopes nest, restoring the previous
+     * class when they end. Jobs posted to an i2cpp::Executor run in the class they were posted from.
+     *
+     * @code
+     * {
+     *     PriorityScope urgent(BusPriority::URGENT);
+     *     relays.write_output(0x0000);
+     * }
+     * @endcode
+     */
+    class PriorityScope
+    {
+        public:
+            /**
+             * Enter a priority class.
+             * @param priority Class for the calling thread's transactions
+             */
+            explicit PriorityScope(BusPriority priority);
+            /** Restore the class in effect before this scope. */
+            ~PriorityScope();
+            PriorityScope(PriorityScope const&) = delete;
+            void operator=(PriorityScope const&) = delete;
+
+            /**
+             * Get the calling thread's priority class.
+             * @returns Class of the innermost live scope, BusPriority::CONTROL outside any scope
+             */
+            static BusPriority current();
+
+        private:
+            BusPriority previous;
+    };
+
+    /** @brief Snapshot of how one priority class waited for an adapter */
+    struct ArbitrationStatistics
+    {
+        BusPriority priority;
+        /** Times the class was granted the adapter */
+        uint64_t grants;
+        /** Grants which had to wait for another transaction */
+        uint64_t contended;
+        /** Grants given to this class ahead of a more urgent waiting class, to keep it from starving */
+        uint64_t starvation_grants;
+        /** Longest wait in nanoseconds */
+        uint64_t max_wait;
+        /** Time spent waiting for the adapter, of every grant */
+        LatencyHistogram wait;
+    };
+
+    /**
+     * @brief Priority lock serializing the transactions of one adapter.
+     * A drop-in replacement for the adapter's mutex. Uncontended, it costs one mutex round trip. When
+     * it is released with threads waiting, it is handed straight to a waiter of the most urgent class,
+     * so queued urgent work goes next at the following transaction boundary, ahead of any bulk work.
+     * Within a class, waiters are served in arrival order.
+     * A class passed over starvation_limit times in a row while waiting is served next regardless,
+     * which bounds the wait of every class under full load.
+     * Classes are taken from the calling thread's PriorityScope.
+     */
+    class Arbiter
+    {
+        public:
+            /** Consecutive grants a waiting class can be passed over before it is served anyway */
+            static const unsigned starvation_limit = 8;
+
+            Arbiter();
+            Arbiter(Arbiter const&) = delete;
+            void operator=(Arbiter const&) = delete;
+
+            /** Wait for the adapter in the calling thread's priority class. */
+            void lock();
+            /**
+             * Take the adapter only if it is free.
+             * @returns True if taken, false otherwise
+             */
+            bool try_lock();
+            /** Release the adapter, handing it to the most deserving waiter. */
+            void unlock();
+
+            /**
+             * Take a snapshot of the wait-time metrics.
+             * @param[in] statistics Array of bus_priorities entries to fill, indexed by BusPriority
+             */
+            void snapshot(ArbitrationStatistics* statistics);
+            /** Reset the wait-time metrics to zero. */
+            void reset();
+
+        private:
+            /** A thread blocked in lock(), living on its stack */
+            struct Waiter
+            {
+                std::condition_variable ready;
+                /** Set when the adapter is handed to this thread */
+                bool granted;
+            };
+            /** Waiters and live metrics of one class, guarded by mutex */
+            struct Class
+            {
+                /** Threads waiting in this class, in arrival order */
+                std::deque<Waiter*> waiting;
+                /** Grants to other classes while this class was waiting */
+                unsigned passed;
+                ArbitrationStatistics statistics;
+            };
+
+            void record(Class& waiter, uint64_t wait);
+
+            std::mutex mutex;
+            /** True while a thread holds the adapter, or it has been handed to a waiter */
+            bool busy;
+            Class classes[bus_priorities];
+    };
+}
+
+#endif //I2CPP_ARBITER_HPP
@@ -0,0 +1,234 @@
+/**
+ * @file broker.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_BROKER_HPP
+#define I2CPP_BROKER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "i2cpp/transport.hpp"
+
+namespace i2cpp
+{
+    namespace detail
+    {
+        /** Shared memory segment of a broker, defined in broker.cpp */
+        struct BrokerSegment;
+    }
+
+    /** @brief Counters of a Broker */
+    struct BrokerStatistics
+    {
+        /** Requests served, from every client */
+        uint64_t requests;
+        /** Calls made to the adapter's transport, each one standing in for a system call */
+        uint64_t calls;
+        /** Transfer requests sent packed together with others in a single call */
+        uint64_t batched;
+        /** Slots released after their client process exited */
+        uint64_t reaped;
+    };
+
+    /**
+     * @brief Daemon side of an I2C adapter shared by several processes.
+     * Each process using i2cpp has its own I2CPP singleton, which assumes it owns the adapter's
+     * I2C_SLAVE setting. Processes opening the same device file therefore select each other's devices
+     * in between calls. A broker instead owns the adapter alone: clients in other processes attach a
+     * BrokerTransport in its place, and submit their transactions to the broker through a shared
+     * memory segment. Only the broker touches the device file, so every client keeps the correct
+     * address, and i2cpp::Device code runs unchanged across processes.
+     *
+     * Requests are queued in a ring of slots in the segment, with futex wakeups in both directions,
+     * which are skipped while the other side is known to be awake. Every request waiting when the
+     * broker wakes is served in one pass, in submission order, and consecutive transfers from
+     * different clients are packed into one call of the transport, like I2CPP::submit_batch().
+     * If a packed call fails, each of its transfers is retried alone, so a failing device only fails
+     * its own client. Transfers packed ahead of the failing one may then be performed twice, including
+     * other processes' writes, without their clients being told: packed transfers are performed at
+     * least once, not exactly once.
+     *
+     * @code
+     * i2cpp::Broker broker("/dev/i2c-1");
+     * broker.run();
+     * @endcode
+     * @note The broker's own process should also use the adapter through a BrokerTransport, not by opening it
+     */
+    class Broker
+    {
+        public:
+            /**
+             * Create the shared memory segment for an adapter, served by an i2c-dev device file.
+             * @param filename Path to I2C device file, also the name clients connect to
+             */
+            explicit Broker(const std::string& filename);
+            /**
+             * Create the shared memory segment for an adapter, served by any Transport.
+             * A stale segment left by a broker which did not exit cleanly is replaced.
+             * @param filename Name clients connect to
+             * @param transport Backend carrying the adapter's transactions
+             */
+            Broker(const std::string& filename, Transport::SharedPtr transport);
+            /** Stops serving, disconnects every client and removes the segment. */
+            ~Broker();
+            Broker(Broker const&) = delete;
+            void operator=(Broker const&) = delete;
+
+            /** @returns True if the segment was created and the adapter's transport opened */
+            bool is_open() const;
+            /**
+             * Serve requests on the calling thread until stop() is called.
+             * @returns False if the broker is not open, true once stopped
+             */
+            bool run();
+            /**
+             * Serve requests on a dedicated thread.
+             * @returns True if the thread was started, false if it was already running or the broker is not open
+             */
+            bool start();
+            /** Stop serving, waiting for a thread started by start() to exit. */
+            void stop();
+            /**
+             * Serve every request already waiting, without blocking.
+             * For applications running their own loop instead of calling run().
+             * @returns Number of requests served
+             */
+            std::size_t poll();
+
+            /**
+             * Get the broker's counters.
+             * @returns Snapshot of the counters
+             */
+            BrokerStatistics get_statistics() const;
+
+            /**
+             * Get the name of the shared memory segment for an adapter.
+             * @param filename Path to I2C device file
+             * @returns Name for shm_open(), such as "/i2cpp.dev.i2c-1" for "/dev/i2c-1"
+             */
+            static std::string segment_name(const std::string& filename);
+
+        private:
+            /** A request taken from the ring */
+            struct Pending
+            {
+                uint32_t slot;
+                uint64_t ticket;
+                /** Position of a transfer's messages in messages, once copied out of the slot and checked */
+                std::size_t first;
+                /** Number of messages of a transfer */
+                uint32_t count;
+            };
+
+            bool stage(Pending& request);
+            bool select(int address);
+            void execute(uint32_t slot);
+            void transfer(const std::vector<Pending>& run);
+            void complete(uint32_t slot, int64_t result, int error);
+            void reap();
+
+            std::string name;
+            Transport::SharedPtr transport;
+            detail::BrokerSegment* segment;
+            /** Address last selected on the transport, -1 if unknown */
+            int address;
+            /** PEC setting last applied to the transport */
+            bool pec;
+            std::vector<Pending> pending;
+            /** Messages of the transfers taken by one poll(), with buffers pointing into their slots */
+            std::vector<Message> messages;
+
+            std::atomic<bool> stopping;
+            std::thread thread;
+
+            std::atomic<uint64_t> requests;
+            std::atomic<uint64_t> calls;
+            std::atomic<uint64_t> batched;
+            std::atomic<uint64_t> reaped;
+    };
+
+    /**
+     * @brief Client side of an adapter owned by a Broker in another process.
+     * Every call is submitted to the broker through its shared memory segment and waited for, so the
+     * transport behaves like the adapter itself. set_address() only records the address, which is
+     * sent along with each read() and write(), so clients never disturb each other's selected device.
+     * Requests fail with ENOTCONN while no broker runs, including one killed without cleaning up, and
+     * the next call after a broker is restarted connects to the new one.
+     *
+     * @code
+     * i2cpp::BrokerTransport::attach("/dev/i2c-1");
+     * i2cpp::PCA9555 relays(1, 0x20); // Served by the broker
+     * @endcode
+     * @note Read caches and device shadows of each process only see their own writes, so devices written by
+     *       several processes should not enable the read cache
+     * @note A transfer() may be performed twice when the broker packed it with another client's failing
+     *       transfer, so transfers sent through a broker should be safe to repeat, like register writes
+     *       of a whole value, rather than FIFO pushes or toggles. read(), write() and smbus() are never packed
+     */
+    class BrokerTransport : public Transport
+    {
+        public:
+            /** Convenience name to get a Shared Pointer */
+            using SharedPtr = std::shared_ptr<BrokerTransport>;
+
+            /**
+             * Connect to the broker of an adapter.
+             * @param filename Path to I2C device file served by the broker
+             * @param timeout Longest wait for a request in milliseconds, 0 to wait as long as the broker runs
+             */
+            explicit BrokerTransport(const std::string& filename, uint32_t timeout = 1000);
+            /** Disconnects from the broker. */
+            ~BrokerTransport();
+            BrokerTransport(BrokerTransport const&) = delete;
+            void operator=(BrokerTransport const&) = delete;
+
+            /**
+             * Connect to the broker of an adapter and register it under the adapter's filename.
+             * Devices constructed by that filename, or the matching bus number, are then served by the broker.
+             * @see I2CPP::attach_adapter()
+             *
+             * @param filename Path to I2C device file served by the broker
+             * @param timeout Longest wait for a request in milliseconds, 0 to wait as long as the broker runs
+             * @returns Handle for the adapter, or -1 if no broker serves it or the name is already open
+             */
+            static int attach(const std::string& filename, uint32_t timeout = 1000);
+
+            /** @returns True if connected to a running broker */
+            bool is_connected() const;
+
+            int get_handle() const override;
+            int set_address(int address) override;
+            ssize_t read(uint_fast8_t* buffer, std::size_t length) override;
+            ssize_t write(const uint_fast8_t* buffer, std::size_t length) override;
+            int transfer(Message* messages, std::size_t count) override;
+            unsigned long get_functionality() override;
+            int set_pec(bool enable) override;
+            ssize_t smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length) override;
+
+        private:
+            bool connect();
+            void disconnect();
+            int claim();
+            bool submit(uint32_t slot);
+            void release(uint32_t slot);
+
+            std::string name;
+            uint32_t timeout;
+            /** eventfd standing in as the adapter's handle, which stays the same across reconnections */
+            int handle;
+            detail::BrokerSegment* segment;
+            /** Process ID recorded as the owner of claimed slots */
+            int32_t pid;
+            /** Address selected with set_address() */
+            int address;
+            bool pec;
+    };
+}
+
+#endif //I2CPP_BROKER_HPP
@@ -0,0 +1,170 @@
+/**
+ * @file bus_group.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_BUS_GROUP_HPP
+#define I2CPP_BUS_GROUP_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "i2cpp/device.hpp"
+#include "i2cpp/register_map.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+#include "i2cpp/devices/ads1115.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Coherent snapshot of registers spread over several adapters.
+     * Reading device by device on one thread makes a snapshot take as long as every bus put together.
+     * A BusGroup instead reads each adapter's registers on that adapter's i2cpp::Executor thread, all
+     * adapters at once, so a snapshot takes as long as its slowest bus.
+     * On adapters capable of plain I2C, one adapter's registers are read with a single
+     * i2cpp::I2CPP::submit_batch() call; other adapters read each register through
+     * i2cpp::I2CPP::read_register().
+     *
+     * Results land in a Frame allocated once up front and reused for every capture(), with a value and
+     * valid flag per register and a timestamp and error count per adapter.
+     * @note capture() waits on Executor threads, so it must not be called from one
+     */
+    class BusGroup
+    {
+        public:
+            /** @brief Results of one capture() */
+            struct Frame
+            {
+                /** @brief Timing and errors of one adapter within a frame */
+                struct Bus
+                {
+                    /** File Descriptor of the adapter */
+                    int adapter;
+                    /** CLOCK_MONOTONIC time the adapter's reads began, in nanoseconds */
+                    int64_t started;
+                    /** CLOCK_MONOTONIC time the adapter's reads finished, in nanoseconds */
+                    int64_t finished;
+                    /** Number of registers on the adapter which could not be read */
+                    std::size_t errors;
+                };
+
+                /** Number of capture() calls which filled this frame */
+                uint64_t sequence;
+                /** Decoded register values, indexed by the channel numbers returned by add() */
+                std::vector<uint_fast32_t> values;
+                /** Nonzero for each value read successfully in this frame */
+                std::vector<uint8_t> valid;
+                /** One entry per adapter, in the order each adapter was first added */
+                std::vector<Bus> buses;
+            };
+
+            BusGroup();
+            BusGroup(BusGroup const&) = delete;
+            void operator=(BusGroup const&) = delete;
+
+            /**
+             * Add a register to the snapshot.
+             * @param adapter File Descriptor of the register's I2C Adapter
+             * @param address Address of the I2C device on the bus
+             * @param command Register address
+             * @param width Register size in bytes, 1 to 4
+             * @param endian Byte order of the register on the bus
+             * @returns Channel number of the register's value in each Frame
+             */
+            std::size_t add(int adapter, int address, uint_fast8_t command, std::size_t width, Endian endian);
+            /**
+             * Add a register described by an i2cpp::Register to the snapshot.
+             * @param device Device holding the register
+             * @returns Channel number of the register's value in each Frame
+             */
+            template<typename Reg>
+            std::size_t add(const Device& device)
+            {
+                static_assert(Reg::readable, "Register is write-only");
+                return this->add(device.get_adapter(), device.get_address(), Reg::address, Reg::width, Reg::endian);
+            }
+            /**
+             * Add a PCA9555's input port to the snapshot.
+             * @param device The I/O expander
+             * @returns Channel number of the 16-bit input port value in each Frame
+             */
+            std::size_t add(const PCA9555& device);
+            /**
+             * Add an ADS1115's latest conversion result to the snapshot.
+             * The result is the raw register value; convert it with int16_t and ADS1115::to_volts().
+             * @note Streaming ADS1115s should be read with ADS1115::read_samples() instead
+             * @param device The converter, typically in continuous conversion mode
+             * @returns Channel number of the conversion register value in each Frame
+             */
+            std::size_t add(const ADS1115& device);
+
+            /** @returns Number of registers in the snapshot */
+            std::size_t size() const;
+            /**
+             * Allocate a frame sized for this group, so capture() never allocates.
+             * @returns An empty frame
+             */
+            Frame make_frame() const;
+            /**
+             * Read every register, reading all adapters in parallel, and wait for the results.
+             * @param[in] frame Receives the results, resized first if it does not fit this group
+             * @returns True if every register was read, false otherwise
+             */
+            bool capture(Frame& frame);
+
+        private:
+            /** A register to read, and space for its bytes */
+            struct Channel
+            {
+                int address;
+                uint_fast8_t command;
+                std::size_t width;
+                Endian endian;
+                /** Index of the value in each Frame */
+                std::size_t index;
+                uint_fast8_t buffer[4];
+                /** Decoded value, staged until every adapter is done */
+                uint_fast32_t value;
+                bool valid;
+            };
+            /** Assumed size of a cache line */
+            static const std::size_t cache_line = 64;
+            /**
+             * An adapter's registers, the messages reused to batch them and its staged results.
+             * Padded at both ends, so its fields never share a cache line with another allocation. Its
+             * vectors' storage is allocated per adapter too, so adapters can at most meet at the edges of
+             * those allocations.
+             */
+            struct Bus
+            {
+                char front[cache_line];
+                int adapter;
+                std::vector<Channel> channels;
+                std::vector<Message> messages;
+                /** Channel of each pair of messages */
+                std::vector<Channel*> batched;
+                /** Timing and errors of the latest capture, staged until every adapter is done */
+                Frame::Bus times;
+                char back[cache_line];
+            };
+
+            void read_bus(Bus& bus);
+
+            /**
+             * Adapter threads only write their own Bus, each allocated separately, and capture() copies
+             * the results into the frame once they are all done, so the frame is written by one thread only
+             */
+            std::vector<std::unique_ptr<Bus>> buses;
+            std::size_t total;
+            std::mutex mutex;
+            std::condition_variable done;
+            /** Adapters still reading during capture() */
+            std::size_t remaining;
+    };
+}
+
+#endif //I2CPP_BUS_GROUP_HPP
@@ -0,0 +1,162 @@
+/**
+ * @file device.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_CORO_DEVICE_HPP
+#define I2CPP_CORO_DEVICE_HPP
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "i2cpp/executor.hpp"
+#include "i2cpp/coro/scheduler.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+#include "i2cpp/devices/ads1115.hpp"
+
+namespace i2cpp
+{
+    namespace coro
+    {
+        /**
+         * @brief Awaitable running a blocking bus operation on an adapter's I/O thread.
+         * The awaiting task is suspended, the operation runs on the adapter's i2cpp::Executor thread,
+         * and the task is then resumed by its Scheduler with the operation's result. Operations of
+         * every task on one adapter are serialized there, while different adapters run in parallel.
+         * A task awaiting outside a Scheduler's worker threads, such as one started directly by the
+         * caller, is resumed on the Executor thread instead.
+         */
+        template<typename Result>
+        class BusOperation
+        {
+            static_assert(!std::is_void<Result>::value, "Bus operations must return a value");
+
+            public:
+                BusOperation(int adapter, std::function<Result()> operation) : adapter(adapter), operation(std::move(operation)) {  }
+
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> handle)
+                {
+                    Scheduler* scheduler = Scheduler::current();
+                    Executor::post(this->adapter, [this, handle, scheduler]() {
+                        try {
+                            this->result.emplace(this->operation());
+                        } catch(...) {
+                            this->exception = std::current_exception();
+                        }
+                        if(scheduler != nullptr) {
+                            scheduler->schedule(handle);
+                        } else {
+                            handle.resume();
+                        }
+                    });
+                }
+                Result await_resume()
+                {
+                    if(this->exception) {
+                        std::rethrow_exception(this->exception);
+                    }
+                    return std::move(*this->result);
+                }
+
+            private:
+                int adapter;
+                std::function<Result()> operation;
+                std::optional<Result> result;
+                std::exception_ptr exception;
+        };
+
+        /**
+         * Run any blocking call on an adapter's I/O thread.
+         * @param adapter File Descriptor of the I2C adapter the call uses
+         * @param operation The call, returning a value
+         * @returns Awaitable yielding the call's result
+         */
+        template<typename F>
+        auto on_adapter(int adapter, F operation) -> BusOperation<std::invoke_result_t<F>>
+        {
+            return BusOperation<std::invoke_result_t<F>>(adapter, std::move(operation));
+        }
+
+        /**
+         * @brief Awaitable wrapper of a blocking i2cpp::Device.
+         * Copies share the device, which stays alive while any operation on it is in flight.
+         */
+        template<typename D>
+        class AsyncDevice
+        {
+            public:
+                explicit AsyncDevice(std::shared_ptr<D> device) : device(std::move(device)) {  }
+
+                /**
+                 * Run any blocking call of the device on its adapter's I/O thread.
+                 * @code
+                 * bool high = co_await pca.run([](PCA9555& device) { return device.read_input_pin(3); });
+                 * @endcode
+                 * @param operation Callable taking the device
+                 * @returns Awaitable yielding the call's result
+                 */
+                template<typename F>
+                auto run(F operation)
+                {
+                    std::shared_ptr<D> device = this->device;
+                    return on_adapter(device->get_adapter(), [device, operation]() { return operation(*device); });
+                }
+                /** @returns The wrapped device */
+                D& get() const { return *this->device; }
+
+            protected:
+                std::shared_ptr<D> device;
+        };
+
+        /** @brief Awaitable i2cpp::PCA9555 */
+        class AsyncPCA9555 : public AsyncDevice<PCA9555>
+        {
+            public:
+                explicit AsyncPCA9555(PCA9555::SharedPtr device) : AsyncDevice<PCA9555>(std::move(device)) {  }
+
+                /** @see PCA9555::read_input() */
+                BusOperation<uint_fast16_t> read_input() { return this->run([](PCA9555& device) { return device.read_input(); }); }
+                /** @see PCA9555::read_input_pin() */
+                BusOperation<bool> read_input_pin(uint_fast8_t pin) { return this->run([pin](PCA9555& device) { return device.read_input_pin(pin); }); }
+                /** @see PCA9555::read_output() */
+                BusOperation<uint_fast16_t> read_output() { return this->run([](PCA9555& device) { return device.read_output(); }); }
+                /** @see PCA9555::write_output() */
+                BusOperation<bool> write_output(uint_fast16_t data) { return this->run([data](PCA9555& device) { return device.write_output(data); }); }
+                /** @see PCA9555::write_output_pin() */
+                BusOperation<bool> write_output_pin(uint_fast8_t pin, bool value) { return this->run([pin, value](PCA9555& device) { return device.write_output_pin(pin, value); }); }
+                /** @see PCA9555::write_polarity() */
+                BusOperation<bool> write_polarity(uint_fast16_t data) { return this->run([data](PCA9555& device) { return device.write_polarity(data); }); }
+                /** @see PCA9555::write_config() */
+                BusOperation<bool> write_config(uint_fast16_t data) { return this->run([data](PCA9555& device) { return device.write_config(data); }); }
+        };
+
+        /** @brief Awaitable i2cpp::ADS1115 */
+        class AsyncADS1115 : public AsyncDevice<ADS1115>
+        {
+            public:
+                explicit AsyncADS1115(ADS1115::SharedPtr device) : AsyncDevice<ADS1115>(std::move(device)) {  }
+
+                /** @see ADS1115::read_conversion() */
+                BusOperation<int_fast16_t> read_conversion() { return this->run([](ADS1115& device) { return device.read_conversion(); }); }
+                /**
+                 * Start a single-shot conversion and read it.
+                 * The adapter's I/O thread is held for the conversion time, use start_conversion(),
+                 * sleep_for() and read_conversion() to leave the bus free meanwhile.
+                 * @see ADS1115::read_single()
+                 */
+                BusOperation<int_fast16_t> read_single(ADS1115::Mux mux) { return this->run([mux](ADS1115& device) { return device.read_single(mux); }); }
+                /** @see ADS1115::start_conversion() */
+                BusOperation<bool> start_conversion() { return this->run([](ADS1115& device) { return device.start_conversion(); }); }
+                /** @see ADS1115::is_converting() */
+                BusOperation<bool> is_converting() { return this->run([](ADS1115& device) { return device.is_converting(); }); }
+        };
+    }
+}
+
+#endif //I2CPP_CORO_DEVICE_HPP
@@ -0,0 +1,189 @@
+/**
+ * @file scheduler.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_CORO_SCHEDULER_HPP
+#define I2CPP_CORO_SCHEDULER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "i2cpp/coro/task.hpp"
+
+namespace i2cpp
+{
+    namespace coro
+    {
+        /** Clock of every coroutine sleep */
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Event loop running coroutine tasks on a small fixed pool of threads.
+         * Tasks are stackless coroutines, so thousands of them cost only their coroutine frames. A task
+         * suspended on the bus or a sleep holds no thread: bus operations run on the adapter's
+         * i2cpp::Executor thread, and sleeps wait in a timer queue, after which the task is resumed by
+         * whichever worker is free.
+         *
+         * @code
+         * coro::Scheduler scheduler(2);
+         * scheduler.spawn(blink(coro::AsyncPCA9555(relays)));
+         * scheduler.wait();
+         * @endcode
+         * @note A task may resume on a different worker after each co_await, so it should not hold
+         * thread-bound state, such as a locked mutex or an i2cpp::PriorityScope, across one
+         */
+        class Scheduler
+        {
+            public:
+                /**
+                 * Start the worker threads.
+                 * @param threads Number of worker threads, at least 1
+                 */
+                explicit Scheduler(std::size_t threads = 1);
+                /** Wait for every spawned task to finish, then stop the worker threads. */
+                ~Scheduler();
+                Scheduler(Scheduler const&) = delete;
+                void operator=(Scheduler const&) = delete;
+
+                /**
+                 * Start a top-level task.
+                 * The scheduler owns the task until it finishes. Exceptions escaping it are discarded.
+                 * @param task The task
+                 */
+                void spawn(Task<void> task);
+                /** Block until every spawned task has finished. Must not be called from a task. */
+                void wait();
+                /** @returns Number of spawned tasks which have not finished */
+                std::size_t active();
+
+                /**
+                 * Queue a suspended coroutine to be resumed by a worker.
+                 * @param handle The coroutine
+                 */
+                void schedule(std::coroutine_handle<> handle);
+                /**
+                 * Resume a suspended coroutine once a time has passed.
+                 * @param deadline Time to resume at
+                 * @param handle The coroutine
+                 */
+                void schedule_at(Clock::time_point deadline, std::coroutine_handle<> handle);
+                /**
+                 * Get the scheduler running the calling thread.
+                 * @returns The scheduler, nullptr outside a worker thread
+                 */
+                static Scheduler* current();
+
+            private:
+                /** Coroutine waiting for its deadline */
+                struct Timer
+                {
+                    Clock::time_point deadline;
+                    /** Order of scheduling, so timers with equal deadlines resume in order */
+                    uint64_t sequence;
+                    std::coroutine_handle<> handle;
+
+                    bool operator>(const Timer& other) const
+                    {
+                        return this->deadline != other.deadline ? this->deadline > other.deadline : this->sequence > other.sequence;
+                    }
+                };
+
+                /** Self-destroying coroutine owning a spawned task */
+                struct Detached
+                {
+                    struct promise_type
+                    {
+                        Detached get_return_object() noexcept { return Detached{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+                        std::suspend_always initial_suspend() noexcept { return {}; }
+                        std::suspend_never final_suspend() noexcept { return {}; }
+                        void return_void() noexcept {  }
+                        void unhandled_exception() noexcept {  }
+                    };
+                    std::coroutine_handle<promise_type> handle;
+                };
+
+                static Detached launch(Scheduler* scheduler, Task<void> task);
+                void finished();
+                void run();
+
+                std::mutex mutex;
+                /** Signalled when a coroutine is queued, a timer moves earlier or the scheduler stops */
+                std::condition_variable ready;
+                /** Signalled when the last task finishes */
+                std::condition_variable idle;
+                std::deque<std::coroutine_handle<>> queue;
+                std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+                uint64_t sequence;
+                std::size_t tasks;
+                bool stopping;
+                std::vector<std::thread> workers;
+        };
+
+        /**
+         * Suspend the calling task until a time.
+         * Outside a Scheduler's worker threads, such as in a task resumed on an Executor thread, the
+         * thread itself sleeps and the task continues on it.
+         * @param deadline Time to resume at
+         */
+        inline auto sleep_until(Clock::time_point deadline)
+        {
+            struct Awaiter
+            {
+                Clock::time_point deadline;
+                bool await_ready() const { return Clock::now() >= this->deadline; }
+                bool await_suspend(std::coroutine_handle<> handle)
+                {
+                    Scheduler* scheduler = Scheduler::current();
+                    if(scheduler == nullptr)
+                    {
+                        std::this_thread::sleep_until(this->deadline);
+                        return false;
+                    }
+                    scheduler->schedule_at(this->deadline, handle);
+                    return true;
+                }
+                void await_resume() const noexcept {  }
+            };
+            return Awaiter{ deadline };
+        }
+        /**
+         * Suspend the calling task for a while.
+         * @param duration How long to sleep
+         */
+        template<typename Rep, typename Period>
+        auto sleep_for(std::chrono::duration<Rep, Period> duration)
+        {
+            return sleep_until(Clock::now() + std::chrono::duration_cast<Clock::duration>(duration));
+        }
+        /** Requeue the calling task behind every other ready task, or continue at once outside a Scheduler's worker threads. */
+        inline auto yield()
+        {
+            struct Awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                bool await_suspend(std::coroutine_handle<> handle)
+                {
+                    Scheduler* scheduler = Scheduler::current();
+                    if(scheduler == nullptr) {
+                        return false;
+                    }
+                    scheduler->schedule(handle);
+                    return true;
+                }
+                void await_resume() const noexcept {  }
+            };
+            return Awaiter{};
+        }
+    }
+}
+
+#endif //I2CPP_CORO_SCHEDULER_HPP
@@ -0,0 +1,153 @@
+/**
+ * @file task.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_CORO_TASK_HPP
+#define I2CPP_CORO_TASK_HPP
+
+#if !defined(__cpp_impl_coroutine)
+#error "i2cpp/coro requires C++20 coroutines; link against the i2cpp_coro target (-DI2CPP_COROUTINES=ON)"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace i2cpp
+{
+    /**
+     * @brief C++20 coroutine API, built as the separate i2cpp_coro library.
+     * The core library stays C++11; configure with -DI2CPP_COROUTINES=ON to build this one.
+     */
+    namespace coro
+    {
+        template<typename T = void>
+        class Task;
+
+        namespace detail
+        {
+            /** Promise state shared by every Task */
+            struct PromiseBase
+            {
+                /** Resumes whoever awaited the task once it finishes */
+                struct FinalAwaiter
+                {
+                    bool await_ready() noexcept { return false; }
+                    template<typename Promise>
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                    {
+                        std::coroutine_handle<> continuation = handle.promise().continuation;
+                        return continuation ? continuation : std::noop_coroutine();
+                    }
+                    void await_resume() noexcept {  }
+                };
+
+                /** Coroutine awaiting this one */
+                std::coroutine_handle<> continuation;
+                std::exception_ptr exception;
+
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                FinalAwaiter final_suspend() noexcept { return {}; }
+                void unhandled_exception() { this->exception = std::current_exception(); }
+            };
+
+            template<typename T>
+            struct Promise : PromiseBase
+            {
+                std::optional<T> value;
+
+                Task<T> get_return_object();
+                template<typename U>
+                void return_value(U&& value) { this->value.emplace(std::forward<U>(value)); }
+                T result()
+                {
+                    if(this->exception) {
+                        std::rethrow_exception(this->exception);
+                    }
+                    return std::move(*this->value);
+                }
+            };
+            template<>
+            struct Promise<void> : PromiseBase
+            {
+                Task<void> get_return_object();
+                void return_void() {  }
+                void result()
+                {
+                    if(this->exception) {
+                        std::rethrow_exception(this->exception);
+                    }
+                }
+            };
+        }
+
+        /**
+         * @brief Lazily started coroutine producing a T.
+         * A Task does nothing until it is awaited with co_await, which runs it to completion and yields
+         * its result, or rethrows its exception. Awaiting resumes the awaiter directly when the task
+         * finishes, without going through a scheduler. Top-level tasks are started with Scheduler::spawn().
+         * Tasks are move-only, and destroy their coroutine frame when destroyed.
+         */
+        template<typename T>
+        class [[nodiscard]] Task
+        {
+            public:
+                using promise_type = detail::Promise<T>;
+                using Handle = std::coroutine_handle<promise_type>;
+
+                Task() noexcept : handle(nullptr) {  }
+                explicit Task(Handle handle) noexcept : handle(handle) {  }
+                Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {  }
+                Task& operator=(Task&& other) noexcept
+                {
+                    if(this != &other)
+                    {
+                        if(this->handle) {
+                            this->handle.destroy();
+                        }
+                        this->handle = std::exchange(other.handle, nullptr);
+                    }
+                    return *this;
+                }
+                Task(Task const&) = delete;
+                void operator=(Task const&) = delete;
+                ~Task()
+                {
+                    if(this->handle) {
+                        this->handle.destroy();
+                    }
+                }
+
+                /** Start the task and suspend the awaiter until it finishes */
+                auto operator co_await() const& noexcept
+                {
+                    struct Awaiter
+                    {
+                        Handle handle;
+                        bool await_ready() const noexcept { return !this->handle || this->handle.done(); }
+                        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+                        {
+                            this->handle.promise().continuation = awaiter;
+                            return this->handle;
+                        }
+                        T await_resume() { return this->handle.promise().result(); }
+                    };
+                    return Awaiter{ this->handle };
+                }
+
+            private:
+                Handle handle;
+        };
+
+        namespace detail
+        {
+            template<typename T>
+            Task<T> Promise<T>::get_return_object() { return Task<T>(Task<T>::Handle::from_promise(*this)); }
+            inline Task<void> Promise<void>::get_return_object() { return Task<void>(Task<void>::Handle::from_promise(*this)); }
+        }
+    }
+}
+
+#endif //I2CPP_CORO_TASK_HPP
@@ -0,0 +1,132 @@
+/**
+ * @file debouncer.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_DEBOUNCER_HPP
+#define I2CPP_DEBOUNCER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "i2cpp/bus_group.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Change detection and debouncing for a fleet of PCA9555 expanders.
+     * Input words are packed four expanders to a 64-bit lane, and every pin of the fleet is debounced
+     * at once with vertical counters: bit planes counting, per pin, the consecutive sweeps on which the
+     * input has disagreed with its debounced state. An input must disagree for the configured number of
+     * sweeps in a row before its debounced state changes. Each sweep is a handful of bitwise operations
+     * per lane over contiguous arrays, with no per-pin branches, so its cost grows by a few instructions
+     * per four expanders, and callbacks run only for expanders with stable edges.
+     *
+     * Inputs can be polled with sweep(), which reads every expander through an i2cpp::BusGroup, or fed
+     * in with update() and process(), such as from an i2cpp::InputWatcher callback.
+     * @note A Debouncer is not thread-safe; use it from one thread, which also runs the callbacks
+     */
+    class Debouncer
+    {
+        public:
+            /**
+             * Handler for debounced input changes.
+             * @param device The expander whose debounced inputs changed
+             * @param state The new 16-bit debounced input state
+             * @param rising Bitmask of the inputs which became high
+             * @param falling Bitmask of the inputs which became low
+             */
+            using Callback = std::function<void(PCA9555& device, uint_fast16_t state, uint_fast16_t rising, uint_fast16_t falling)>;
+
+            /** Most samples the vertical counters can count to */
+            static const unsigned MAX_SAMPLES = 8;
+
+            /**
+             * Create an empty debouncer.
+             * @param samples Consecutive sweeps an input must hold a new level for, 1 to MAX_SAMPLES.
+             *                1 reports every change on the sweep it is seen
+             */
+            explicit Debouncer(unsigned samples = 3);
+            Debouncer(Debouncer const&) = delete;
+            void operator=(Debouncer const&) = delete;
+
+            /**
+             * Add an expander to the fleet.
+             * The expander's inputs are read once to establish the initial debounced state. If that read
+             * fails, the state is unknown until the first input word is staged, which then becomes the
+             * state without reporting any edges.
+             * @param device The expander
+             * @param callback Handler for the expander's debounced changes
+             * @returns Index of the expander, for update() and get_state()
+             */
+            std::size_t add(PCA9555::SharedPtr device, Callback callback);
+            /** @returns Number of expanders in the fleet */
+            std::size_t size() const;
+
+            /**
+             * Read every expander's inputs, all adapters in parallel, then process() them.
+             * Expanders which cannot be read keep their previous input word.
+             * @returns True if every expander was read, false otherwise
+             */
+            bool sweep();
+            /**
+             * Stage an expander's latest input word for the next process().
+             * @param index Index of the expander, as returned by add()
+             * @param input The 16-bit input word
+             */
+            void update(std::size_t index, uint_fast16_t input);
+            /**
+             * Debounce the staged input words of every expander and run the callbacks of any with stable edges.
+             * @returns Number of expanders whose debounced state changed
+             */
+            std::size_t process();
+
+            /**
+             * Get an expander's debounced input state.
+             * @param index Index of the expander, as returned by add()
+             * @returns The 16-bit debounced input word, 0 while unknown
+             */
+            uint_fast16_t get_state(std::size_t index) const;
+            /**
+             * Get an expander's most recent raw input word.
+             * @param index Index of the expander, as returned by add()
+             * @returns The 16-bit input word last read or staged
+             */
+            uint_fast16_t get_input(std::size_t index) const;
+
+        private:
+            /** Expanders packed into each lane */
+            static const std::size_t lane_width = 4;
+            /** Bit planes of the vertical counters, enough to count to MAX_SAMPLES */
+            static const std::size_t planes = 3;
+
+            struct Entry
+            {
+                PCA9555::SharedPtr device;
+                Callback callback;
+                /** Channel of the expander's input port in the BusGroup */
+                std::size_t channel;
+            };
+
+            /** Consecutive disagreeing sweeps which change a debounced state */
+            unsigned samples;
+            std::vector<Entry> entries;
+            /** Raw input words, four expanders per lane */
+            std::vector<uint64_t> inputs;
+            /** Debounced input words, four expanders per lane */
+            std::vector<uint64_t> states;
+            /** All ones in the slots of expanders whose debounced state is known, four expanders per lane */
+            std::vector<uint64_t> known;
+            /** Vertical counter bit planes, lane-major: the planes of lane l are words l * planes onwards */
+            std::vector<uint64_t> counters;
+            /** Debounced bits changed by the last process(), four expanders per lane */
+            std::vector<uint64_t> edges;
+            BusGroup group;
+            BusGroup::Frame frame;
+    };
+}
+
+#endif //I2CPP_DEBOUNCER_HPP
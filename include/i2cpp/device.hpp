@@ -9,6 +9,13 @@
 #include <cstdint>
 #include <cstddef>
 #include <string>
+#include <functional>
+#include <future>
+
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/executor.hpp"
+#include "i2cpp/read_cache.hpp"
+#include "i2cpp/register_map.hpp"
 
 /**
  * @defgroup Devices
@@ -49,6 +56,22 @@ namespace i2cpp
              * @returns Device's I2C address
              */
             uint_fast8_t get_address() const;
+            /**
+             * Get the File Descriptor of this device's I2C adapter.
+             * @returns Adapter File Descriptor, as returned by i2cpp::I2CPP::open_adapter()
+             */
+            int get_adapter() const;
+            /**
+             * Share this device's register reads with every other reader of the same registers.
+             * Concurrent reads of a register then make a single bus transaction, and a completed read
+             * is reused by reads within max_age of it, across every Device with its cache enabled.
+             * Useful when several consumers poll the same inputs. Disabled by default.
+             * @see i2cpp::ReadCache
+             *
+             * @param enable True to route register reads through i2cpp::ReadCache
+             * @param max_age Nanoseconds a completed read may be reused for, 0 to only share reads in flight
+             */
+            void set_read_cache(bool enable, uint64_t max_age = 0);
 
         protected:
             /**
@@ -69,12 +92,148 @@ namespace i2cpp
              * @returns Number of bytes written to the bus
              */
             std::size_t write_i2c(uint_fast8_t* buffer, std::size_t length);
+            /**
+             * Write to and then read from this device without releasing the bus
+             * @see i2cpp::I2CPP::write_read_i2c()
+             *
+             * @param[out] out Array of bytes to write to the bus
+             * @param out_length Length of out
+             * @param[in] in Array of bytes to write to from the bus
+             * @param in_length Length of in
+             * @returns Number of bytes read into in, 0 if the transaction failed
+             */
+            std::size_t write_read_i2c(uint_fast8_t* out, std::size_t out_length, uint_fast8_t* in, std::size_t in_length);
+            /**
+             * Perform a combined transaction of several messages with this device.
+             * Each message's address is set to this device's address before sending.
+             * @see i2cpp::I2CPP::transfer()
+             *
+             * @param[in,out] messages Array of messages to send
+             * @param count Number of messages in the array
+             * @returns True if every message was transferred, false otherwise
+             */
+            bool transfer_i2c(Message* messages, std::size_t count);
+
+            /**
+             * Read a register described by an i2cpp::Register, using the adapter's cheapest register path.
+             * @see i2cpp::I2CPP::read_register()
+             * @param[in] value Receives the decoded register value
+             * @returns True if successful, false otherwise
+             */
+            template<typename Reg>
+            bool read_register(typename Reg::value_type& value)
+            {
+                static_assert(Reg::readable, "Register is write-only");
+                uint_fast8_t buffer[Reg::width];
+                if(!this->cached) {
+                    return this->read_register_direct<Reg>(value);
+                }
+                if(ReadCache::read(this->fd, this->address, Reg::address, buffer, Reg::width, this->max_age) != Reg::width) {
+                    return false;
+                }
+                value = Reg::decode(buffer);
+                return true;
+            }
+            /**
+             * Read a register from the bus even when the read cache is enabled.
+             * For volatile status bits and read-modify-write sequences.
+             * @see read_register()
+             * @param[in] value Receives the decoded register value
+             * @returns True if successful, false otherwise
+             */
+            template<typename Reg>
+            bool read_register_direct(typename Reg::value_type& value)
+            {
+                static_assert(Reg::readable, "Register is write-only");
+                uint_fast8_t buffer[Reg::width];
+                if(I2CPP::read_register(this->fd, this->address, Reg::address, buffer, Reg::width) != Reg::width) {
+                    return false;
+                }
+                value = Reg::decode(buffer);
+                return true;
+            }
+            /**
+             * Write a register described by an i2cpp::Register, using the adapter's cheapest register path.
+             * @see i2cpp::I2CPP::write_register()
+             * @param value The register value
+             * @returns True if successful, false otherwise
+             */
+            template<typename Reg>
+            bool write_register(typename Reg::value_type value)
+            {
+                static_assert(Reg::writable, "Register is read-only");
+                uint_fast8_t buffer[Reg::width];
+                Reg::encode(value, buffer);
+                bool success = I2CPP::write_register(this->fd, this->address, Reg::address, buffer, Reg::width) == Reg::width;
+                ReadCache::invalidate(this->fd, this->address);
+                return success;
+            }
+            /**
+             * Read one bit field described by an i2cpp::Field.
+             * @param[in] value Receives the field's value
+             * @returns True if successful, false otherwise
+             */
+            template<typename F>
+            bool read_field(typename F::value_type& value)
+            {
+                typename F::register_type::value_type reg = 0;
+                if(!this->read_register<typename F::register_type>(reg)) {
+                    return false;
+                }
+                value = F::get(reg);
+                return true;
+            }
+            /**
+             * Change one bit field described by an i2cpp::Field, reading its register from the bus and rewriting it.
+             * @param value The field's new value
+             * @returns True if successful, false otherwise
+             */
+            template<typename F>
+            bool write_field(typename F::value_type value)
+            {
+                typename F::register_type::value_type reg = 0;
+                if(!this->read_register_direct<typename F::register_type>(reg)) {
+                    return false;
+                }
+                return this->write_register<typename F::register_type>(F::set(reg, value));
+            }
+
+            /**
+             * Run a job on this device's adapter I/O thread.
+             * The device must outlive the job.
+             * @see i2cpp::Executor::submit()
+             *
+             * @param job Work to run, typically a call to one of this device's blocking methods
+             * @returns Future which receives the job's result
+             */
+            template<typename Result>
+            std::future<Result> run_async(std::function<Result()> job)
+            {
+                return Executor::submit<Result>(this->fd, job);
+            }
+            /**
+             * Run a job on this device's adapter I/O thread, then hand its result to a callback.
+             * The callback is invoked on the I/O thread, so it should return quickly.
+             * The device must outlive the job.
+             *
+             * @param job Work to run, typically a call to one of this device's blocking methods
+             * @param callback Completion handler receiving the job's result
+             */
+            template<typename Result>
+            void run_async(std::function<Result()> job, std::function<void(Result)> callback)
+            {
+                Executor::post(this->fd, [job, callback]() { callback(job()); });
+            }
 
         private:
             /** File Descriptor for this device's I2C interface */
             int fd;
             /** Address of this device on the I2C bus */
             uint_fast8_t address;
+            /** True if register reads go through i2cpp::ReadCache */
+            bool cached;
+            /** Oldest cached read to accept, in nanoseconds */
+            uint64_t max_age;
     };
 }
 /** @} */
@@ -6,28 +6,369 @@
 #ifndef I2CPP_ADS1115_HPP
 #define I2CPP_ADS1115_HPP
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <thread>
 
 #include "i2cpp/device.hpp"
+#include "i2cpp/ring_buffer.hpp"
 
 namespace i2cpp
 {
-	/**
-	 * ADS1115 : 16-bit Analog-to-Digital Converter.
-	 * Reference Documentation: http://www.ti.com/lit/ds/symlink/ads1115.pdf
-	 *
-	 * This device implementation is currently a work-in-progress
-	 * @ingroup Devices
-	 */
+    /**
+     * ADS1115 : 16-bit Analog-to-Digital Converter.
+     * Reference Documentation: http://www.ti.com/lit/ds/symlink/ads1115.pdf
+     *
+     * Covers the whole configuration register (input multiplexer, gain amplifier, data rate, operating mode
+     * and comparator), the threshold registers, single-shot conversions and continuous streaming.
+     * The configuration register is cached after every read and write, so changing one field costs one write.
+     *
+     * While streaming, a dedicated thread reads each conversion into a preallocated single-producer,
+     * single-consumer ring buffer of timestamped samples, which one consumer thread drains with read_samples().
+     * The stream owns the device's address pointer while it runs, so every other method that accesses the
+     * board fails until stop_stream().
+     * @ingroup Devices
+     */
     class ADS1115 : public Device
     {
-
         public:
+            /** Convenience name to get a Shared Pointer */
             using SharedPtr = std::shared_ptr<ADS1115>;
 
+            /** Input multiplexer setting: the inputs measured as positive - negative */
+            enum class Mux : uint_fast8_t
+            {
+                AIN0_AIN1 = 0, AIN0_AIN3, AIN1_AIN3, AIN2_AIN3,
+                AIN0_GND, AIN1_GND, AIN2_GND, AIN3_GND
+            };
+            /** Gain amplifier setting, named for the full-scale range it gives */
+            enum class Gain : uint_fast8_t
+            {
+                FS_6_144V = 0, FS_4_096V, FS_2_048V, FS_1_024V, FS_0_512V, FS_0_256V
+            };
+            /** Conversions per second */
+            enum class DataRate : uint_fast8_t
+            {
+                SPS_8 = 0, SPS_16, SPS_32, SPS_64, SPS_128, SPS_250, SPS_475, SPS_860
+            };
+            /** Operating mode */
+            enum class Mode : uint_fast8_t
+            {
+                CONTINUOUS = 0,
+                /** Power down after each conversion, also the power-on default */
+                SINGLE_SHOT
+            };
+            /** Comparator mode */
+            enum class ComparatorMode : uint_fast8_t
+            {
+                /** Assert above the high threshold, release below the low threshold */
+                TRADITIONAL = 0,
+                /** Assert outside the window between the thresholds */
+                WINDOW
+            };
+            /** Number of successive conversions past a threshold before ALERT/RDY asserts */
+            enum class ComparatorQueue : uint_fast8_t
+            {
+                ONE = 0, TWO, FOUR,
+                /** Comparator disabled and ALERT/RDY high impedance, the power-on default */
+                DISABLED
+            };
+
+            /** @brief Register map: four 16-bit big-endian registers, with the configuration register's bit fields */
+            struct Registers
+            {
+                using Conversion = Register<0x00, 2, Endian::BIG, Access::READ_ONLY>;
+                using Config = Register<0x01, 2, Endian::BIG>;
+                using LowThreshold = Register<0x02, 2, Endian::BIG>;
+                using HighThreshold = Register<0x03, 2, Endian::BIG>;
+
+                /** Write 1 to start a single-shot conversion, reads 0 while converting */
+                using Status = Field<Config, 15, 1, bool>;
+                using Mux = Field<Config, 12, 3, ADS1115::Mux>;
+                using Gain = Field<Config, 9, 3, ADS1115::Gain>;
+                using Mode = Field<Config, 8, 1, ADS1115::Mode>;
+                using DataRate = Field<Config, 5, 3, ADS1115::DataRate>;
+                using ComparatorMode = Field<Config, 4, 1, ADS1115::ComparatorMode>;
+                using ComparatorPolarity = Field<Config, 3, 1, bool>;
+                using ComparatorLatch = Field<Config, 2, 1, bool>;
+                using ComparatorQueue = Field<Config, 0, 2, ADS1115::ComparatorQueue>;
+            };
+
+            /** @brief Decoded configuration register, without the operational status bit */
+            struct Config
+            {
+                Mux mux;
+                Gain gain;
+                DataRate rate;
+                Mode mode;
+                ComparatorMode comparator_mode;
+                /** ALERT/RDY polarity, false for active low */
+                bool comparator_active_high;
+                /** Hold ALERT/RDY asserted until the conversion register is read */
+                bool comparator_latching;
+                ComparatorQueue comparator_queue;
+
+                /** Construct the power-on configuration. */
+                Config();
+                /**
+                 * Encode the configuration.
+                 * @returns 16-bit configuration register value, with the operational status bit clear
+                 */
+                uint_fast16_t to_register() const;
+                /**
+                 * Decode a configuration register value.
+                 * @param value 16-bit configuration register value
+                 * @returns The decoded configuration
+                 */
+                static Config from_register(uint_fast16_t value);
+            };
+
+            /** @brief One streamed conversion result */
+            struct Sample
+            {
+                /** CLOCK_MONOTONIC time the conversion was read, in nanoseconds */
+                int64_t timestamp;
+                /** Raw conversion result */
+                int_fast16_t value;
+            };
+
+            /** @brief Counters for the current or last stream */
+            struct StreamStatistics
+            {
+                /** Samples pushed into the ring buffer */
+                uint64_t samples;
+                /** Samples lost because the ring buffer was full, or the stream thread fell behind */
+                uint64_t dropped;
+                /** Failed conversion reads */
+                uint64_t errors;
+            };
+
+            /**
+             * Construct an ADS1115 with the given bus and address.
+             * @param bus I2C interface number to use
+             * @param address Address of the device on the I2C network
+             */
             ADS1115(int bus, uint_fast8_t address);
+            /**
+             * Construct an ADS1115 with the given device file and address.
+             * @param filename Path to I2C device file, or name of an attached adapter
+             * @param address Address of the device on the I2C network
+             */
+            ADS1115(std::string filename, uint_fast8_t address);
+            /** Stops any running stream. */
+            ~ADS1115();
+            ADS1115(ADS1115 const&) = delete;
+            void operator=(ADS1115 const&) = delete;
+
+            /** @name Configuration */
+            //@{
+            /**
+             * Get the cached configuration, as last read from or written to the board.
+             * @returns The cached configuration
+             */
+            Config get_config() const;
+            /**
+             * Read the configuration register from the board, updating the cache.
+             * @returns The configuration, or the cached configuration if the read fails
+             */
+            Config read_config();
+            /**
+             * Write the configuration register.
+             * In continuous mode, this also restarts conversions with the new settings.
+             * @param config The new configuration
+             * @returns True if successful, false otherwise
+             */
+            bool write_config(const Config& config);
+            /**
+             * Select the inputs to measure.
+             * @param mux The new input multiplexer setting
+             * @returns True if successful, false otherwise
+             */
+            bool set_mux(Mux mux);
+            /**
+             * Select the full-scale range.
+             * @param gain The new gain amplifier setting
+             * @returns True if successful, false otherwise
+             */
+            bool set_gain(Gain gain);
+            /**
+             * Select the number of conversions per second.
+             * @param rate The new data rate
+             * @returns True if successful, false otherwise
+             */
+            bool set_data_rate(DataRate rate);
+            /**
+             * Select continuous or single-shot conversions.
+             * @param mode The new operating mode
+             * @returns True if successful, false otherwise
+             */
+            bool set_mode(Mode mode);
+            /**
+             * Configure the comparator driving the ALERT/RDY pin.
+             * @param mode Traditional or window comparator
+             * @param active_high ALERT/RDY polarity, false for active low
+             * @param latching Hold ALERT/RDY asserted until the conversion register is read
+             * @param queue Conversions past a threshold before asserting, or ComparatorQueue::DISABLED
+             * @returns True if successful, false otherwise
+             */
+            bool set_comparator(ComparatorMode mode, bool active_high, bool latching, ComparatorQueue queue);
+            /**
+             * Write the comparator thresholds.
+             * @param low Lo_thresh register value, in raw conversion units
+             * @param high Hi_thresh register value, in raw conversion units
+             * @returns True if successful, false otherwise
+             */
+            bool write_thresholds(int_fast16_t low, int_fast16_t high);
+            /**
+             * Read the comparator thresholds.
+             * @param[in] low Receives the Lo_thresh register value
+             * @param[in] high Receives the Hi_thresh register value
+             * @returns True if successful, false otherwise
+             */
+            bool read_thresholds(int_fast16_t& low, int_fast16_t& high);
+            /**
+             * Turn ALERT/RDY into a conversion-ready signal, pulsing after every conversion in continuous mode
+             * and asserting at the end of each single-shot conversion.
+             * This sets the threshold MSBs as the datasheet requires and enables the comparator;
+             * disabling restores the power-on thresholds and disables the comparator.
+             * @param enable True for conversion-ready signalling, false to disable ALERT/RDY
+             * @returns True if successful, false otherwise
+             */
+            bool enable_ready_pin(bool enable = true);
+            //@}
+
+            /** @name Conversions */
+            //@{
+            /**
+             * Start a single-shot conversion with the cached configuration.
+             * @returns True if successful, false otherwise
+             */
+            bool start_conversion();
+            /**
+             * Check if a single-shot conversion is in progress.
+             * @returns True while converting, false when idle or if the read fails
+             */
+            bool is_converting();
+            /**
+             * Read the conversion register.
+             * @returns The last conversion result, 0 if the read fails
+             */
+            int_fast16_t read_conversion();
+            /**
+             * Perform a single-shot conversion and wait for its result.
+             * The calling thread sleeps for the conversion time, then polls until the conversion completes.
+             * @param mux Inputs to measure
+             * @returns The conversion result, 0 if the conversion fails
+             */
+            int_fast16_t read_single(Mux mux);
+            /**
+             * Perform a single-shot conversion and convert it to volts.
+             * @see read_single()
+             *
+             * @param mux Inputs to measure
+             * @returns Measured voltage, 0 if the conversion fails
+             */
+            double read_voltage(Mux mux);
+            /**
+             * Convert a raw conversion result to volts with the cached gain setting.
+             * @param value Raw conversion result
+             * @returns Voltage
+             */
+            double to_volts(int_fast16_t value) const;
+            /**
+             * Get the full-scale range of a gain setting.
+             * @param gain Gain amplifier setting
+             * @returns Full-scale range in volts
+             */
+            static double full_scale(Gain gain);
+            /**
+             * Get the conversion frequency of a data rate.
+             * @param rate Data rate setting
+             * @returns Conversions per second
+             */
+            static uint_fast16_t samples_per_second(DataRate rate);
+            //@}
+
+            /**
+             * @name Streaming
+             * Continuous conversions read by a dedicated thread into a lock-free ring buffer.
+             * The address pointer is left on the conversion register, so each sample costs a single
+             * 2-byte read on the bus.
+             *
+             * With a ready line, the thread waits for it to become readable, typically a GPIO line-event
+             * file descriptor for a falling edge on ALERT/RDY, and reads exactly one conversion per edge.
+             * Without one, the thread wakes once per conversion period on CLOCK_MONOTONIC. The ADS1115's
+             * internal oscillator is only accurate to 10%, so timed streams can occasionally repeat or skip
+             * a conversion; use a ready line where every conversion matters.
+             */
+            //@{
+            /**
+             * Start streaming continuous conversions.
+             * @note Consumers must keep up with the data rate, or samples are dropped when the ring buffer fills
+             *
+             * @param mux Inputs to measure
+             * @param rate Conversions per second
+             * @param capacity Minimum number of samples the ring buffer holds, rounded up to a power of two
+             * @param ready_line File descriptor which becomes readable on each ALERT/RDY pulse,
+             *                   or -1 to pace by timing. Not owned, and must stay open while streaming
+             * @returns True if the stream started, false if already streaming or the board could not be configured
+             */
+            bool start_stream(Mux mux, DataRate rate, std::size_t capacity, int ready_line = -1);
+            /**
+             * Stop streaming, wait for the stream thread to exit and power the converter down.
+             * Samples already queued can still be read.
+             */
+            void stop_stream();
+            /**
+             * Check if the stream is running.
+             * @returns True between start_stream() and stop_stream()
+             */
+            bool is_streaming() const;
+            /**
+             * Drain streamed samples in bulk, oldest first. Never blocks, allocates or locks.
+             * @note Only one thread may read samples at a time
+             *
+             * @param[in] samples Array to fill
+             * @param count Maximum number of samples to read
+             * @returns Number of samples read into the array
+             */
+            std::size_t read_samples(Sample* samples, std::size_t count);
+            /**
+             * Get the number of streamed samples waiting to be read.
+             * @returns Number of queued samples
+             */
+            std::size_t available() const;
+            /**
+             * Get the counters of the current or last stream.
+             * @returns Snapshot of the counters
+             */
+            StreamStatistics get_stream_statistics() const;
+            //@}
+
+        private:
+            /** Pipelines conversions through the cached configuration */
+            friend class ADS1115Sampler;
+
+            template<typename Reg>
+            bool read_register(uint_fast16_t& value);
+            template<typename Reg>
+            bool write_register(uint_fast16_t value);
+            void stream(int64_t period);
+
+            /** Cached configuration register */
+            Config config;
 
+            std::atomic<bool> streaming;
+            std::thread stream_thread;
+            /** eventfd used to wake the stream thread when stopping */
+            int stop_fd;
+            int ready_line;
+            std::unique_ptr<RingBuffer<Sample>> samples;
+            std::atomic<uint64_t> streamed;
+            std::atomic<uint64_t> dropped;
+            std::atomic<uint64_t> errors;
     };
 }
 
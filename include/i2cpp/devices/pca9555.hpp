@@ -8,6 +8,10 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <functional>
+#include <future>
+#include <mutex>
 
 #include "i2cpp/i2cpp.hpp"
 #include "i2cpp/device.hpp"
@@ -27,6 +31,8 @@ namespace i2cpp
      * | pin | 1.7 | 1.6 | 1.5 | 1.4 | 1.3 | 1.2 | 1.1 | 1.0 | 0.7 | 0.6 | 0.5 | 0.4 | 0.3 | 0.2 | 0.1 | 0.0 |
      * |-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|-----|
      * </pre>
+     * With the read cache enabled, only input reads are served from it. Output, polarity and
+     * configuration reads always go to the board, since pin writes modify the value they read.
      * @ingroup Devices
      */
     class PCA9555 : public Device
@@ -35,12 +41,27 @@ namespace i2cpp
             /** Convenience name to get a Shared Pointer */
             using SharedPtr = std::shared_ptr<PCA9555>;
 
+            /** @brief Register map: four 16-bit registers, each a little-endian pair of port 0 and port 1 */
+            struct Registers
+            {
+                using Input = Register<0x00, 2, Endian::LITTLE, Access::READ_ONLY>;
+                using Output = Register<0x02, 2, Endian::LITTLE>;
+                using Polarity = Register<0x04, 2, Endian::LITTLE>;
+                using Configuration = Register<0x06, 2, Endian::LITTLE>;
+            };
+
             /**
              * Construct a PCA9555 with the given bus and address.
              * @param bus I2C interface number to use
              * @param address Address of the device on the I2C network
              */
             PCA9555(int bus, uint_fast8_t address);
+            /**
+             * Construct a PCA9555 with the given device file and address.
+             * @param filename Path to I2C device file, or name of an attached adapter
+             * @param address Address of the device on the I2C network
+             */
+            PCA9555(std::string filename, uint_fast8_t address);
 
             /**
              * Get a saved state from the PCA9555 object.
@@ -58,6 +79,99 @@ namespace i2cpp
              */
             void set_state(uint_fast16_t state);
 
+            /**
+             * @name Shadow registers
+             * The output, polarity and configuration registers are only ever changed by the host,
+             * so the PCA9555 object can keep a write-through copy of them. While shadowing is enabled,
+             * reads of those registers are served from the copy and pin, range and flip writes
+             * cost a single bus write instead of a read followed by a write.
+             * The input register is never shadowed.
+             * Shadow and deferred update state is guarded by a lock, which is held across each pin, range and
+             * flip read-modify-write, so threads sharing the object, including its asynchronous calls, never
+             * lose each other's writes.
+             * @note Another process or object writing to the same board makes the shadow stale,
+             * call resync_shadow() or invalidate_shadow() afterwards
+             */
+            //@{
+            /**
+             * Enable or disable the shadow registers.
+             * Enabling starts with an empty shadow, which is filled on the next access of each register.
+             * @param enable True to enable shadowing, false to disable and discard it
+             */
+            void enable_shadow(bool enable = true);
+            /**
+             * Check if the shadow registers are enabled.
+             * @returns True if shadowing is enabled
+             */
+            bool is_shadow_enabled() const;
+            /**
+             * Reload the output, polarity and configuration shadows from the board.
+             * @returns True if every register was read successfully
+             */
+            bool resync_shadow();
+            /** Discard the shadow contents, forcing the next access of each register to read the board. */
+            void invalidate_shadow();
+            //@}
+
+            /**
+             * @name Deferred updates
+             * Between begin_update() and commit_update(), writes to the output, polarity and configuration
+             * registers (whole register, pin, range and flip) are collected in memory instead of being sent.
+             * Reads of those registers return the pending values.
+             * commit_update() then sends at most one write per register, skipping registers whose value
+             * did not change, so a multi-pin change lands on the pins at once.
+             * Asynchronous calls are never deferred: they run against the board, even while an update is
+             * open, and a register written by one is sent again by commit_update() if it was staged.
+             */
+            //@{
+            /**
+             * @brief Scoped deferred update.
+             * Begins an update on construction and commits it on destruction unless commit() or cancel()
+             * was called first.
+             */
+            class Update
+            {
+                public:
+                    /**
+                     * Begin a deferred update on a device.
+                     * @param device The device to update
+                     */
+                    explicit Update(PCA9555& device);
+                    ~Update();
+                    Update(Update const&) = delete;
+                    void operator=(Update const&) = delete;
+
+                    /**
+                     * Commit the pending writes now.
+                     * @returns True if every write was successful
+                     */
+                    bool commit();
+                    /** Discard the pending writes. */
+                    void cancel();
+
+                private:
+                    PCA9555& device;
+                    bool done;
+            };
+
+            /** Start collecting register writes instead of sending them. */
+            void begin_update();
+            /**
+             * Send the collected register writes and leave deferred update mode.
+             * Registers are written in the order polarity, output, configuration, so pins switched to
+             * output mode already drive their new level.
+             * @returns True if every write was successful
+             */
+            bool commit_update();
+            /** Discard the collected register writes and leave deferred update mode. */
+            void cancel_update();
+            /**
+             * Check if the device is collecting writes.
+             * @returns True between begin_update() and commit_update() or cancel_update()
+             */
+            bool is_updating() const;
+            //@}
+
             /** @name Read data from the PCA9555 board */
             //@{
             /**
@@ -65,6 +179,13 @@ namespace i2cpp
              * @returns The read input from the board
              */
             uint_fast16_t read_input();
+            /**
+             * Read the 16-bit input from the PCA9555 board, reporting whether the read succeeded.
+             * For callers which must not mistake a failed read for all inputs low.
+             * @param[in] value Receives the input, unchanged if the read failed
+             * @returns True if successful, false otherwise
+             */
+            bool read_input(uint_fast16_t& value);
             /**
              * Read a single input pin from the PCA9555 board.
              * @param pin The pin number to read from
@@ -205,15 +326,98 @@ namespace i2cpp
             bool flip_config_pin(uint_fast8_t pin);
             //@}
 
+            /**
+             * @name Asynchronous access
+             * Each call is queued on the adapter's I/O thread and returns immediately.
+             * Results are delivered through a future, or to a callback running on the I/O thread.
+             * The PCA9555 object must outlive any queued call.
+             * @note Queued writes update the shadow registers on the I/O thread, under the same lock as synchronous
+             * calls, but their order relative to synchronous calls made meanwhile is unspecified. Wait for a
+             * queued write before a synchronous pin, range or flip write that must see its result.
+             * @see i2cpp::Executor
+             */
+            //@{
+            /** Asynchronous read_input() */
+            std::future<uint_fast16_t> read_input_async();
+            /** Asynchronous read_input(), delivering the result to callback */
+            void read_input_async(std::function<void(uint_fast16_t)> callback);
+            /** Asynchronous read_output() */
+            std::future<uint_fast16_t> read_output_async();
+            /** Asynchronous read_output(), delivering the result to callback */
+            void read_output_async(std::function<void(uint_fast16_t)> callback);
+            /** Asynchronous read_polarity() */
+            std::future<uint_fast16_t> read_polarity_async();
+            /** Asynchronous read_polarity(), delivering the result to callback */
+            void read_polarity_async(std::function<void(uint_fast16_t)> callback);
+            /** Asynchronous read_config() */
+            std::future<uint_fast16_t> read_config_async();
+            /** Asynchronous read_config(), delivering the result to callback */
+            void read_config_async(std::function<void(uint_fast16_t)> callback);
+            /** Asynchronous write_output() */
+            std::future<bool> write_output_async(uint_fast16_t data);
+            /** Asynchronous write_output(), delivering the result to callback */
+            void write_output_async(uint_fast16_t data, std::function<void(bool)> callback);
+            /** Asynchronous write_polarity() */
+            std::future<bool> write_polarity_async(uint_fast16_t data);
+            /** Asynchronous write_polarity(), delivering the result to callback */
+            void write_polarity_async(uint_fast16_t data, std::function<void(bool)> callback);
+            /** Asynchronous write_config() */
+            std::future<bool> write_config_async(uint_fast16_t data);
+            /** Asynchronous write_config(), delivering the result to callback */
+            void write_config_async(uint_fast16_t data, std::function<void(bool)> callback);
+            //@}
+
         private:
             uint_fast16_t prev_state;
-            uint_fast16_t read_register(uint_fast8_t reg);
-            bool read_register_pin(uint_fast8_t reg, uint_fast8_t pin);
+            /** Guards the shadow and deferred update state, recursive since pin writes read then write under it */
+            mutable std::recursive_mutex mutex;
+            /** True if shadow is maintained */
+            bool shadowing;
+            /** Bitmask of valid shadow entries, bit n is set when shadow[n] holds the register in slot n */
+            uint_fast8_t shadow_valid;
+            /** Shadow copies of the output, polarity and configuration registers */
+            uint_fast16_t shadow[3];
+            /** True between begin_update() and commit_update()/cancel_update() */
+            bool updating;
+            /** Bitmask of registers with a pending value in staged, indexed like shadow */
+            uint_fast8_t staged_mask;
+            /** Bitmask of registers whose value on the board is known in committed, indexed like shadow */
+            uint_fast8_t committed_mask;
+            /** Pending register values */
+            uint_fast16_t staged[3];
+            /** Register values on the board when each register was first staged */
+            uint_fast16_t committed[3];
+
+            /** Index of a register in shadow, staged and committed */
+            template<typename Reg>
+            static constexpr uint_fast8_t slot() { return Reg::writable ? Reg::address / 2 - 1 : 0; }
+            template<typename Reg>
+            bool is_shadowed() const;
+            template<typename Reg>
+            uint_fast16_t fetch_register(bool& success);
+            template<typename Reg>
+            uint_fast16_t load_register(bool& success);
+            template<typename Reg>
+            uint_fast16_t read_register();
+            template<typename Reg>
+            uint_fast16_t read_register_now();
+            template<typename Reg>
+            bool read_register_pin(uint_fast8_t pin);
+            template<typename Reg>
+            bool resync_register();
 
-            bool write_register(uint_fast8_t reg, uint_fast16_t data);
-            bool write_register_pin(uint_fast8_t reg, uint_fast8_t pin, bool value);
-            bool write_register_range(uint_fast8_t reg, uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values);
-            bool flip_register_pin(uint_fast8_t reg, uint_fast8_t pin);
+            template<typename Reg>
+            bool write_register(uint_fast16_t data);
+            template<typename Reg>
+            bool write_register_now(uint_fast16_t data);
+            template<typename Reg>
+            bool write_register_pin(uint_fast8_t pin, bool value);
+            template<typename Reg>
+            bool write_register_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values);
+            template<typename Reg>
+            bool flip_register_pin(uint_fast8_t pin);
+            template<typename Reg>
+            bool commit_register();
     };
 }
 
@@ -0,0 +1,155 @@
+/**
+ * @file discovery.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_DISCOVERY_HPP
+#define I2CPP_DISCOVERY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace i2cpp
+{
+    /** @brief Devices found on a set of I2C adapters */
+    struct Inventory
+    {
+        /** @brief Devices found on one adapter */
+        struct Bus
+        {
+            /** Name the adapter was opened with, as passed to i2cpp::I2CPP::open_adapter() */
+            std::string filename;
+            /** False if the adapter could not be opened */
+            bool available;
+            /** I2C_FUNC_* capabilities reported by the adapter */
+            unsigned long functionality;
+            /** Addresses which acknowledged a probe, in ascending order */
+            std::vector<uint_fast8_t> addresses;
+        };
+
+        /** First address probed on each bus */
+        int first_address;
+        /** Last address probed on each bus */
+        int last_address;
+        /** One entry per adapter, in the order they were given */
+        std::vector<Bus> buses;
+
+        /**
+         * Find an adapter's entry.
+         * @param filename Name the adapter was opened with
+         * @returns The adapter's entry, nullptr if it is not in the inventory
+         */
+        const Bus* find(const std::string& filename) const;
+        /**
+         * Check whether a device was found.
+         * @param filename Name the adapter was opened with
+         * @param address Address of the I2C device on the bus
+         * @returns True if the address acknowledged on that adapter
+         */
+        bool contains(const std::string& filename, int address) const;
+    };
+
+    /**
+     * @brief Concurrent discovery of the devices on every I2C adapter.
+     * Probing the whole address range of a bus costs over a hundred transactions, and probing buses
+     * one after another adds those costs up. Discovery instead runs one worker thread per adapter, so
+     * the scan of the whole system takes about as long as the scan of its busiest bus.
+     * Each address is probed with i2cpp::I2CPP::probe(), which picks quick-write or read probes
+     * according to the adapter's capabilities.
+     *
+     * The result can be cached in a file. On later starts, load_or_discover() accepts the cache
+     * after a spot-check, which only probes the devices it lists, and falls back to a full scan if
+     * the adapters or any of those devices have changed.
+     * @note The spot-check does not notice devices added since the cache was written; delete the cache,
+     *       or call discover(), after adding hardware
+     */
+    class Discovery
+    {
+        public:
+            Discovery() = delete;
+
+            /** First address probed by default, skipping the reserved addresses below it */
+            static const int FIRST_ADDRESS = 0x08;
+            /** Last address probed by default, skipping the reserved addresses above it */
+            static const int LAST_ADDRESS = 0x77;
+
+            /**
+             * List the i2c-dev device files in a directory.
+             * @param directory Directory holding the device files
+             * @returns Paths of every i2c-* file, ordered by bus number
+             */
+            static std::vector<std::string> list_adapters(const std::string& directory = "/dev");
+            /**
+             * Probe a range of addresses on one adapter.
+             * @param filename Adapter to open, as passed to i2cpp::I2CPP::open_adapter()
+             * @param first_address First address to probe
+             * @param last_address Last address to probe
+             * @returns The adapter's inventory entry
+             */
+            static Inventory::Bus scan(const std::string& filename, int first_address = FIRST_ADDRESS, int last_address = LAST_ADDRESS);
+            /**
+             * Probe a range of addresses on several adapters at once, with one thread per adapter.
+             * @param filenames Adapters to open, as passed to i2cpp::I2CPP::open_adapter()
+             * @param first_address First address to probe
+             * @param last_address Last address to probe
+             * @returns Inventory of every adapter
+             */
+            static Inventory discover(const std::vector<std::string>& filenames, int first_address = FIRST_ADDRESS, int last_address = LAST_ADDRESS);
+            /**
+             * Probe every i2c-dev adapter in /dev at once.
+             * @see list_adapters()
+             * @returns Inventory of every adapter
+             */
+            static Inventory discover();
+
+            /**
+             * Write an inventory to a cache file.
+             * The file is written under a temporary name and renamed into place, so readers never see
+             * a partial inventory.
+             * @param inventory The inventory
+             * @param path Path of the cache file
+             * @returns True if successful, false otherwise
+             */
+            static bool save(const Inventory& inventory, const std::string& path);
+            /**
+             * Read an inventory from a cache file.
+             * @param path Path of the cache file
+             * @param[in] inventory Receives the inventory
+             * @returns True if successful, false if the file is missing or malformed
+             */
+            static bool load(const std::string& path, Inventory& inventory);
+            /**
+             * Spot-check an inventory against the hardware.
+             * Checks that the inventory covers exactly the given adapters and address range, that
+             * each adapter still opens and reports the same capabilities, and that every listed
+             * device still acknowledges. Absent addresses are not probed.
+             * @param inventory The inventory
+             * @param filenames Adapters the inventory should cover
+             * @param first_address First address the inventory should cover
+             * @param last_address Last address the inventory should cover
+             * @returns True if the inventory is still accurate, as far as the spot-check can tell
+             */
+            static bool verify(const Inventory& inventory, const std::vector<std::string>& filenames,
+                int first_address = FIRST_ADDRESS, int last_address = LAST_ADDRESS);
+            /**
+             * Use a cached inventory if it passes verify(), otherwise discover() and rewrite the cache.
+             * @param path Path of the cache file
+             * @param filenames Adapters to cover
+             * @param first_address First address to cover
+             * @param last_address Last address to cover
+             * @returns Inventory of every adapter
+             */
+            static Inventory load_or_discover(const std::string& path, const std::vector<std::string>& filenames,
+                int first_address = FIRST_ADDRESS, int last_address = LAST_ADDRESS);
+            /**
+             * Use a cached inventory of every i2c-dev adapter in /dev, or discover and cache one.
+             * @param path Path of the cache file
+             * @returns Inventory of every adapter
+             */
+            static Inventory load_or_discover(const std::string& path);
+    };
+}
+
+#endif //I2CPP_DISCOVERY_HPP
@@ -0,0 +1,118 @@
+/**
+ * @file executor.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_EXECUTOR_HPP
+#define I2CPP_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "i2cpp/arbiter.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Asynchronous I/O threads, one per I2C adapter.
+     * A singleton which runs jobs on a dedicated thread for each adapter, so callers can queue
+     * bus work and carry on while every bus runs in parallel.
+     * Jobs for one adapter run in the order they were posted, each in the i2cpp::BusPriority
+     * class of the thread which posted it.
+     *
+     * Most users will not use this static API, instead prefering the asynchronous methods of a Device
+     * @see i2cpp::Device
+     */
+    class Executor
+    {
+        public:
+            /** A unit of work to run on an adapter's I/O thread */
+            using Job = std::function<void()>;
+
+            // Make sure only a single instance can be made.
+            Executor(Executor const&) = delete;
+            void operator=(Executor const&) = delete;
+
+            /**
+             * Queue a job on an adapter's I/O thread.
+             * Starts the thread on first use of the adapter.
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param job Work to run on the adapter's I/O thread
+             */
+            static void post(int adapter, Job job);
+            /**
+             * Queue a job on an adapter's I/O thread and get its result as a future.
+             * @see post()
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param job Work to run on the adapter's I/O thread
+             * @returns Future which receives the job's result, or any exception it threw
+             */
+            template<typename Result>
+            static std::future<Result> submit(int adapter, std::function<Result()> job)
+            {
+                std::shared_ptr<std::packaged_task<Result()>> task(new std::packaged_task<Result()>(job));
+                Executor::post(adapter, [task]() { (*task)(); });
+                return task->get_future();
+            }
+
+        private:
+            /** Queue node, linked by the producers and consumed by the adapter's thread */
+            struct Node
+            {
+                std::atomic<Node*> next;
+                Job job;
+                /** Priority class of the posting thread, which the job runs in */
+                BusPriority priority;
+            };
+            /**
+             * An adapter's I/O thread and its intrusive multi-producer single-consumer queue.
+             * Producers only perform a single atomic exchange, the mutex is touched only when
+             * the thread has gone to sleep on an empty queue.
+             */
+            struct Worker
+            {
+                /** Most recently pushed node, shared by all producers */
+                std::atomic<Node*> head;
+                /** Oldest node, owned by the consumer thread */
+                Node* tail;
+                /** Permanent dummy node so the queue is never truly empty */
+                Node stub;
+                /** Set while the thread is (about to be) waiting for work */
+                std::atomic<bool> sleeping;
+                std::atomic<bool> running;
+                std::mutex mutex;
+                std::condition_variable wakeup;
+                std::thread thread;
+
+                Worker();
+                void push(Node* node);
+                Node* pop();
+                void run();
+            };
+            /** Number of File Descriptors resolved through the lock-free lookup table */
+            static constexpr int lookup_size = 1024;
+
+            Executor();
+            ~Executor();
+            static Executor& instance();
+
+            Worker& _worker(int adapter);
+
+            /** Guards starting workers */
+            std::mutex start_mutex;
+            /** Owner of every Worker, keyed by adapter File Descriptor */
+            std::map<int, std::unique_ptr<Worker>> workers;
+            /** Write-once view of workers for File Descriptors below lookup_size */
+            std::atomic<Worker*> lookup[lookup_size];
+    };
+}
+
+#endif //I2CPP_EXECUTOR_HPP
@@ -7,8 +7,17 @@
 #define I2C_LIBRARY_H
 
 #include <cstdint>
+#include <cstddef>
 #include <string>
 #include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "i2cpp/transport.hpp"
+#include "i2cpp/statistics.hpp"
+#include "i2cpp/arbiter.hpp"
 
 namespace i2cpp
 {
@@ -17,6 +26,9 @@ namespace i2cpp
      * A singleton class for reading from and writing to a given I2C adapter.
      * Keeps track of all currently open interfaces to reduce redundency and release resources safely.
      *
+     * All methods are thread-safe. Each adapter has its own lock, so threads using different
+     * buses never contend, while transactions on a shared bus are serialized.
+     *
      * Most users will not use this static API, instead prefering to use an I2C Device object
      * @see i2cpp::Device
      */
@@ -45,6 +57,17 @@ namespace i2cpp
              * @returns File Descriptor for I2C device file
              */
             static int open_adapter(std::string filename);
+            /**
+             * Register a Transport as an I2C adapter.
+             * Later calls of open_adapter() with the same filename return the transport's handle instead
+             * of opening a device file, so devices constructed by bus number or filename use the transport.
+             * For example, attaching an i2cpp::SimulatedBus as "/dev/i2c-1" makes PCA9555(1, 0x20) talk to it.
+             *
+             * @param filename Name to register the transport under
+             * @param transport Backend carrying the adapter's transactions
+             * @returns Handle for the adapter, or -1 if the name is already open
+             */
+            static int attach_adapter(std::string filename, Transport::SharedPtr transport);
 
             /**
              * Read bytes from I2C to a buffer.
@@ -66,28 +89,237 @@ namespace i2cpp
              * @param length Length of buffer
              */
             static std::size_t write_i2c(int adapter, int address, uint_fast8_t* buffer, std::size_t length);
+            /**
+             * Perform a combined transaction of several messages.
+             * All messages are sent in order with a single ioctl(I2C_RDWR), separated by repeated STARTs
+             * and terminated by a single STOP. Addresses are taken from each message, so the adapter's
+             * currently selected address is left untouched.
+             * @note At most max_messages() messages can be sent in one transfer
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param[in,out] messages Array of messages to send
+             * @param count Number of messages in the array
+             * @returns True if every message was transferred, false otherwise
+             */
+            static bool transfer(int adapter, Message* messages, std::size_t count);
+            /**
+             * Write a buffer of bytes to I2C, then read back into another without releasing the bus.
+             * Typically used to set a device's register pointer and read the register in one transaction.
+             * @see transfer()
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param address Address of the I2C device on the bus
+             * @param[out] out Array of bytes to write to the bus
+             * @param out_length Length of out
+             * @param[in] in Array of bytes to write to from the bus
+             * @param in_length Length of in
+             * @returns Number of bytes read into in, 0 if the transaction failed
+             */
+            static std::size_t write_read_i2c(int adapter, int address, uint_fast8_t* out, std::size_t out_length, uint_fast8_t* in, std::size_t in_length);
+            /**
+             * Submit a batch of independent messages to several devices on one adapter.
+             * Messages are packed into as few I2C_RDWR calls as the kernel allows, so a sweep of every
+             * device on a bus costs one (or a few) kernel entries and no I2C_SLAVE reconfiguration.
+             * A write immediately followed by a read of the same address is kept in the same call,
+             * forming a repeated-start register read.
+             *
+             * If a packed call fails, its messages are retried one transaction at a time so each
+             * message's status reflects only its own device.
+             * @note Transactions ahead of the failure in a packed call may be performed twice, so batched writes should be idempotent
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param[in,out] messages Messages to send, each status is updated on return
+             * @returns Number of messages transferred successfully
+             */
+            static std::size_t submit_batch(int adapter, std::vector<Message>& messages);
+            /**
+             * Get the maximum number of messages accepted by a single transfer().
+             * @returns Kernel limit of messages per I2C_RDWR call, also applied to every other Transport
+             */
+            static std::size_t max_messages();
+
+            /**
+             * @name Register access
+             * Register reads and writes go through the cheapest primitive the adapter supports, chosen
+             * from the I2C_FUNCS capabilities probed when the adapter is opened: a combined I2C_RDWR
+             * transfer on full I2C adapters, SMBus byte, word or I2C block transactions on SMBus-only
+             * adapters, and separate write() and read() calls if neither fits.
+             * With Packet Error Checking enabled, SMBus byte and word transactions are preferred,
+             * since only those carry a PEC byte.
+             */
+            //@{
+            /** @brief Primitive used to access a register */
+            enum class RegisterPath
+            {
+                /** One combined I2C_RDWR transfer */
+                TRANSFER,
+                /** SMBus read/write byte data */
+                SMBUS_BYTE,
+                /** SMBus read/write word data */
+                SMBUS_WORD,
+                /** SMBus I2C block read/write */
+                SMBUS_BLOCK,
+                /** Separate write() of the register address and read() or write() of the data */
+                RAW
+            };
+            /**
+             * Get an adapter's capabilities, probed with I2C_FUNCS when the adapter was opened.
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @returns Bitmask of I2C_FUNC_* flags from linux/i2c.h
+             */
+            static unsigned long get_functionality(int adapter);
+            /**
+             * Enable or disable Packet Error Checking for an adapter's SMBus transactions.
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param enable True to append and check a PEC byte
+             * @returns True if successful, false if the adapter does not support PEC
+             */
+            static bool set_pec(int adapter, bool enable);
+            /**
+             * Get the primitive used for register accesses of a given size.
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param length Number of data bytes in the register
+             * @param read True for reads, false for writes
+             * @returns The primitive chosen for the adapter's capabilities and PEC setting
+             */
+            static RegisterPath register_path(int adapter, std::size_t length, bool read);
+            /**
+             * Read a device register.
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param address Address of the I2C device on the bus
+             * @param command Register address, sent as the command byte
+             * @param[in] buffer Array of bytes to read the register into, in bus order
+             * @param length Length of buffer
+             * @returns Number of bytes read into buffer, 0 if the read failed
+             */
+            static std::size_t read_register(int adapter, int address, uint_fast8_t command, uint_fast8_t* buffer, std::size_t length);
+            /**
+             * Write a device register.
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param address Address of the I2C device on the bus
+             * @param command Register address, sent as the command byte
+             * @param[out] buffer Array of bytes to write to the register, in bus order
+             * @param length Length of buffer
+             * @returns Number of bytes written from buffer, 0 if the write failed
+             */
+            static std::size_t write_register(int adapter, int address, uint_fast8_t command, const uint_fast8_t* buffer, std::size_t length);
+            //@}
+
+            /**
+             * Check whether a device acknowledges an address.
+             * Probes the way i2cdetect does: with an SMBus quick write, except at 0x30-0x37 and 0x50-0x5F,
+             * where EEPROMs may latch a quick write as a write command, which get a one-byte read instead.
+             * Falls back to whichever of the two the adapter supports, then to a one-byte I2C read.
+             * @see i2cpp::Discovery
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param address Address to probe
+             * @returns True if a device acknowledged, false otherwise
+             */
+            static bool probe(int adapter, int address);
+
+            /**
+             * Get a snapshot of every adapter's traffic statistics.
+             * Transactions, bytes, address switches, short transfers, errors by errno and latency histograms
+             * are counted per adapter and per device address with lock-free counters.
+             * @note Statistics are compiled out when the library is built with I2CPP_NO_STATISTICS defined,
+             * in which case this returns an empty vector
+             *
+             * @returns One snapshot per open adapter
+             */
+            static std::vector<AdapterStatistics> get_statistics();
+            /**
+             * Get every adapter's traffic statistics as text.
+             * @see get_statistics()
+             * @see i2cpp::format_statistics()
+             *
+             * @returns Human-readable statistics, one block per adapter
+             */
+            static std::string dump_statistics();
+            /** Reset every adapter's traffic statistics to zero. */
+            static void reset_statistics();
+            /**
+             * Get how long each priority class has waited for an adapter.
+             * Counted whether or not statistics are compiled in.
+             * @see i2cpp::PriorityScope
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @returns One snapshot per BusPriority, most urgent first
+             */
+            static std::vector<ArbitrationStatistics> get_arbitration(int adapter);
+            /**
+             * Reset an adapter's wait-time metrics to zero.
+             * @param adapter File Descriptor of the desired I2C Adapter
+             */
+            static void reset_arbitration(int adapter);
 
         private:
+            /**
+             * State owned by a single open adapter.
+             * Adapter objects are never moved or freed while the library is loaded, so a pointer to one
+             * stays valid for every thread that looked it up.
+             */
+            struct Adapter
+            {
+                /** Backend carrying this adapter's transactions */
+                Transport::SharedPtr transport;
+                /**
+                 * Serializes every transaction on this adapter, most urgent class first.
+                 * Selecting an address and transferring to it happen under the same lock,
+                 * so a thread can never send to another thread's device.
+                 */
+                Arbiter mutex;
+                /**
+                 * The adapter's currently set I2C address, or -1 if unknown.
+                 * Since ioctl is wierd, we have to reconfigure IO each time we want to send to a different address.
+                 * This keeps track of the previously addressed device to avoid resetting every time.
+                 */
+                int address;
+                /** I2C_FUNC_* capabilities, probed once when the adapter is registered */
+                unsigned long functionality;
+                /** True if Packet Error Checking is enabled */
+                bool pec;
+#ifndef I2CPP_NO_STATISTICS
+                /** Traffic statistics, updated under mutex but readable without it */
+                AdapterCounters counters;
+#endif
+
+                explicit Adapter(Transport::SharedPtr transport): transport(transport), address(-1), functionality(0), pec(false) {}
+            };
+            /** Number of File Descriptors resolved through the lock-free lookup table */
+            static constexpr int lookup_size = 1024;
+
             I2CPP();
             ~I2CPP();
             static I2CPP& instance();
 
+            /** Guards opening adapters and registering them in fds and adapters */
+            std::mutex open_mutex;
             /**
-             * Map of currently allocated File Descriptors
-             * Used to ensure only one instance of each file descriptor is used,
-             * then used to free each allocated fd
+             * Map of currently open adapters' handles by filename
+             * Used to ensure only one instance of each adapter is used
              */
             std::map<std::string, int> fds;
+            /** Owner of every Adapter (and through it, every Transport), keyed by handle */
+            std::map<int, std::unique_ptr<Adapter>> adapters;
             /**
-             * Map of each File Descriptor's currently set I2C address.
-             * Since ioctl is wierd, we have to reconfigure IO each time we want to send to a different address.
-             * This map keeps track of the previously addressed device to avoid resetting every time.
+             * Direct-mapped view of adapters for File Descriptors below lookup_size.
+             * Entries are only ever set once, so the hot path reads them without taking open_mutex.
              */
-            std::map<int, uint_fast8_t> regs;
+            std::atomic<Adapter*> lookup[lookup_size];
 
+            Adapter& _adapter(int fd);
+            Adapter& _register(int handle, Transport::SharedPtr transport);
             std::size_t _read(int adapter, int address, uint_fast8_t* buffer, std::size_t length);
             std::size_t _write(int adapter, int address, uint_fast8_t* buffer, std::size_t length);
-            void _set_address(int bus, int address);
+            bool _transfer(int adapter, Message* messages, std::size_t count);
+            static std::size_t _transaction_length(const std::vector<Message>& messages, std::size_t index);
+            static RegisterPath _register_path(const Adapter& adapter, std::size_t length, bool read);
+            bool _probe(int adapter, int address);
+            std::size_t _read_register(int adapter, int address, uint_fast8_t command, uint_fast8_t* buffer, std::size_t length);
+            std::size_t _write_register(int adapter, int address, uint_fast8_t command, const uint_fast8_t* buffer, std::size_t length);
+            bool _set_address(Adapter& adapter, int address);
+            static uint64_t _clock();
     };
 }
 
@@ -0,0 +1,128 @@
+/**
+ * @file input_watcher.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_INPUT_WATCHER_HPP
+#define I2CPP_INPUT_WATCHER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "i2cpp/devices/pca9555.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Interrupt driven input change notification for PCA9555 expanders.
+     * Instead of polling read_input(), an InputWatcher waits with epoll on the file descriptors
+     * signalling each expander's INT output, typically a GPIO character device line-event fd.
+     * When one becomes readable, only the expanders wired to that line are read, and any changed
+     * bits are delivered to their callbacks.
+     *
+     * Any readable file descriptor can act as an interrupt line, such as an eventfd in tests.
+     * Expanders on several buses can share one watcher and its single event loop thread.
+     */
+    class InputWatcher
+    {
+        public:
+            /**
+             * Handler for input changes.
+             * Runs on the event loop thread, without the watcher's locks held, so it may call watch() and unwatch().
+             *
+             * @param device The expander whose inputs changed
+             * @param state The new 16-bit input state
+             * @param changed Bitmask of the inputs which changed since the last notification
+             */
+            using Callback = std::function<void(PCA9555& device, uint_fast16_t state, uint_fast16_t changed)>;
+
+            InputWatcher();
+            /** Stops the event loop thread and releases the epoll instance. */
+            ~InputWatcher();
+            InputWatcher(InputWatcher const&) = delete;
+            void operator=(InputWatcher const&) = delete;
+
+            /**
+             * Watch an expander whose INT output is signalled by a file descriptor.
+             * Several expanders may share one file descriptor when their INT outputs are wired together.
+             * The expander's inputs are read once to establish the initial state. If that read fails, the first
+             * successful read after an interrupt becomes the initial state instead, without a notification.
+             * An expander which cannot be read when its line fires is skipped, keeping its last state.
+             * @note The file descriptor is not owned, and must stay open while it is watched
+             *
+             * @param line File descriptor which becomes readable on an interrupt edge
+             * @param device The expander to read when the line fires
+             * @param callback Handler for the expander's input changes
+             * @returns True if successful, false if the line could not be added to epoll
+             */
+            bool watch(int line, PCA9555::SharedPtr device, Callback callback);
+            /**
+             * Stop watching every expander on an interrupt line.
+             * @param line File descriptor previously passed to watch()
+             */
+            void unwatch(int line);
+
+            /**
+             * Start the event loop on a dedicated thread.
+             * @returns True if the thread was started, false if it was already running
+             */
+            bool start();
+            /** Stop the event loop thread, waiting for it to exit. */
+            void stop();
+            /**
+             * Wait for interrupts and dispatch them on the calling thread.
+             * For applications running their own loop instead of calling start().
+             *
+             * @param timeout Maximum time to wait in milliseconds, -1 to wait forever
+             * @returns Number of interrupt lines handled
+             */
+            std::size_t poll(int timeout);
+
+        private:
+            /** A watched expander and its last reported input state */
+            struct Entry
+            {
+                PCA9555::SharedPtr device;
+                Callback callback;
+                uint_fast16_t state;
+                /** False until the inputs have been read successfully */
+                bool known;
+            };
+            /** A notification collected under a line's lock, delivered after releasing it */
+            struct Change
+            {
+                PCA9555::SharedPtr device;
+                Callback callback;
+                uint_fast16_t state;
+                uint_fast16_t changed;
+            };
+            /** All expanders sharing one interrupt line */
+            struct Line
+            {
+                int fd;
+                std::mutex mutex;
+                std::vector<Entry> entries;
+            };
+
+            void run();
+            void dispatch(Line& line);
+
+            /** The epoll instance */
+            int epoll_fd;
+            /** eventfd used to wake the event loop when stopping */
+            int stop_fd;
+            /** Guards lines */
+            std::mutex lines_mutex;
+            /** Watched interrupt lines, keyed by file descriptor */
+            std::map<int, std::shared_ptr<Line>> lines;
+            std::thread thread;
+            bool running;
+    };
+}
+
+#endif //I2CPP_INPUT_WATCHER_HPP
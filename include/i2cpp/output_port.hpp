@@ -0,0 +1,161 @@
+/**
+ * @file output_port.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_OUTPUT_PORT_HPP
+#define I2CPP_OUTPUT_PORT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "i2cpp/devices/pca9555.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief One wide logical output port spanning several PCA9555 expanders.
+     * Pin n of the port is output pin n % 16 of expander n / 16, in the order the expanders were
+     * given. Pins are changed in memory with set, clear and assign operations over single pins, ranges
+     * or masks, and sent with apply().
+     *
+     * apply() compares the port against the outputs last written, 64 pins at a time, and writes only
+     * the expanders whose output word changed. The writes of each adapter are packed into one
+     * i2cpp::I2CPP::submit_batch() call, and the adapters are written in parallel, so updating the whole
+     * machine costs about one transaction per bus.
+     *
+     * Bits are stored as 64-bit words, four expanders to a word. Masks and values passed to the
+     * mask operations use the same layout, words() words long.
+     * @note A port is not thread-safe; use it from one thread, or lock around it
+     */
+    class OutputPort
+    {
+        public:
+            /**
+             * Create a port over a set of expanders, reading their current outputs.
+             * @param devices The expanders, in pin order
+             */
+            explicit OutputPort(const std::vector<PCA9555::SharedPtr>& devices);
+            OutputPort(OutputPort const&) = delete;
+            void operator=(OutputPort const&) = delete;
+
+            /** @returns Number of pins, 16 per expander */
+            std::size_t size() const;
+            /** @returns Number of 64-bit words in the port's masks */
+            std::size_t words() const;
+
+            /**
+             * Get a pin's pending level.
+             * @param pin Port pin number
+             * @returns True for high
+             */
+            bool get(std::size_t pin) const;
+            /**
+             * Set a pin's level. Pins past the end of the port are ignored.
+             * @param pin Port pin number
+             * @param value True for high
+             */
+            void set(std::size_t pin, bool value = true);
+            /**
+             * Set a pin low.
+             * @param pin Port pin number
+             */
+            void clear(std::size_t pin);
+            /**
+             * Set every pin of a range to one level.
+             * @param start_pin Start of the range, inclusive
+             * @param end_pin End of the range, exclusive
+             * @param value True for high
+             */
+            void set_range(std::size_t start_pin, std::size_t end_pin, bool value = true);
+            /**
+             * Set up to 64 pins of a range from a bitmask.
+             * The given bitmask is applied with the Least Significant Bit mapped to start_pin.
+             * @param start_pin Start of the range, inclusive
+             * @param end_pin End of the range, exclusive, at most 64 pins after start_pin
+             * @param values Bitmask of levels
+             */
+            void assign_range(std::size_t start_pin, std::size_t end_pin, uint64_t values);
+            /**
+             * Set every pin selected by a mask high.
+             * @param mask Selected pins, words() words long
+             */
+            void set_mask(const std::vector<uint64_t>& mask);
+            /**
+             * Set every pin selected by a mask low.
+             * @param mask Selected pins, words() words long
+             */
+            void clear_mask(const std::vector<uint64_t>& mask);
+            /**
+             * Copy the levels of the pins selected by a mask.
+             * @param mask Selected pins, words() words long
+             * @param values Levels for the selected pins, words() words long
+             */
+            void assign_mask(const std::vector<uint64_t>& mask, const std::vector<uint64_t>& values);
+            /**
+             * Replace every pin's level.
+             * @param values Levels, words() words long
+             */
+            void assign(const std::vector<uint64_t>& values);
+            /** @returns Every pin's pending level, words() words long */
+            const std::vector<uint64_t>& get_bits() const;
+
+            /**
+             * Write the expanders whose pins changed since the last apply().
+             * Expanders which fail keep their pending levels and are retried by the next apply().
+             * @note apply() waits on Executor threads when several adapters change, so it must not be called from one
+             * @returns True if every changed expander was written, false otherwise
+             */
+            bool apply();
+            /** @returns Number of expanders with pins changed since the last apply() */
+            std::size_t pending() const;
+            /**
+             * Reload every expander's output register, discarding pending changes.
+             * @returns True if every expander was read, false otherwise
+             */
+            bool resync();
+            /** Forget the written outputs, so the next apply() writes every expander. */
+            void invalidate();
+
+        private:
+            /** Expanders packed into each word */
+            static const std::size_t lane_width = 4;
+
+            /** An adapter's expanders, and the messages reused to write them */
+            struct Bus
+            {
+                int adapter;
+                /** True if the adapter can batch plain I2C writes */
+                bool batch;
+                /** Expanders changed in the current apply() */
+                std::vector<std::size_t> changed;
+                /** Nonzero for each changed expander written successfully */
+                std::vector<uint8_t> written;
+                std::vector<Message> messages;
+                std::vector<uint_fast8_t> buffers;
+            };
+
+            static uint_fast16_t word(const std::vector<uint64_t>& bits, std::size_t device);
+            void trim();
+            void write_bus(Bus& bus);
+
+            std::vector<PCA9555::SharedPtr> devices;
+            /** Bus of each expander */
+            std::vector<std::size_t> bus_of;
+            std::vector<Bus> buses;
+            /** Levels to apply */
+            std::vector<uint64_t> desired;
+            /** Levels on the boards, as last written or read */
+            std::vector<uint64_t> written;
+
+            std::mutex mutex;
+            std::condition_variable done;
+            /** Adapters still writing during apply() */
+            std::size_t remaining;
+    };
+}
+
+#endif //I2CPP_OUTPUT_PORT_HPP
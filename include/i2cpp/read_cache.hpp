@@ -0,0 +1,137 @@
+/**
+ * @file read_cache.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_READ_CACHE_HPP
+#define I2CPP_READ_CACHE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+namespace i2cpp
+{
+    /** @brief Snapshot of the ReadCache counters */
+    struct ReadCacheStatistics
+    {
+        /** Reads answered from a completed read no older than the caller's max age */
+        uint64_t hits;
+        /** Reads which joined another thread's read already in flight */
+        uint64_t coalesced;
+        /** Reads which went to the bus */
+        uint64_t misses;
+        /** Cached results dropped because their device was written */
+        uint64_t invalidations;
+    };
+
+    /**
+     * @brief Single-flight register reads with a shared result cache.
+     * A singleton shared by every i2cpp::Device with its read cache enabled, keyed by adapter, device
+     * address and register, so separate Device objects for one chip share their reads too.
+     * Concurrent reads of one register make a single bus transaction, whose result every caller
+     * receives. Completed results are kept, and reused by any later read which accepts their age.
+     * Writes through i2cpp::Device drop the written device's results.
+     * Entries are striped by adapter, each stripe with its own lock, so threads reading devices on
+     * different adapters do not contend.
+     * @see i2cpp::Device::set_read_cache()
+     */
+    class ReadCache
+    {
+        public:
+            ReadCache(ReadCache const&) = delete;
+            void operator=(ReadCache const&) = delete;
+
+            /**
+             * Read a device register, sharing the transaction with concurrent readers.
+             * A caller joining a read in flight receives that read's result, which may have started
+             * slightly before the call.
+             * @see i2cpp::I2CPP::read_register()
+             *
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param address Address of the I2C device on the bus
+             * @param command Register address, sent as the command byte
+             * @param[in] buffer Array of bytes to read the register into, in bus order
+             * @param length Length of buffer
+             * @param max_age Oldest completed result to accept, in nanoseconds. 0 only shares reads in flight
+             * @returns Number of bytes read into buffer, 0 if the read failed
+             */
+            static std::size_t read(int adapter, int address, uint_fast8_t command, uint_fast8_t* buffer, std::size_t length, uint64_t max_age);
+            /**
+             * Drop every cached result of a device, such as after writing to it.
+             * Every register is dropped, since a write may change other registers than its own.
+             * Costs a single atomic load until the cache is first used.
+             * @param adapter File Descriptor of the desired I2C Adapter
+             * @param address Address of the I2C device on the bus
+             */
+            static void invalidate(int adapter, int address);
+            /** Drop every cached result. */
+            static void clear();
+
+            /**
+             * Get a snapshot of the cache counters.
+             * @returns Counts of hits, coalesced reads, misses and invalidations
+             */
+            static ReadCacheStatistics get_statistics();
+            /** Reset the cache counters to zero. */
+            static void reset_statistics();
+
+        private:
+            /** Largest register cached, longer reads go straight to the bus */
+            static constexpr std::size_t max_length = 32;
+
+            /** Latest read of one register, guarded by mutex */
+            struct Entry
+            {
+                /** Signalled when a read in flight completes */
+                std::condition_variable done;
+                /** True while a thread is reading the register */
+                bool in_flight;
+                /** Completions so far, for waiters to spot the read they joined finishing */
+                uint64_t generation;
+                /** Invalidations so far, a read spanning one is not cached */
+                uint64_t epoch;
+                /** True if data holds a successful read which has not been invalidated */
+                bool valid;
+                /** Monotonic time the latest read completed, in nanoseconds */
+                uint64_t finished;
+                /** Length of the latest read */
+                std::size_t length;
+                /** Bytes returned by the latest read */
+                std::size_t result;
+                uint_fast8_t data[max_length];
+
+                Entry();
+            };
+
+            /** Number of stripes the entries are split over */
+            static constexpr std::size_t shard_count = 16;
+
+            /**
+             * Entries of the adapters whose handle falls in one stripe, with their own lock and counters.
+             * Aligned to a cache line, so threads on different adapters share neither a lock nor a line.
+             */
+            struct alignas(64) Shard
+            {
+                std::mutex mutex;
+                std::map<uint64_t, Entry> entries;
+                ReadCacheStatistics statistics;
+
+                Shard();
+            };
+
+            ReadCache();
+            static ReadCache& instance();
+            static Shard& shard(int adapter);
+            static uint64_t key(int adapter, int address, uint_fast8_t command);
+
+            Shard shards[shard_count];
+            /** Set once anything is cached, so invalidations are free before then */
+            std::atomic<bool> active;
+    };
+}
+
+#endif //I2CPP_READ_CACHE_HPP
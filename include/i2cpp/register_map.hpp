@@ -0,0 +1,136 @@
+/**
+ * @file register_map.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_REGISTER_MAP_HPP
+#define I2CPP_REGISTER_MAP_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+namespace i2cpp
+{
+    /** Byte order of a multi-byte register on the bus */
+    enum class Endian
+    {
+        /** Least significant byte first */
+        LITTLE,
+        /** Most significant byte first */
+        BIG
+    };
+    /** Which directions a register may be accessed in */
+    enum class Access
+    {
+        READ_ONLY,
+        WRITE_ONLY,
+        READ_WRITE
+    };
+
+    /**
+     * @brief Compile-time description of a device register.
+     * Drivers describe each register as a type, then read and write it through
+     * i2cpp::Device::read_register() and i2cpp::Device::write_register(). Everything about the register
+     * is a template parameter, so transfers use fixed-size stack buffers and encoding is unrolled into
+     * shifts, with no runtime lookup.
+     *
+     * @tparam Address Register address, written as the command byte before the register's data
+     * @tparam Width Register size in bytes, 1 to 4
+     * @tparam Order Byte order of the register's data on the bus
+     * @tparam Mode Directions the register may be accessed in
+     */
+    template<uint_fast8_t Address, std::size_t Width, Endian Order, Access Mode = Access::READ_WRITE>
+    struct Register
+    {
+        static_assert(Width >= 1 && Width <= 4, "Registers must be 1 to 4 bytes wide");
+
+        /** Smallest fast unsigned type holding the register */
+        using value_type = typename std::conditional<(Width == 1), uint_fast8_t,
+            typename std::conditional<(Width == 2), uint_fast16_t, uint_fast32_t>::type>::type;
+
+        static constexpr uint_fast8_t address = Address;
+        static constexpr std::size_t width = Width;
+        static constexpr Endian endian = Order;
+        static constexpr Access access = Mode;
+        static constexpr bool readable = Mode != Access::WRITE_ONLY;
+        static constexpr bool writable = Mode != Access::READ_ONLY;
+        /** Bitmask of every bit in the register */
+        static constexpr value_type mask = value_type(Width == 4 ? 0xffffffffu : (1u << (8 * Width)) - 1);
+
+        /**
+         * Decode the register's bytes as received from the bus.
+         * @param bytes Array of width bytes
+         * @returns The register value
+         */
+        static value_type decode(const uint_fast8_t* bytes)
+        {
+            value_type value = 0;
+            for(std::size_t i = 0; i < Width; i++) {
+                value |= value_type(value_type(bytes[i] & 0xff) << (8 * (Order == Endian::BIG ? Width - 1 - i : i)));
+            }
+            return value;
+        }
+        /**
+         * Encode a register value as sent on the bus.
+         * @param value The register value
+         * @param[in] bytes Array of width bytes to fill
+         */
+        static void encode(value_type value, uint_fast8_t* bytes)
+        {
+            for(std::size_t i = 0; i < Width; i++) {
+                bytes[i] = uint_fast8_t((value >> (8 * (Order == Endian::BIG ? Width - 1 - i : i))) & 0xff);
+            }
+        }
+    };
+
+    /**
+     * @brief Compile-time description of a bit field within a register.
+     * @tparam Reg The i2cpp::Register containing the field
+     * @tparam Offset Position of the field's least significant bit
+     * @tparam Bits Width of the field in bits
+     * @tparam T Type the field decodes to, such as an enum class
+     */
+    template<typename Reg, unsigned Offset, unsigned Bits, typename T = typename Reg::value_type>
+    struct Field
+    {
+        static_assert(Bits >= 1 && Offset + Bits <= 8 * Reg::width, "Field does not fit in its register");
+
+        using register_type = Reg;
+        using value_type = T;
+
+        static constexpr unsigned offset = Offset;
+        static constexpr unsigned bits = Bits;
+        /** Bitmask of the field's bits within the register */
+        static constexpr typename Reg::value_type mask =
+            typename Reg::value_type(((Bits == 32 ? 0xffffffffu : (1u << Bits) - 1)) << Offset);
+
+        /**
+         * Extract the field from a register value.
+         * @param reg The register value
+         * @returns The field's value
+         */
+        static constexpr T get(typename Reg::value_type reg) { return T((reg & mask) >> Offset); }
+        /**
+         * Replace the field in a register value.
+         * @param reg The register value
+         * @param value The field's new value
+         * @returns The register value with the field replaced
+         */
+        static constexpr typename Reg::value_type set(typename Reg::value_type reg, T value)
+        {
+            return typename Reg::value_type((reg & ~mask) | ((typename Reg::value_type(value) << Offset) & mask));
+        }
+        /**
+         * Encode the field alone, with every other bit clear.
+         * @param value The field's value
+         * @returns Register value with only this field set
+         */
+        static constexpr typename Reg::value_type make(T value)
+        {
+            return typename Reg::value_type((typename Reg::value_type(value) << Offset) & mask);
+        }
+    };
+}
+
+#endif //I2CPP_REGISTER_MAP_HPP
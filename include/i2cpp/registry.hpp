@@ -0,0 +1,304 @@
+/**
+ * @file registry.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_REGISTRY_HPP
+#define I2CPP_REGISTRY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "i2cpp/bus_group.hpp"
+
+namespace i2cpp
+{
+    /** @brief Kinds of device a DeviceRegistry can hold */
+    enum class DeviceType
+    {
+        PCA9555,
+        ADS1115
+    };
+
+    /** @brief Description of one device for a DeviceRegistry */
+    struct DeviceSpec
+    {
+        DeviceType type;
+        /** Path to the I2C device file, or name of an attached adapter */
+        std::string bus;
+        /** Address of the device on the I2C network */
+        uint_fast8_t address;
+        /** Initial configuration register: PCA9555 pin directions, or the ADS1115 config word */
+        uint_fast16_t config;
+        /** Initial PCA9555 polarity inversion register, unused for ADS1115 */
+        uint_fast16_t polarity;
+        /** Initial PCA9555 output register, unused for ADS1115 */
+        uint_fast16_t output;
+
+        /**
+         * Describe a device with its power-on register values.
+         * @param type Kind of device
+         * @param bus Path to the I2C device file, or name of an attached adapter
+         * @param address Address of the device on the I2C network
+         */
+        DeviceSpec(DeviceType type, const std::string& bus, uint_fast8_t address);
+    };
+
+    /**
+     * @brief Flat storage for a large fleet of devices, built from a declarative description.
+     * Instead of one heap-allocated Device object per chip, a registry keeps each type's state in
+     * contiguous per-field arrays and hands out lightweight handles, which are an index and a pointer
+     * back to the registry. Each distinct bus is opened once, however many devices it carries.
+     *
+     * configure() writes every device's initial registers in one i2cpp::I2CPP::submit_batch() pass per
+     * adapter, all adapters in parallel, and sweep() refreshes every input and conversion through an
+     * i2cpp::BusGroup.
+     *
+     * Handles cache the registers the host writes, so pin writes cost a single bus write.
+     * @note A registry is not thread-safe; use it and its handles from one thread, or lock around them
+     *
+     * @code
+     * std::vector<DeviceSpec> specs;
+     * DeviceRegistry::load("/etc/fleet.conf", specs);
+     * DeviceRegistry fleet;
+     * fleet.build(specs);
+     * fleet.expander(0).write_output_pin(3, true);
+     * @endcode
+     */
+    class DeviceRegistry
+    {
+        public:
+            /** @brief Handle to a PCA9555 held in a DeviceRegistry */
+            class Expander
+            {
+                public:
+                    Expander(DeviceRegistry& registry, std::size_t index);
+
+                    /** @returns Index of the expander in its registry */
+                    std::size_t get_index() const;
+                    /** @returns File Descriptor of the expander's adapter, -1 if its bus could not be opened */
+                    int get_adapter() const;
+                    /** @returns Address of the expander on the I2C network */
+                    uint_fast8_t get_address() const;
+                    /** @returns True if configure() succeeded for this expander */
+                    bool is_configured() const;
+
+                    /**
+                     * Read the 16-bit input from the board.
+                     * @returns The input, or the last input read if the read failed
+                     */
+                    uint_fast16_t read_input();
+                    /** @returns The input as of the last read_input() or sweep() */
+                    uint_fast16_t get_input() const;
+
+                    /** @returns The output register as last written */
+                    uint_fast16_t get_output() const;
+                    /** @returns The polarity register as last written */
+                    uint_fast16_t get_polarity() const;
+                    /** @returns The configuration register as last written */
+                    uint_fast16_t get_config() const;
+
+                    /**
+                     * Write the output register.
+                     * @param data 16-bit output bitmask
+                     * @returns True if successful, false otherwise
+                     */
+                    bool write_output(uint_fast16_t data);
+                    /**
+                     * Write one output pin, with a single bus write.
+                     * @param pin Pin number, 0 to 15
+                     * @param value True for high
+                     * @returns True if successful, false otherwise
+                     */
+                    bool write_output_pin(uint_fast8_t pin, bool value);
+                    /**
+                     * Write the polarity inversion register.
+                     * @param data 16-bit polarity bitmask
+                     * @returns True if successful, false otherwise
+                     */
+                    bool write_polarity(uint_fast16_t data);
+                    /**
+                     * Write the configuration register.
+                     * @param data 16-bit direction bitmask, 1 for input
+                     * @returns True if successful, false otherwise
+                     */
+                    bool write_config(uint_fast16_t data);
+
+                private:
+                    DeviceRegistry* registry;
+                    std::size_t index;
+            };
+
+            /** @brief Handle to an ADS1115 held in a DeviceRegistry */
+            class Converter
+            {
+                public:
+                    Converter(DeviceRegistry& registry, std::size_t index);
+
+                    /** @returns Index of the converter in its registry */
+                    std::size_t get_index() const;
+                    /** @returns File Descriptor of the converter's adapter, -1 if its bus could not be opened */
+                    int get_adapter() const;
+                    /** @returns Address of the converter on the I2C network */
+                    uint_fast8_t get_address() const;
+                    /** @returns True if configure() succeeded for this converter */
+                    bool is_configured() const;
+
+                    /**
+                     * Read the latest conversion result from the board.
+                     * @returns The raw result, or the last result read if the read failed
+                     */
+                    int_fast16_t read_conversion();
+                    /** @returns The raw result as of the last read_conversion() or sweep() */
+                    int_fast16_t get_conversion() const;
+                    /**
+                     * Convert a raw conversion result to volts with the configured gain.
+                     * @param value Raw conversion result
+                     * @returns Voltage
+                     */
+                    double to_volts(int_fast16_t value) const;
+
+                    /** @returns The configuration register as last written, without the status bit */
+                    uint_fast16_t get_config() const;
+                    /**
+                     * Write the configuration register.
+                     * @see ADS1115::Config::to_register()
+                     * @param data 16-bit configuration word
+                     * @returns True if successful, false otherwise
+                     */
+                    bool write_config(uint_fast16_t data);
+
+                private:
+                    DeviceRegistry* registry;
+                    std::size_t index;
+            };
+
+            DeviceRegistry();
+            DeviceRegistry(DeviceRegistry const&) = delete;
+            void operator=(DeviceRegistry const&) = delete;
+
+            /**
+             * Read a fleet description.
+             * One device per line as "type bus address [config=N] [polarity=N] [output=N]", where type is
+             * pca9555 or ads1115 and numbers may be decimal or 0x-prefixed hexadecimal. Omitted registers
+             * keep their power-on values. Blank lines and lines starting with # are ignored.
+             * @code
+             * # Relay boards
+             * pca9555 /dev/i2c-1 0x20 config=0x00ff output=0x0000
+             * ads1115 /dev/i2c-1 0x48 config=0x4483
+             * @endcode
+             *
+             * @param path Path of the description file
+             * @param[in] specs Receives the devices, in file order
+             * @returns True if successful, false if the file is missing or a line is malformed
+             */
+            static bool load(const std::string& path, std::vector<DeviceSpec>& specs);
+
+            /**
+             * Add a device without configuring it.
+             * @param spec The device
+             * @returns Index of the device among those of its type
+             */
+            std::size_t add(const DeviceSpec& spec);
+            /**
+             * Add a fleet, grouped per adapter, and configure() it.
+             * Devices are stored bus by bus, in their order within each bus, so one adapter's state is contiguous.
+             * @param specs The devices
+             * @returns True if every device was configured, false otherwise
+             */
+            bool build(const std::vector<DeviceSpec>& specs);
+            /**
+             * Write every device's registers as last set, one batched pass per adapter, all adapters in parallel.
+             * Expanders are written polarity, output, then configuration, so pins switched to output mode
+             * already drive their initial level.
+             * @note configure() waits on Executor threads, so it must not be called from one
+             * @returns True if every device was configured, false otherwise
+             */
+            bool configure();
+            /**
+             * Read every expander's input and every converter's conversion result, all adapters in parallel.
+             * Devices which cannot be read keep their previous value.
+             * @note sweep() waits on Executor threads, so it must not be called from one
+             * @returns True if every device was read, false otherwise
+             */
+            bool sweep();
+
+            /** @returns Number of expanders */
+            std::size_t expanders() const;
+            /** @returns Number of converters */
+            std::size_t converters() const;
+            /**
+             * Get a handle to an expander.
+             * @param index Index of the expander, as returned by add()
+             * @returns The handle
+             */
+            Expander expander(std::size_t index);
+            /**
+             * Get a handle to a converter.
+             * @param index Index of the converter, as returned by add()
+             * @returns The handle
+             */
+            Converter converter(std::size_t index);
+            /**
+             * Find a device by its bus and address.
+             * @param type Kind of device
+             * @param bus Bus the device was added with
+             * @param address Address of the device on the I2C network
+             * @returns Index of the device among those of its type, or size_t(-1) if not found
+             */
+            std::size_t find(DeviceType type, const std::string& bus, uint_fast8_t address) const;
+
+        private:
+            /** Per-field arrays of every expander */
+            struct Expanders
+            {
+                std::vector<int> adapters;
+                std::vector<uint_fast8_t> addresses;
+                std::vector<uint16_t> inputs;
+                std::vector<uint16_t> outputs;
+                std::vector<uint16_t> polarities;
+                std::vector<uint16_t> configs;
+                std::vector<uint8_t> configured;
+                /** BusGroup channel of each input port, invalid until the group is built */
+                std::vector<std::size_t> channels;
+            };
+            /** Per-field arrays of every converter */
+            struct Converters
+            {
+                std::vector<int> adapters;
+                std::vector<uint_fast8_t> addresses;
+                std::vector<int16_t> conversions;
+                std::vector<uint16_t> configs;
+                std::vector<uint8_t> configured;
+                std::vector<std::size_t> channels;
+            };
+
+            int open(const std::string& bus);
+            void configure_bus(int adapter);
+            bool write(int adapter, uint_fast8_t address, uint_fast8_t command, uint_fast16_t value, Endian endian);
+
+            Expanders expander_state;
+            Converters converter_state;
+            /** Adapter of each bus, so each one is opened only once */
+            std::map<std::string, int> buses;
+            /** Adapters in the order their first device was added */
+            std::vector<int> adapters;
+
+            /** Snapshot of every input and conversion, rebuilt when devices are added */
+            std::unique_ptr<BusGroup> group;
+            BusGroup::Frame frame;
+
+            std::mutex mutex;
+            std::condition_variable done;
+            /** Adapters still configuring during configure() */
+            std::size_t remaining;
+    };
+}
+
+#endif //I2CPP_REGISTRY_HPP
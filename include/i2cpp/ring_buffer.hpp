@@ -0,0 +1,114 @@
+/**
+ * @file ring_buffer.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_RING_BUFFER_HPP
+#define I2CPP_RING_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace i2cpp
+{
+    /**
+     * @brief Bounded single-producer, single-consumer queue.
+     * Storage is allocated once on construction, after which push() and pop() never allocate or lock.
+     * Exactly one thread may push and exactly one thread may pop at a time. The producer and consumer
+     * indices live on separate cache lines, and each side caches the other's index so the shared line
+     * is only touched when the queue looks full or empty.
+     */
+    template<typename T>
+    class RingBuffer
+    {
+        public:
+            /**
+             * Allocate the queue.
+             * @param capacity Minimum number of items the queue holds, rounded up to a power of two
+             */
+            explicit RingBuffer(std::size_t capacity) : head(0), tail_cache(0), tail(0), head_cache(0)
+            {
+                std::size_t size = 2;
+                while(size < capacity) {
+                    size <<= 1;
+                }
+                this->slots.resize(size);
+                this->mask = size - 1;
+            }
+            RingBuffer(RingBuffer const&) = delete;
+            void operator=(RingBuffer const&) = delete;
+
+            /**
+             * Append an item. Producer thread only.
+             * @param item The item to copy into the queue
+             * @returns True if the item was queued, false if the queue is full
+             */
+            bool push(const T& item)
+            {
+                std::size_t position = this->tail.load(std::memory_order_relaxed);
+                if(position - this->head_cache > this->mask)
+                {
+                    this->head_cache = this->head.load(std::memory_order_acquire);
+                    if(position - this->head_cache > this->mask) {
+                        return false;
+                    }
+                }
+                this->slots[position & this->mask] = item;
+                this->tail.store(position + 1, std::memory_order_release);
+                return true;
+            }
+            /**
+             * Remove items in bulk. Consumer thread only.
+             * @param[in] items Array to copy the oldest items into
+             * @param count Maximum number of items to remove
+             * @returns Number of items copied into items
+             */
+            std::size_t pop(T* items, std::size_t count)
+            {
+                std::size_t position = this->head.load(std::memory_order_relaxed);
+                if(this->tail_cache - position < count) {
+                    this->tail_cache = this->tail.load(std::memory_order_acquire);
+                }
+                std::size_t available = this->tail_cache - position;
+                if(available < count) {
+                    count = available;
+                }
+                for(std::size_t i = 0; i < count; i++) {
+                    items[i] = this->slots[(position + i) & this->mask];
+                }
+                this->head.store(position + count, std::memory_order_release);
+                return count;
+            }
+            /**
+             * Get the number of queued items. Exact only when called from the producer or consumer.
+             * @returns Number of items waiting to be popped
+             */
+            std::size_t size() const
+            {
+                return this->tail.load(std::memory_order_acquire) - this->head.load(std::memory_order_acquire);
+            }
+            /**
+             * Get the queue's capacity.
+             * @returns Maximum number of items queued at once
+             */
+            std::size_t capacity() const { return this->mask + 1; }
+
+        private:
+            static constexpr std::size_t cache_line = 64;
+
+            std::vector<T> slots;
+            std::size_t mask;
+            char pad0[cache_line];
+            /** Consumer side: next item to pop, and the last tail seen */
+            std::atomic<std::size_t> head;
+            std::size_t tail_cache;
+            char pad1[cache_line];
+            /** Producer side: next slot to fill, and the last head seen */
+            std::atomic<std::size_t> tail;
+            std::size_t head_cache;
+            char pad2[cache_line];
+    };
+}
+
+#endif //I2CPP_RING_BUFFER_HPP
@@ -0,0 +1,146 @@
+/**
+ * @file scheduler.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_SCHEDULER_HPP
+#define I2CPP_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "i2cpp/device.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Periodic sampling of many devices, one thread per I2C adapter.
+     * Tasks are registered with an adapter and a period. Every adapter's tasks run on that adapter's
+     * own thread, so they never contend with each other for the bus, while adapters run in parallel.
+     *
+     * Each thread sleeps until the earliest deadline on the monotonic steady clock, then runs
+     * every task due by then back to back, shortest period first. A task that is still running when its
+     * next deadline passes counts an overrun, and its missed periods are skipped rather than run late.
+     * Release jitter (how late each run starts) is kept in a log2 histogram per task.
+     */
+    class Scheduler
+    {
+        public:
+            /** Work to run once per period */
+            using Task = std::function<void()>;
+            /** Number of buckets in Statistics::jitter_histogram */
+            static constexpr std::size_t histogram_size = 32;
+
+            /** @brief Snapshot of a task's timing statistics */
+            struct Statistics
+            {
+                /** Number of times the task ran */
+                uint64_t runs;
+                /** Number of deadlines missed because the task or its adapter was still busy */
+                uint64_t overruns;
+                /** Largest release jitter seen, in nanoseconds */
+                uint64_t max_jitter;
+                /** Sum of every run's release jitter, in nanoseconds */
+                uint64_t total_jitter;
+                /**
+                 * Release jitter histogram.
+                 * Bucket 0 counts runs started less than 1ns late, bucket n counts runs started
+                 * between 2^(n-1) and 2^n nanoseconds late. The last bucket also counts anything later.
+                 */
+                uint64_t jitter_histogram[histogram_size];
+            };
+
+            Scheduler();
+            /** Stops every adapter thread. */
+            ~Scheduler();
+            Scheduler(Scheduler const&) = delete;
+            void operator=(Scheduler const&) = delete;
+
+            /**
+             * Register a periodic task on an adapter.
+             * @note Tasks must be added before start()
+             *
+             * @param adapter File Descriptor of the I2C Adapter the task uses
+             * @param period Time between the starts of consecutive runs
+             * @param task Work to run
+             * @returns Task identifier for get_statistics(), or -1 if the scheduler is running
+             */
+            int add_task(int adapter, std::chrono::nanoseconds period, Task task);
+            /**
+             * Register a periodic task for a device, on the device's adapter.
+             * @see add_task(int, std::chrono::nanoseconds, Task)
+             *
+             * @param device The device the task uses
+             * @param period Time between the starts of consecutive runs
+             * @param task Work to run
+             * @returns Task identifier for get_statistics(), or -1 if the scheduler is running
+             */
+            int add_task(const Device& device, std::chrono::nanoseconds period, Task task);
+
+            /**
+             * Start one thread per adapter, with every task's first deadline at the current time.
+             * @returns True if started, false if already running
+             */
+            bool start();
+            /**
+             * Stop every adapter thread.
+             * Sleeping threads wake at once, so this only waits for tasks already running to finish.
+             */
+            void stop();
+
+            /**
+             * Get a task's timing statistics.
+             * Safe to call while the scheduler is running.
+             *
+             * @param task Identifier returned by add_task()
+             * @returns Snapshot of the task's statistics, all zero for an unknown identifier
+             */
+            Statistics get_statistics(int task) const;
+
+        private:
+            /** A registered task, its next deadline and its statistics */
+            struct Entry
+            {
+                Task task;
+                int64_t period;
+                int64_t deadline;
+                std::atomic<uint64_t> runs;
+                std::atomic<uint64_t> overruns;
+                std::atomic<uint64_t> max_jitter;
+                std::atomic<uint64_t> total_jitter;
+                std::atomic<uint64_t> jitter_histogram[histogram_size];
+
+                Entry(Task task, int64_t period);
+                void record(int64_t jitter);
+            };
+            /** Every task on one adapter, run by one thread */
+            struct Group
+            {
+                std::vector<Entry*> entries;
+                std::thread thread;
+            };
+
+            void run(Group& group);
+            bool sleep_until(int64_t deadline);
+
+            /** Every task, indexed by identifier */
+            std::vector<std::unique_ptr<Entry>> entries;
+            /** Tasks grouped by adapter File Descriptor */
+            std::map<int, Group> groups;
+            std::atomic<bool> running;
+            /** Guards clearing running against the threads' sleeps */
+            std::mutex mutex;
+            /** Signalled by stop() to end every thread's sleep */
+            std::condition_variable wake;
+    };
+}
+
+#endif //I2CPP_SCHEDULER_HPP
@@ -0,0 +1,281 @@
+/**
+ * @file simulated_bus.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_SIMULATED_BUS_HPP
+#define I2CPP_SIMULATED_BUS_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+#include "i2cpp/transport.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Register-level model of a device on an i2cpp::SimulatedBus.
+     * The bus hands every message addressed to the device to write() or read(), one call per message.
+     * Calls are serialized by the bus, but models should lock their own state if tests change it from other threads.
+     */
+    class SimulatedDevice
+    {
+        public:
+            /** Convenience name to get a Shared Pointer */
+            using SharedPtr = std::shared_ptr<SimulatedDevice>;
+
+            virtual ~SimulatedDevice() = default;
+
+            /**
+             * Receive the bytes of a write message.
+             * @param buffer Bytes written by the master
+             * @param length Length of buffer
+             */
+            virtual void write(const uint_fast8_t* buffer, std::size_t length) = 0;
+            /**
+             * Supply the bytes of a read message.
+             * @param[in] buffer Array of bytes to fill
+             * @param length Length of buffer
+             */
+            virtual void read(uint_fast8_t* buffer, std::size_t length) = 0;
+    };
+
+    /**
+     * @brief Model of a PCA9555 16-bit I/O expander.
+     * Implements the eight byte registers with the command byte auto-incrementing within each register pair,
+     * polarity inversion, output pins reading back through the input port, and the INT output.
+     * @see i2cpp::PCA9555
+     */
+    class SimulatedPCA9555 : public SimulatedDevice
+    {
+        public:
+            /** Convenience name to get a Shared Pointer */
+            using SharedPtr = std::shared_ptr<SimulatedPCA9555>;
+
+            /** Construct in the power-on state: all pins inputs, outputs high, no inversion. */
+            SimulatedPCA9555();
+
+            /**
+             * Drive the levels of the pins from outside the chip.
+             * Only pins configured as inputs are affected. Changing an input asserts INT.
+             * @param levels Bitmask of pin levels
+             */
+            void set_pins(uint_fast16_t levels);
+            /**
+             * Get the levels of every pin, as seen from outside the chip.
+             * @returns Bitmask of pin levels: driven outputs, and external levels on inputs
+             */
+            uint_fast16_t get_pins() const;
+            /** @returns The output port registers */
+            uint_fast16_t get_output() const;
+            /** @returns The polarity inversion registers */
+            uint_fast16_t get_polarity() const;
+            /** @returns The configuration registers */
+            uint_fast16_t get_config() const;
+            /**
+             * Check the INT output.
+             * @returns True while an input has changed since the input port was last read
+             */
+            bool get_interrupt() const;
+            /**
+             * Signal a file descriptor when INT is asserted, such as an eventfd watched by i2cpp::InputWatcher.
+             * An 8-byte counter increment is written to the descriptor on every assertion.
+             * @param fd File descriptor to signal, -1 to disable
+             */
+            void set_interrupt_fd(int fd);
+
+            void write(const uint_fast8_t* buffer, std::size_t length) override;
+            void read(uint_fast8_t* buffer, std::size_t length) override;
+
+        private:
+            uint_fast16_t input() const;
+            void update_interrupt();
+
+            mutable std::mutex mutex;
+            /** Register selected by the command byte */
+            uint_fast8_t command;
+            uint_fast16_t output;
+            uint_fast16_t polarity;
+            uint_fast16_t config;
+            /** Levels driven onto input pins from outside */
+            uint_fast16_t external;
+            /** Input port value when it was last read */
+            uint_fast16_t last_input;
+            bool interrupt;
+            int interrupt_fd;
+    };
+
+    /**
+     * @brief Model of an ADS1115 16-bit analog-to-digital converter.
+     * Implements the pointer register and the big-endian conversion, config and threshold registers,
+     * the input multiplexer and gain amplifier, and single-shot and continuous conversion modes.
+     * Conversions are instantaneous unless realtime conversions are enabled, in which case they take
+     * as long as the configured data rate would on the real chip.
+     */
+    class SimulatedADS1115 : public SimulatedDevice
+    {
+        public:
+            /** Convenience name to get a Shared Pointer */
+            using SharedPtr = std::shared_ptr<SimulatedADS1115>;
+
+            /** Construct in the power-on state. */
+            SimulatedADS1115();
+
+            /**
+             * Set the voltage on an analog input, relative to GND.
+             * @param channel Input number, 0 to 3
+             * @param volts Voltage on the input
+             */
+            void set_input(uint_fast8_t channel, double volts);
+            /**
+             * Make conversions take real time, according to the configured data rate.
+             * @param realtime True for realistic conversion times, false for instantaneous conversions
+             */
+            void set_realtime(bool realtime);
+            /**
+             * Get the number of conversions completed.
+             * @returns Conversions completed since construction
+             */
+            uint64_t get_conversions() const;
+
+            void write(const uint_fast8_t* buffer, std::size_t length) override;
+            void read(uint_fast8_t* buffer, std::size_t length) override;
+
+        private:
+            int64_t conversion_time() const;
+            int_fast16_t convert() const;
+            void update();
+
+            mutable std::mutex mutex;
+            /** Register selected by the pointer register */
+            uint_fast8_t pointer;
+            /** Conversion, config, lo_thresh and hi_thresh registers */
+            uint_fast16_t registers[4];
+            double inputs[4];
+            bool realtime;
+            /** True while a single-shot conversion is in progress */
+            bool converting;
+            /** Monotonic time, in nanoseconds, at which the current conversion completes */
+            int64_t ready_at;
+            uint64_t conversions;
+    };
+
+    /**
+     * @brief In-memory I2C bus, usable as an adapter with i2cpp::I2CPP::attach_adapter().
+     * Messages are routed to SimulatedDevice models by address. Unoccupied addresses NACK, as do
+     * occupied addresses with a forced NACK. Every call and the bus time it would take are counted,
+     * and with a clock rate set, calls can optionally take that long in real time.
+     *
+     * The adapter's capabilities can be restricted to model SMBus-only controllers, whose SMBus
+     * transactions are emulated as the equivalent I2C messages.
+     *
+     * This makes it possible to test and benchmark the library, and to reproduce bus load scenarios,
+     * without any I2C hardware.
+     */
+    class SimulatedBus : public Transport
+    {
+        public:
+            /** Convenience name to get a Shared Pointer */
+            using SharedPtr = std::shared_ptr<SimulatedBus>;
+
+            /** @brief Traffic counters for a SimulatedBus */
+            struct Statistics
+            {
+                /** Transport calls, each one standing in for a system call */
+                uint64_t calls;
+                /** Calls to set_address(), each one standing in for an I2C_SLAVE ioctl */
+                uint64_t address_changes;
+                /** Messages on the bus, each one beginning with a START */
+                uint64_t messages;
+                /** Bytes on the bus, including address bytes */
+                uint64_t bytes;
+                /** Messages whose address was not acknowledged */
+                uint64_t nacks;
+                /** Time the traffic would take at the configured clock rate, in nanoseconds */
+                uint64_t bus_time;
+            };
+
+            SimulatedBus();
+            /** Closes the bus's handle. */
+            ~SimulatedBus();
+            SimulatedBus(SimulatedBus const&) = delete;
+            void operator=(SimulatedBus const&) = delete;
+
+            /**
+             * Connect a device model to the bus.
+             * @param address Address of the device on the bus
+             * @param device The device model, replacing any already at that address
+             */
+            void attach(int address, SimulatedDevice::SharedPtr device);
+            /**
+             * Disconnect the device model at an address.
+             * @param address Address of the device on the bus
+             */
+            void detach(int address);
+            /**
+             * Force an address to NACK even if a device is attached.
+             * @param address Address of the device on the bus
+             * @param nack True to NACK every message to the address, false to respond normally
+             */
+            void set_nack(int address, bool nack);
+            /**
+             * Set the bus timing model.
+             * Each message costs a START, 9 clocks per byte including the address byte, and each call a STOP.
+             *
+             * @param clock_rate Bus clock in Hz, e.g. 100000 or 400000. 0 disables bus time accounting
+             * @param realtime True to make each call sleep for its bus time before returning, without holding a CPU
+             */
+            void set_clock(uint32_t clock_rate, bool realtime = false);
+            /**
+             * Set the capabilities the bus reports, as an I2C_FUNCS ioctl would.
+             * Without I2C_FUNC_I2C, transfers and plain reads and writes fail with EOPNOTSUPP, leaving only
+             * the SMBus transactions enabled in functionality.
+             * Takes effect for adapters attached afterwards, which probe capabilities when attached.
+             *
+             * @param functionality Bitmask of I2C_FUNC_* flags from linux/i2c.h.
+             *                      Defaults to I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL
+             */
+            void set_functionality(unsigned long functionality);
+
+            /**
+             * Get the bus traffic counters.
+             * @returns Snapshot of the counters
+             */
+            Statistics get_statistics() const;
+            /** Reset the bus traffic counters to zero. */
+            void reset_statistics();
+
+            int get_handle() const override;
+            int set_address(int address) override;
+            ssize_t read(uint_fast8_t* buffer, std::size_t length) override;
+            ssize_t write(const uint_fast8_t* buffer, std::size_t length) override;
+            int transfer(Message* messages, std::size_t count) override;
+            unsigned long get_functionality() override;
+            int set_pec(bool enable) override;
+            ssize_t smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length) override;
+
+        private:
+            int deliver(Message* messages, std::size_t count);
+            SimulatedDevice* find(int address);
+            uint64_t clocks(std::size_t length) const;
+            int64_t elapse(uint64_t clocks);
+
+            mutable std::mutex mutex;
+            /** eventfd standing in as the adapter's file descriptor */
+            int handle;
+            /** Address selected by set_address() */
+            int address;
+            std::map<int, SimulatedDevice::SharedPtr> devices;
+            std::set<int> nacks;
+            uint32_t clock_rate;
+            bool realtime;
+            unsigned long functionality;
+            bool pec;
+            Statistics statistics;
+    };
+}
+
+#endif //I2CPP_SIMULATED_BUS_HPP
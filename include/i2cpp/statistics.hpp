@@ -0,0 +1,183 @@
+/**
+ * @file statistics.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_STATISTICS_HPP
+#define I2CPP_STATISTICS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "i2cpp/transport.hpp"
+
+namespace i2cpp
+{
+    /**
+     * @brief Log2-bucketed latency histogram snapshot.
+     * Bucket 0 counts samples under 1ns, bucket n counts samples of 2^(n-1) up to 2^n nanoseconds.
+     * The last bucket also counts anything slower.
+     */
+    struct LatencyHistogram
+    {
+        /** Number of buckets */
+        static constexpr std::size_t size = 32;
+        uint64_t buckets[size];
+
+        /**
+         * Get the total number of samples.
+         * @returns Sum of every bucket
+         */
+        uint64_t count() const;
+        /**
+         * Estimate a percentile.
+         * @param fraction Percentile as a fraction, e.g. 0.99
+         * @returns Upper bound of the bucket holding the percentile, in nanoseconds, 0 if empty
+         */
+        uint64_t percentile(double fraction) const;
+    };
+
+    /** @brief Snapshot of the traffic to one device address on an adapter */
+    struct AddressStatistics
+    {
+        /** Address of the I2C device on the bus */
+        uint_fast8_t address;
+        /** Messages to or from this address */
+        uint64_t messages;
+        uint64_t bytes_read;
+        uint64_t bytes_written;
+        /** Reads or writes which transferred fewer bytes than requested */
+        uint64_t short_transfers;
+        /** Failed messages */
+        uint64_t errors;
+        /** Latency of every call addressing only this device */
+        LatencyHistogram latency;
+    };
+
+    /** @brief Snapshot of the traffic on one adapter */
+    struct AdapterStatistics
+    {
+        /** Adapter File Descriptor */
+        int adapter;
+        /** Filename the adapter was opened or attached under, empty if unknown */
+        std::string name;
+        /** Calls into the adapter's Transport, each one a kernel entry for i2c-dev adapters */
+        uint64_t transactions;
+        uint64_t bytes_read;
+        uint64_t bytes_written;
+        /** I2C_SLAVE address switches */
+        uint64_t address_changes;
+        /** I2C_SLAVE address switches which failed */
+        uint64_t address_errors;
+        uint64_t short_reads;
+        uint64_t short_writes;
+        /** Failed transactions */
+        uint64_t errors;
+        /** Number of failures for each errno seen */
+        std::map<int, uint64_t> errors_by_errno;
+        /** Latency of every transaction */
+        LatencyHistogram latency;
+        /** Every address with any traffic, in ascending order */
+        std::vector<AddressStatistics> addresses;
+    };
+
+    /**
+     * @brief Lock-free live counters for one adapter.
+     * Updated on the I/O hot path with relaxed atomic increments only. Snapshots may be taken at any
+     * time from any thread, and are consistent per counter but not across counters.
+     * @see i2cpp::I2CPP::get_statistics()
+     */
+    class AdapterCounters
+    {
+        public:
+            AdapterCounters();
+            AdapterCounters(AdapterCounters const&) = delete;
+            void operator=(AdapterCounters const&) = delete;
+
+            /**
+             * Record one read() or write() call.
+             * @param address Address of the I2C device on the bus
+             * @param read True for read(), false for write()
+             * @param requested Number of bytes requested
+             * @param result Value returned by the call
+             * @param error errno after the call, used if result is negative
+             * @param latency Duration of the call in nanoseconds
+             */
+            void record_io(int address, bool read, std::size_t requested, ssize_t result, int error, uint64_t latency);
+            /**
+             * Record the messages of one combined transfer.
+             * @param messages Array of messages sent
+             * @param count Number of messages in the array
+             * @param error 0 if successful, otherwise the errno reported
+             * @param latency Duration of the call in nanoseconds
+             */
+            void record_transfer(const Message* messages, std::size_t count, int error, uint64_t latency);
+            /**
+             * Record an I2C_SLAVE address switch.
+             * @param success True if the switch succeeded
+             * @param error errno after the switch, used if it failed
+             */
+            void record_address_change(bool success, int error);
+
+            /**
+             * Take a snapshot of the counters.
+             * @param adapter Adapter File Descriptor to report
+             * @param name Adapter filename to report
+             * @returns Snapshot of the counters
+             */
+            AdapterStatistics snapshot(int adapter, const std::string& name) const;
+            /** Reset every counter to zero. */
+            void reset();
+
+        private:
+            /** errno values counted individually, larger values share the last slot */
+            static constexpr std::size_t error_slots = 134;
+            /** Number of 7-bit addresses */
+            static constexpr std::size_t address_slots = 128;
+
+            struct Histogram
+            {
+                std::atomic<uint64_t> buckets[LatencyHistogram::size];
+                void record(uint64_t latency);
+                void snapshot(LatencyHistogram& into) const;
+                void reset();
+            };
+            struct Address
+            {
+                std::atomic<uint64_t> messages;
+                std::atomic<uint64_t> bytes_read;
+                std::atomic<uint64_t> bytes_written;
+                std::atomic<uint64_t> short_transfers;
+                std::atomic<uint64_t> errors;
+                Histogram latency;
+            };
+
+            void record_error(int error);
+
+            std::atomic<uint64_t> transactions;
+            std::atomic<uint64_t> bytes_read;
+            std::atomic<uint64_t> bytes_written;
+            std::atomic<uint64_t> address_changes;
+            std::atomic<uint64_t> address_errors;
+            std::atomic<uint64_t> short_reads;
+            std::atomic<uint64_t> short_writes;
+            std::atomic<uint64_t> errors;
+            std::atomic<uint64_t> errors_by_errno[error_slots];
+            Histogram latency;
+            Address addresses[address_slots];
+    };
+
+    /**
+     * Format adapter statistics as human-readable text.
+     * @param statistics Snapshots to format
+     * @returns One block of lines per adapter, with one line per address
+     */
+    std::string format_statistics(const std::vector<AdapterStatistics>& statistics);
+}
+
+#endif //I2CPP_STATISTICS_HPP
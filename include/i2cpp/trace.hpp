@@ -0,0 +1,230 @@
+/**
+ * @file trace.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_TRACE_HPP
+#define I2CPP_TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "i2cpp/transport.hpp"
+
+namespace i2cpp
+{
+    /** @brief Kind of bus operation in a TraceRecord */
+    enum class TraceKind : uint8_t
+    {
+        /** Marks unused space at the end of a trace file */
+        NONE = 0,
+        /** i2cpp::I2CPP::read_i2c() */
+        READ,
+        /** i2cpp::I2CPP::write_i2c() */
+        WRITE,
+        /** I2C_SLAVE address switch */
+        SET_ADDRESS,
+        /** Read message of i2cpp::I2CPP::transfer() */
+        TRANSFER_READ,
+        /** Write message of i2cpp::I2CPP::transfer() */
+        TRANSFER_WRITE,
+        /** i2cpp::I2CPP::read_register() */
+        REGISTER_READ,
+        /** i2cpp::I2CPP::write_register() */
+        REGISTER_WRITE,
+        /** i2cpp::I2CPP::probe() */
+        PROBE
+    };
+
+    /**
+     * @brief One bus operation, as stored in a trace file.
+     * Records are 64 bytes, so a trace file is a plain array of them after its header.
+     * A transfer of several messages is stored as one record per message, sharing a timestamp.
+     */
+    struct TraceRecord
+    {
+        /** Size of the payload field */
+        static constexpr std::size_t payload_size = 32;
+
+        /** Monotonic time the operation started, in nanoseconds */
+        uint64_t timestamp;
+        /** Duration of the operation in nanoseconds, saturating at about 4 seconds */
+        uint32_t duration;
+        /** File Descriptor of the adapter */
+        int32_t adapter;
+        /** Value returned by the operation: bytes transferred, or -1 on failure */
+        int32_t result;
+        /** Bytes requested */
+        uint16_t length;
+        /** errno if the operation failed, otherwise 0 */
+        int16_t error;
+        /** Address of the I2C device on the bus */
+        uint16_t address;
+        TraceKind kind;
+        /** Number of payload bytes captured, the first of the bytes written or read */
+        uint8_t captured;
+        /** Index of the message within its transfer */
+        uint8_t index;
+        /** Number of messages in the transfer, 1 for everything else */
+        uint8_t count;
+        /** Register address of REGISTER_READ and REGISTER_WRITE records */
+        uint8_t command;
+        uint8_t reserved;
+        uint8_t payload[payload_size];
+    };
+    static_assert(sizeof(TraceRecord) == 64, "Trace records must be 64 bytes");
+
+    /**
+     * @brief Binary recorder of the traffic through i2cpp::I2CPP.
+     * While tracing, every read, write, address switch, transfer message, register access and probe
+     * is appended as a TraceRecord to a fixed buffer belonging to the calling thread. Full buffers are
+     * copied into a memory-mapped trace file of fixed capacity, so recording takes no system calls and
+     * no heap allocation. Records which do not fit in the file are counted and dropped.
+     *
+     * Tracing costs a single relaxed atomic load per operation while stopped. Configure with
+     * -DI2CPP_TRACE=OFF to compile it out entirely.
+     * @see i2cpp::TraceReplayer
+     */
+    class Tracer
+    {
+        public:
+            Tracer(Tracer const&) = delete;
+            void operator=(Tracer const&) = delete;
+
+            /**
+             * Start tracing into a new file.
+             * @param path Path of the trace file, replaced if it exists
+             * @param capacity Maximum number of records to store
+             * @returns True if successful, false if the file could not be created or tracing is running
+             */
+            static bool start(const std::string& path, std::size_t capacity);
+            /**
+             * Stop tracing, writing out every thread's buffered records and closing the file.
+             * @returns Number of records in the file
+             */
+            static std::size_t stop();
+            /**
+             * Check whether tracing is running.
+             * @returns True between start() and stop()
+             */
+            static bool is_enabled() { return instance().enabled.load(std::memory_order_relaxed); }
+            /**
+             * Get the number of records dropped because the file was full.
+             * @returns Records dropped since start()
+             */
+            static uint64_t get_dropped();
+
+            /**
+             * Append a record to the calling thread's buffer.
+             * @param record The record, without its payload
+             * @param payload Bytes written or read, the first TraceRecord::payload_size of which are captured
+             * @param length Length of payload
+             */
+            static void record(const TraceRecord& record, const uint_fast8_t* payload, std::size_t length);
+            /** Copy the calling thread's buffered records into the file. */
+            static void flush();
+
+            /**
+             * Read every record of a trace file.
+             * @param path Path of the trace file
+             * @param[in] records Receives the records, in file order
+             * @returns True if successful, false if the file is missing or not a trace
+             */
+            static bool load(const std::string& path, std::vector<TraceRecord>& records);
+
+        private:
+            /** Records buffered per thread before copying into the file */
+            static constexpr std::size_t buffer_size = 256;
+
+            /** A thread's pending records, registered with the Tracer for the thread's lifetime */
+            struct Buffer
+            {
+                std::mutex mutex;
+                std::size_t count;
+                TraceRecord records[buffer_size];
+
+                Buffer();
+                ~Buffer();
+            };
+
+            Tracer();
+            ~Tracer();
+            static Tracer& instance();
+            static Buffer& buffer();
+
+            void _flush(Buffer& buffer);
+
+            std::atomic<bool> enabled;
+            /** Guards start(), stop() and the buffer list */
+            std::mutex mutex;
+            std::vector<Buffer*> buffers;
+            int fd;
+            /** Mapped trace file, header included */
+            uint8_t* mapping;
+            std::size_t capacity;
+            /** Records claimed in the file, may exceed capacity */
+            std::atomic<std::size_t> written;
+            std::atomic<uint64_t> dropped;
+    };
+
+    /**
+     * @brief Replays a trace through i2cpp::I2CPP.
+     * Each recorded operation is repeated on a stand-in adapter, typically an i2cpp::SimulatedBus
+     * attached with i2cpp::I2CPP::attach_adapter(), at the recorded pace or faster. Replaying one
+     * trace against different builds of the library reproduces a field workload offline.
+     * Written data is replayed from the captured payload, padded with zeroes past
+     * TraceRecord::payload_size bytes. Address switches are implied by the operations themselves.
+     */
+    class TraceReplayer
+    {
+        public:
+            /** @brief Outcome of a replay */
+            struct Result
+            {
+                /** Operations replayed, counting a transfer once */
+                uint64_t operations;
+                /** Records skipped because their adapter is not mapped */
+                uint64_t skipped;
+                /** Operations which succeeded where the recording failed, or the reverse */
+                uint64_t mismatches;
+                /** Wall time of the replay in nanoseconds */
+                uint64_t elapsed;
+                /** Recorded span of the trace in nanoseconds */
+                uint64_t recorded;
+                /** Largest delay of an operation behind its scheduled time, in nanoseconds */
+                uint64_t max_lag;
+            };
+
+            /**
+             * Prepare a trace for replay.
+             * @param records Records of the trace, as from Tracer::load()
+             */
+            explicit TraceReplayer(const std::vector<TraceRecord>& records);
+
+            /**
+             * Replay one recorded adapter's operations on a stand-in adapter.
+             * Operations on adapters which are not mapped are skipped.
+             * @param recorded File Descriptor of the adapter in the trace
+             * @param adapter File Descriptor of the adapter to replay on
+             */
+            void map_adapter(int recorded, int adapter);
+            /**
+             * Replay the trace.
+             * @param speed 1 for the recorded timing, 2 for twice as fast and so on, 0 for no waits at all
+             * @returns Counts and timing of the replay
+             */
+            Result replay(double speed = 1.0);
+
+        private:
+            std::vector<TraceRecord> records;
+            std::map<int, int> adapters;
+    };
+}
+
+#endif //I2CPP_TRACE_HPP
@@ -0,0 +1,180 @@
+/**
+ * @file transport.hpp
+ * @author Scott Fasone
+ */
+
+#ifndef I2CPP_TRANSPORT_HPP
+#define I2CPP_TRANSPORT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+namespace i2cpp
+{
+    /**
+     * @brief A single segment of a combined I2C transaction.
+     * Every message starts with a (repeated) START condition and carries its own address,
+     * so a register pointer write and the following read can share one bus transaction.
+     * @see i2cpp::I2CPP::transfer()
+     */
+    struct Message
+    {
+        /** Address of the I2C device on the bus */
+        uint_fast8_t address;
+        /** True to read from the device into buffer, false to write buffer to the device */
+        bool read;
+        /** Bytes to write, or space for the bytes to read */
+        uint_fast8_t* buffer;
+        /** Length of buffer */
+        std::size_t length;
+        /** Result of the last transfer of this message: 0 on success, otherwise the errno reported */
+        int status;
+    };
+
+    /** @brief SMBus transaction formats used for register access and probing */
+    enum class SMBusSize
+    {
+        /** The read/write bit alone, with no data */
+        QUICK,
+        /** One data byte received when reading; the command byte alone when writing */
+        BYTE,
+        /** Command byte, then one data byte */
+        BYTE_DATA,
+        /** Command byte, then a data word sent low byte first */
+        WORD_DATA,
+        /** Command byte, then 1 to 32 data bytes with no length byte on the wire */
+        I2C_BLOCK_DATA
+    };
+
+    /**
+     * @brief Backend carrying the transactions of one I2C adapter.
+     * i2cpp::I2CPP performs all of its I/O through a Transport, which lets an adapter be backed by
+     * something other than a Linux i2c-dev device file, such as an i2cpp::SimulatedBus.
+     *
+     * Methods mirror the system calls of the i2c-dev interface: failures return -1 and set errno.
+     * I2CPP serializes all calls on one Transport, so implementations need no locking of their own.
+     */
+    class Transport
+    {
+        public:
+            /** Convenience name to get a Shared Pointer */
+            using SharedPtr = std::shared_ptr<Transport>;
+
+            virtual ~Transport() = default;
+
+            /**
+             * Get the handle identifying this adapter.
+             * The handle must be a file descriptor owned by the transport, so it is unique in the process.
+             * @returns Adapter handle, as returned by i2cpp::I2CPP::open_adapter()
+             */
+            virtual int get_handle() const = 0;
+            /**
+             * Select the device addressed by read() and write().
+             * @param address Address of the I2C device on the bus
+             * @returns 0 if successful, -1 otherwise
+             */
+            virtual int set_address(int address) = 0;
+            /**
+             * Read bytes from the selected device.
+             * @param[in] buffer Array of bytes to write to from the bus
+             * @param length Length of buffer
+             * @returns Number of bytes read, -1 on failure
+             */
+            virtual ssize_t read(uint_fast8_t* buffer, std::size_t length) = 0;
+            /**
+             * Write bytes to the selected device.
+             * @param[out] buffer Array of bytes to write to the bus
+             * @param length Length of buffer
+             * @returns Number of bytes written, -1 on failure
+             */
+            virtual ssize_t write(const uint_fast8_t* buffer, std::size_t length) = 0;
+            /**
+             * Perform a combined transaction, with a repeated START between messages and a single STOP.
+             * Message status fields are left to the caller.
+             *
+             * @param[in,out] messages Array of messages to send
+             * @param count Number of messages in the array
+             * @returns Number of messages transferred, -1 on failure
+             */
+            virtual int transfer(Message* messages, std::size_t count) = 0;
+
+            /**
+             * Get the adapter's capabilities, as reported by the I2C_FUNCS ioctl.
+             * The default reports plain I2C only, which suits transports implementing just the methods above.
+             * @returns Bitmask of I2C_FUNC_* flags from linux/i2c.h
+             */
+            virtual unsigned long get_functionality();
+            /**
+             * Enable or disable Packet Error Checking on SMBus transactions.
+             * The default fails with EOPNOTSUPP.
+             * @param enable True to append and check a PEC byte
+             * @returns 0 if successful, -1 otherwise
+             */
+            virtual int set_pec(bool enable);
+            /**
+             * Perform an SMBus register transaction with the selected device.
+             * The default fails with EOPNOTSUPP.
+             * @param read True to read from the register, false to write to it
+             * @param command Command byte, typically the register address
+             * @param size Transaction format
+             * @param[in,out] buffer Data bytes in bus order
+             * @param length Length of buffer, as checked by valid_smbus_length()
+             * @returns Number of data bytes transferred, -1 on failure
+             */
+            virtual ssize_t smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length);
+    };
+
+    /**
+     * Check the buffer length of an SMBus transaction.
+     * @param read True for reads, false for writes
+     * @param size Transaction format
+     * @param length Length of buffer
+     * @returns True for 0 with QUICK, 1 with BYTE reads or 0 with BYTE writes, 1 with BYTE_DATA,
+     *          2 with WORD_DATA and 1 to 32 with I2C_BLOCK_DATA, false otherwise
+     */
+    bool valid_smbus_length(bool read, SMBusSize size, std::size_t length);
+
+    /**
+     * @brief Transport for a Linux i2c-dev device file.
+     * This is the default backend for adapters opened with i2cpp::I2CPP::open_adapter().
+     */
+    class LinuxTransport : public Transport
+    {
+        public:
+            /**
+             * Open an i2c-dev device file.
+             * @param filename Path to I2C device file
+             */
+            explicit LinuxTransport(const std::string& filename);
+            /**
+             * Wrap an already open i2c-dev File Descriptor.
+             * @param fd File Descriptor of the I2C device file
+             * @param owned True to close fd when the transport is destroyed
+             */
+            LinuxTransport(int fd, bool owned);
+            /** Closes the File Descriptor if it is owned. */
+            ~LinuxTransport();
+            LinuxTransport(LinuxTransport const&) = delete;
+            void operator=(LinuxTransport const&) = delete;
+
+            int get_handle() const override;
+            int set_address(int address) override;
+            ssize_t read(uint_fast8_t* buffer, std::size_t length) override;
+            ssize_t write(const uint_fast8_t* buffer, std::size_t length) override;
+            int transfer(Message* messages, std::size_t count) override;
+            unsigned long get_functionality() override;
+            int set_pec(bool enable) override;
+            ssize_t smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length) override;
+
+        private:
+            /** File Descriptor of the I2C device file, -1 if it could not be opened */
+            int fd;
+            /** True if fd is closed with the transport */
+            bool owned;
+    };
+}
+
+#endif //I2CPP_TRANSPORT_HPP
@@ -0,0 +1,113 @@
+#include "i2cpp/ads1115_sampler.hpp"
+
+#include <chrono>
+#include <thread>
+
+
+namespace i2cpp
+{
+    ADS1115Sampler::ADS1115Sampler() : adapter(-1), total(0) {  }
+
+    bool ADS1115Sampler::add(ADS1115::SharedPtr device, const std::vector<ADS1115::Mux>& channels)
+    {
+        if(this->adapter >= 0 && device->get_adapter() != this->adapter) {
+            return false;
+        }
+        this->adapter = device->get_adapter();
+
+        Entry entry;
+        entry.device = device;
+        entry.channels = channels;
+        entry.offset = this->total;
+        entry.pointer = ADS1115::Registers::Conversion::address;
+        entry.started = false;
+        this->entries.push_back(entry);
+        this->total += channels.size();
+        return true;
+    }
+    int ADS1115Sampler::get_adapter() const { return this->adapter; }
+
+    bool ADS1115Sampler::scan(std::vector<Reading>& readings)
+    {
+        readings.resize(this->total);
+        for(Entry& entry : this->entries)
+        {
+            for(std::size_t i = 0; i < entry.channels.size(); i++)
+            {
+                Reading& reading = readings[entry.offset + i];
+                reading.device = std::size_t(&entry - &this->entries[0]);
+                reading.channel = i;
+                reading.mux = entry.channels[i];
+                reading.value = 0;
+                reading.valid = false;
+            }
+            if(entry.device->is_streaming()) {
+                return false;
+            }
+        }
+
+        bool success = true;
+        for(std::size_t pass = 0; ; pass++)
+        {
+            // Read each chip's previous result, then start its next conversion, all in one batch
+            this->messages.clear();
+            std::chrono::nanoseconds wait(0);
+            for(Entry& entry : this->entries)
+            {
+                uint_fast8_t address = entry.device->get_address();
+                entry.read_index = entry.start_index = std::size_t(-1);
+                if(pass > 0 && pass <= entry.channels.size())
+                {
+                    this->messages.push_back({ address, false, &entry.pointer, 1, 0 });
+                    entry.read_index = this->messages.size();
+                    this->messages.push_back({ address, true, entry.result, 2, 0 });
+                }
+                if(pass < entry.channels.size())
+                {
+                    entry.config = entry.device->config;
+                    entry.config.mux = entry.channels[pass];
+                    entry.config.mode = ADS1115::Mode::SINGLE_SHOT;
+                    entry.command[0] = ADS1115::Registers::Config::address;
+                    ADS1115::Registers::Config::encode(ADS1115::Registers::Status::set(entry.config.to_register(), true), entry.command + 1);
+                    entry.start_index = this->messages.size();
+                    this->messages.push_back({ address, false, entry.command, 3, 0 });
+
+                    std::chrono::nanoseconds period(1000000000 / ADS1115::samples_per_second(entry.config.rate));
+                    if(period > wait) {
+                        wait = period;
+                    }
+                }
+            }
+            if(this->messages.empty()) {
+                break;
+            }
+
+            I2CPP::submit_batch(this->adapter, this->messages);
+            std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+
+            for(Entry& entry : this->entries)
+            {
+                if(entry.read_index != std::size_t(-1))
+                {
+                    Reading& reading = readings[entry.offset + pass - 1];
+                    const Message& read = this->messages[entry.read_index];
+                    reading.valid = entry.started && this->messages[entry.read_index - 1].status == 0 && read.status == 0;
+                    reading.value = int16_t(uint16_t(ADS1115::Registers::Conversion::decode(entry.result)));
+                    success = success && reading.valid;
+                }
+                entry.started = false;
+                if(entry.start_index != std::size_t(-1) && this->messages[entry.start_index].status == 0)
+                {
+                    entry.started = true;
+                    entry.device->config = entry.config;
+                }
+            }
+
+            if(wait.count() > 0) {
+                // Allow for the slowest permitted oscillator, plus the chip's wake-up time
+                std::this_thread::sleep_until(sent + wait + wait / 10 + std::chrono::microseconds(50));
+            }
+        }
+        return success;
+    }
+}
@@ -0,0 +1,146 @@
+#include "i2cpp/arbiter.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** Priority class of the calling thread's transactions */
+        thread_local BusPriority thread_priority = BusPriority::CONTROL;
+
+        uint64_t steady_now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+
+    PriorityScope::PriorityScope(BusPriority priority) : previous(thread_priority)
+    {
+        thread_priority = priority;
+    }
+    PriorityScope::~PriorityScope()
+    {
+        thread_priority = this->previous;
+    }
+    BusPriority PriorityScope::current() { return thread_priority; }
+
+
+    const unsigned Arbiter::starvation_limit;
+
+    Arbiter::Arbiter() : busy(false)
+    {
+        for(std::size_t c = 0; c < bus_priorities; c++) {
+            this->classes[c].passed = 0;
+        }
+        this->reset();
+    }
+
+    void Arbiter::lock()
+    {
+        int index = int(PriorityScope::current());
+        Class& waiter = this->classes[index];
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if(!this->busy)
+        {
+            this->busy = true;
+            this->record(waiter, 0);
+            return;
+        }
+
+        uint64_t start = steady_now();
+        Waiter self;
+        self.granted = false;
+        waiter.waiting.push_back(&self);
+        self.ready.wait(lock, [&self]() { return self.granted; });
+        waiter.statistics.contended++;
+        this->record(waiter, steady_now() - start);
+    }
+
+    bool Arbiter::try_lock()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if(this->busy) {
+            return false;
+        }
+        this->busy = true;
+        this->record(this->classes[int(PriorityScope::current())], 0);
+        return true;
+    }
+
+    void Arbiter::unlock()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        int urgent = -1;
+        int starved = -1;
+        for(std::size_t c = 0; c < bus_priorities; c++)
+        {
+            if(this->classes[c].waiting.empty()) {
+                continue;
+            }
+            if(urgent < 0) {
+                urgent = int(c);
+            }
+            if(starved < 0 && this->classes[c].passed >= Arbiter::starvation_limit) {
+                starved = int(c);
+            }
+        }
+        if(urgent < 0)
+        {
+            this->busy = false;
+            return;
+        }
+
+        // The adapter stays busy, passing straight to the class's oldest waiter, so newcomers queue behind it
+        int next = starved >= 0 ? starved : urgent;
+        for(std::size_t c = 0; c < bus_priorities; c++)
+        {
+            if(int(c) != next && !this->classes[c].waiting.empty()) {
+                this->classes[c].passed++;
+            }
+        }
+        this->classes[next].passed = 0;
+        if(next != urgent) {
+            this->classes[next].statistics.starvation_grants++;
+        }
+        Waiter* chosen = this->classes[next].waiting.front();
+        this->classes[next].waiting.pop_front();
+        chosen->granted = true;
+        chosen->ready.notify_one();
+    }
+
+    /** Count a grant, mutex must be held */
+    void Arbiter::record(Class& waiter, uint64_t wait)
+    {
+        ArbitrationStatistics& statistics = waiter.statistics;
+        statistics.grants++;
+        statistics.max_wait = std::max(statistics.max_wait, wait);
+        std::size_t bucket = 0;
+        while(bucket + 1 < LatencyHistogram::size && (wait >> bucket) != 0) {
+            bucket++;
+        }
+        statistics.wait.buckets[bucket]++;
+    }
+
+    void Arbiter::snapshot(ArbitrationStatistics* statistics)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for(std::size_t c = 0; c < bus_priorities; c++) {
+            statistics[c] = this->classes[c].statistics;
+        }
+    }
+
+    void Arbiter::reset()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for(std::size_t c = 0; c < bus_priorities; c++)
+        {
+            this->classes[c].statistics = ArbitrationStatistics();
+            this->classes[c].statistics.priority = BusPriority(c);
+        }
+    }
+}
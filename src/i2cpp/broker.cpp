@@ -0,0 +1,793 @@
+#include "i2cpp/broker.hpp"
+#include "i2cpp/i2cpp.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+
+namespace i2cpp
+{
+    namespace detail
+    {
+        /** Marks an initialized segment, "I2CB" */
+        const uint32_t broker_magic = 0x49324342;
+        /** Layout version, changed with any change to the structures below */
+        const uint32_t broker_version = 1;
+        /** Requests which can be queued at once, across every client */
+        const uint32_t broker_slots = 64;
+        /** Data bytes carried by one request */
+        const std::size_t broker_data = 1024;
+
+        /** Life cycle of a slot, also the futex word its client waits on */
+        enum BrokerSlotState : uint32_t
+        {
+            /** Available to any client */
+            SLOT_FREE,
+            /** Being filled by its client */
+            SLOT_CLAIMED,
+            /** Waiting for the broker */
+            SLOT_SUBMITTED,
+            /** Being served by the broker */
+            SLOT_BUSY,
+            /** Served, waiting for its client to read the result */
+            SLOT_DONE,
+            /** Given up by a client which timed out, freed by the broker once served */
+            SLOT_ABANDONED
+        };
+        /** Transport calls a request stands for */
+        enum BrokerOperation : uint32_t
+        {
+            OPERATION_READ,
+            OPERATION_WRITE,
+            OPERATION_TRANSFER,
+            OPERATION_SMBUS
+        };
+
+        /** A Message, with its buffer stored in the slot's data */
+        struct BrokerMessage
+        {
+            uint16_t address;
+            uint16_t length;
+            uint8_t read;
+        };
+
+        /** One queued request */
+        struct BrokerSlot
+        {
+            std::atomic<uint32_t> state;
+            /** Number of clients sleeping on state, so the broker only wakes them when needed */
+            std::atomic<uint32_t> waiters;
+            /** Process ID of the client holding the slot, 0 when free */
+            std::atomic<int32_t> owner;
+            /** Submission order */
+            uint64_t ticket;
+
+            uint32_t operation;
+            int32_t address;
+            uint32_t pec;
+            /** SMBus direction */
+            uint32_t read;
+            /** SMBus command byte */
+            uint32_t command;
+            /** SMBus transaction format */
+            uint32_t size;
+            /** Number of data bytes, or of messages for transfers */
+            uint32_t count;
+
+            int64_t result;
+            int32_t error;
+
+            BrokerMessage messages[I2C_RDWR_IOCTL_MAX_MSGS];
+            uint_fast8_t data[broker_data];
+        };
+
+        struct BrokerSegment
+        {
+            std::atomic<uint32_t> magic;
+            uint32_t version;
+            /** Nonzero while the broker serves requests */
+            std::atomic<uint32_t> running;
+            /** Process ID of the broker */
+            int32_t pid;
+            /** Capabilities of the adapter's transport */
+            uint64_t functionality;
+            /** Incremented by every submission, the futex word the broker sleeps on */
+            std::atomic<uint32_t> doorbell;
+            /** Nonzero while the broker may be sleeping, so clients only wake it when needed */
+            std::atomic<uint32_t> sleeping;
+            /** Source of slot tickets */
+            std::atomic<uint64_t> tickets;
+
+            BrokerSlot slots[broker_slots];
+        };
+    }
+
+    namespace
+    {
+        using detail::BrokerSegment;
+        using detail::BrokerSlot;
+
+        /** Longest single futex sleep, bounding how late a dead peer is noticed */
+        const uint32_t wait_slice = 100;
+        /** Status checks of a submitted request before a client sleeps on it */
+        const int client_spins = 64;
+        /** Interval between searches for slots of exited clients, in milliseconds */
+        const int64_t reap_interval = 1000;
+
+        int64_t steady_ms()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /** Sleep while a shared word holds a value, for at most timeout milliseconds */
+        void futex_wait(std::atomic<uint32_t>& word, uint32_t value, uint32_t timeout)
+        {
+            struct timespec time = { time_t(timeout / 1000), long(timeout % 1000) * 1000000L };
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, &time, nullptr, 0);
+        }
+        /** Wake processes sleeping on a shared word */
+        void futex_wake(std::atomic<uint32_t>& word, int count)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+        }
+
+        bool process_alive(int32_t pid) { return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH); }
+
+        /** Map an existing segment, checking it was initialized by a compatible broker */
+        BrokerSegment* map_segment(const std::string& name)
+        {
+            int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+            if(fd < 0) {
+                return nullptr;
+            }
+            struct stat status;
+            void* mapping = MAP_FAILED;
+            if(fstat(fd, &status) == 0 && std::size_t(status.st_size) >= sizeof(BrokerSegment)) {
+                mapping = mmap(nullptr, sizeof(BrokerSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+            if(mapping == MAP_FAILED) {
+                return nullptr;
+            }
+            BrokerSegment* segment = static_cast<BrokerSegment*>(mapping);
+            if(segment->magic.load(std::memory_order_acquire) != detail::broker_magic || segment->version != detail::broker_version) {
+                munmap(mapping, sizeof(BrokerSegment));
+                return nullptr;
+            }
+            return segment;
+        }
+    }
+
+
+    Broker::Broker(const std::string& filename) : Broker(filename, std::make_shared<LinuxTransport>(filename)) {  }
+    Broker::Broker(const std::string& filename, Transport::SharedPtr transport) : name(Broker::segment_name(filename)),
+        transport(transport), segment(nullptr), address(-1), pec(false), stopping(false),
+        requests(0), calls(0), batched(0), reaped(0)
+    {
+        if(!this->transport || this->transport->get_handle() < 0) {
+            return;
+        }
+
+        // Never take over from a broker which is still serving
+        BrokerSegment* existing = map_segment(this->name);
+        if(existing != nullptr) {
+            bool live = existing->running.load() != 0 && process_alive(existing->pid);
+            munmap(existing, sizeof(BrokerSegment));
+            if(live) {
+                return;
+            }
+        }
+        shm_unlink(this->name.c_str());
+
+        int fd = shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+        if(fd < 0) {
+            return;
+        }
+        void* mapping = MAP_FAILED;
+        if(ftruncate(fd, sizeof(BrokerSegment)) == 0) {
+            mapping = mmap(nullptr, sizeof(BrokerSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if(mapping == MAP_FAILED) {
+            shm_unlink(this->name.c_str());
+            return;
+        }
+
+        this->segment = new(mapping) BrokerSegment();
+        this->segment->version = detail::broker_version;
+        this->segment->pid = getpid();
+        this->segment->functionality = this->transport->get_functionality();
+        this->segment->running.store(1);
+        this->segment->magic.store(detail::broker_magic, std::memory_order_release);
+    }
+    Broker::~Broker()
+    {
+        this->stop();
+        if(this->segment == nullptr) {
+            return;
+        }
+        // Clients notice within one wait slice, this only makes them notice sooner
+        this->segment->running.store(0);
+        for(uint32_t i = 0; i < detail::broker_slots; i++) {
+            futex_wake(this->segment->slots[i].state, 1);
+        }
+        munmap(this->segment, sizeof(BrokerSegment));
+        shm_unlink(this->name.c_str());
+    }
+
+    bool Broker::is_open() const { return this->segment != nullptr; }
+
+    bool Broker::run()
+    {
+        if(this->segment == nullptr) {
+            return false;
+        }
+        BrokerSegment& shared = *this->segment;
+        int64_t next_reap = steady_ms() + reap_interval;
+        while(!this->stopping.load())
+        {
+            uint32_t bell = shared.doorbell.load();
+            if(this->poll() > 0) {
+                continue;
+            }
+
+            // Any submission after the scan above has moved the doorbell, so the wait returns at once
+            shared.sleeping.store(1);
+            if(shared.doorbell.load() == bell && !this->stopping.load()) {
+                futex_wait(shared.doorbell, bell, wait_slice);
+            }
+            shared.sleeping.store(0);
+
+            if(steady_ms() >= next_reap) {
+                this->reap();
+                next_reap = steady_ms() + reap_interval;
+            }
+        }
+        return true;
+    }
+    bool Broker::start()
+    {
+        if(this->segment == nullptr || this->thread.joinable()) {
+            return false;
+        }
+        this->stopping.store(false);
+        this->thread = std::thread(&Broker::run, this);
+        return true;
+    }
+    void Broker::stop()
+    {
+        this->stopping.store(true);
+        if(this->segment != nullptr) {
+            this->segment->doorbell.fetch_add(1);
+            futex_wake(this->segment->doorbell, 1);
+        }
+        if(this->thread.joinable()) {
+            this->thread.join();
+        }
+    }
+
+    std::size_t Broker::poll()
+    {
+        if(this->segment == nullptr) {
+            return 0;
+        }
+        this->pending.clear();
+        for(uint32_t i = 0; i < detail::broker_slots; i++)
+        {
+            BrokerSlot& slot = this->segment->slots[i];
+            uint32_t expected = detail::SLOT_SUBMITTED;
+            if(slot.state.load() == expected && slot.state.compare_exchange_strong(expected, detail::SLOT_BUSY)) {
+                this->pending.push_back(Pending{ i, slot.ticket, 0, 0 });
+            }
+        }
+        std::sort(this->pending.begin(), this->pending.end(),
+                  [](const Pending& a, const Pending& b) { return a.ticket < b.ticket; });
+
+        // Pack runs of consecutive transfers into single calls, as far as the kernel allows
+        this->messages.clear();
+        std::vector<Pending> run;
+        std::size_t run_messages = 0;
+        for(Pending& request : this->pending)
+        {
+            BrokerSlot& slot = this->segment->slots[request.slot];
+            if(slot.operation != detail::OPERATION_TRANSFER) {
+                this->transfer(run);
+                run.clear();
+                run_messages = 0;
+                this->execute(request.slot);
+                continue;
+            }
+            if(!this->stage(request)) {
+                this->complete(request.slot, -1, EINVAL);
+                continue;
+            }
+            if(run_messages + request.count > I2C_RDWR_IOCTL_MAX_MSGS) {
+                this->transfer(run);
+                run.clear();
+                run_messages = 0;
+            }
+            run.push_back(request);
+            run_messages += request.count;
+        }
+        this->transfer(run);
+        return this->pending.size();
+    }
+
+    /**
+     * Copy a transfer's messages out of its slot, checking them against the slot's size.
+     * Any process able to map the segment can write the slot, even while it is served, so each field
+     * is read once and only the checked copies are used.
+     * @returns False if the request is malformed
+     */
+    bool Broker::stage(Pending& request)
+    {
+        BrokerSlot& slot = this->segment->slots[request.slot];
+        uint32_t count = slot.count;
+        if(count == 0 || count > I2C_RDWR_IOCTL_MAX_MSGS) {
+            return false;
+        }
+        request.first = this->messages.size();
+        request.count = count;
+        std::size_t offset = 0;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            detail::BrokerMessage message = slot.messages[i];
+            if(message.address > 0x7f || message.length > detail::broker_data - offset)
+            {
+                this->messages.resize(request.first);
+                return false;
+            }
+            this->messages.push_back(Message{ uint_fast8_t(message.address), message.read != 0, slot.data + offset, message.length, 0 });
+            offset += message.length;
+        }
+        return true;
+    }
+
+    bool Broker::select(int address)
+    {
+        if(address == this->address) {
+            return true;
+        }
+        this->calls++;
+        if(this->transport->set_address(address) < 0) {
+            this->address = -1;
+            return false;
+        }
+        this->address = address;
+        return true;
+    }
+
+    /** Serve a request other than a transfer */
+    void Broker::execute(uint32_t index)
+    {
+        // Clients can rewrite the slot at any time, so each field is read once and checked before use
+        BrokerSlot& slot = this->segment->slots[index];
+        uint32_t operation = slot.operation;
+        int32_t address = slot.address;
+        std::size_t count = slot.count;
+        bool pec = slot.pec != 0;
+        bool read = slot.read != 0;
+        uint32_t size = slot.size;
+        bool valid = address >= 0 && address <= 0x7f && count <= detail::broker_data;
+        if(operation == detail::OPERATION_SMBUS) {
+            valid = valid && size <= uint32_t(SMBusSize::I2C_BLOCK_DATA) && valid_smbus_length(read, SMBusSize(size), count);
+        } else if(operation != detail::OPERATION_READ && operation != detail::OPERATION_WRITE) {
+            valid = false;
+        }
+        if(!valid) {
+            this->complete(index, -1, EINVAL);
+            return;
+        }
+        if(!this->select(address)) {
+            this->complete(index, -1, errno);
+            return;
+        }
+
+        ssize_t result = -1;
+        switch(operation)
+        {
+            case detail::OPERATION_READ:
+                this->calls++;
+                result = this->transport->read(slot.data, count);
+                break;
+            case detail::OPERATION_WRITE:
+                this->calls++;
+                result = this->transport->write(slot.data, count);
+                break;
+            case detail::OPERATION_SMBUS:
+                if(pec != this->pec)
+                {
+                    this->calls++;
+                    if(this->transport->set_pec(pec) < 0) {
+                        break;
+                    }
+                    this->pec = pec;
+                }
+                this->calls++;
+                result = this->transport->smbus(read, uint_fast8_t(slot.command), SMBusSize(size), slot.data, count);
+                break;
+        }
+        this->complete(index, result, result < 0 ? errno : 0);
+    }
+
+    /** Serve staged transfer requests, in a single call of the transport when possible */
+    void Broker::transfer(const std::vector<Pending>& run)
+    {
+        if(run.empty()) {
+            return;
+        }
+
+        // Staged messages point straight into the shared slots, so nothing is copied, and a run's messages are adjacent
+        std::size_t first = run.front().first;
+        std::size_t count = run.back().first + run.back().count - first;
+        this->calls++;
+        if(this->transport->transfer(&this->messages[first], count) >= 0)
+        {
+            if(run.size() > 1) {
+                this->batched += run.size();
+            }
+            for(const Pending& request : run) {
+                this->complete(request.slot, request.count, 0);
+            }
+            return;
+        }
+        if(run.size() == 1) {
+            this->complete(run[0].slot, -1, errno);
+            return;
+        }
+
+        // Retry each request alone, so a failing device only fails its own client
+        for(const Pending& request : run)
+        {
+            this->calls++;
+            int result = this->transport->transfer(&this->messages[request.first], request.count);
+            this->complete(request.slot, result, result < 0 ? errno : 0);
+        }
+    }
+
+    void Broker::complete(uint32_t index, int64_t result, int error)
+    {
+        BrokerSlot& slot = this->segment->slots[index];
+        slot.result = result;
+        slot.error = error;
+        this->requests++;
+
+        uint32_t expected = detail::SLOT_BUSY;
+        if(slot.state.compare_exchange_strong(expected, detail::SLOT_DONE))
+        {
+            if(slot.waiters.load() != 0) {
+                futex_wake(slot.state, 1);
+            }
+            return;
+        }
+        // The client gave up waiting, so the slot is released here instead
+        slot.owner.store(0);
+        slot.state.store(detail::SLOT_FREE);
+    }
+
+    /** Release slots held by clients which exited without releasing them */
+    void Broker::reap()
+    {
+        for(uint32_t i = 0; i < detail::broker_slots; i++)
+        {
+            BrokerSlot& slot = this->segment->slots[i];
+            uint32_t state = slot.state.load();
+            if(state == detail::SLOT_FREE || state == detail::SLOT_BUSY || state == detail::SLOT_ABANDONED) {
+                continue;
+            }
+            int32_t owner = slot.owner.load();
+            if(owner == 0 || process_alive(owner)) {
+                continue;
+            }
+            if(slot.state.compare_exchange_strong(state, detail::SLOT_FREE)) {
+                slot.owner.store(0);
+                this->reaped++;
+            }
+        }
+    }
+
+    BrokerStatistics Broker::get_statistics() const
+    {
+        return BrokerStatistics{ this->requests.load(), this->calls.load(), this->batched.load(), this->reaped.load() };
+    }
+
+    std::string Broker::segment_name(const std::string& filename)
+    {
+        std::string name = "/i2cpp";
+        for(char c : filename) {
+            name += c == '/' ? '.' : c;
+        }
+        return name;
+    }
+
+
+    BrokerTransport::BrokerTransport(const std::string& filename, uint32_t timeout) : name(Broker::segment_name(filename)),
+        timeout(timeout), segment(nullptr), pid(getpid()), address(-1), pec(false)
+    {
+        this->handle = eventfd(0, EFD_CLOEXEC);
+        this->connect();
+    }
+    BrokerTransport::~BrokerTransport()
+    {
+        this->disconnect();
+        if(this->handle >= 0) {
+            close(this->handle);
+        }
+    }
+
+    int BrokerTransport::attach(const std::string& filename, uint32_t timeout)
+    {
+        BrokerTransport::SharedPtr transport = std::make_shared<BrokerTransport>(filename, timeout);
+        if(!transport->is_connected()) {
+            return -1;
+        }
+        return I2CPP::attach_adapter(filename, transport);
+    }
+
+    bool BrokerTransport::is_connected() const
+    {
+        // A killed broker leaves running set in its orphaned segment, so check the process as well
+        return this->segment != nullptr && this->segment->running.load() != 0 && process_alive(this->segment->pid);
+    }
+
+    /** Make sure the segment of a running broker is mapped, remapping the current segment after the broker restarted */
+    bool BrokerTransport::connect()
+    {
+        if(this->is_connected()) {
+            return true;
+        }
+        this->disconnect();
+        this->segment = map_segment(this->name);
+        if(!this->is_connected()) {
+            errno = ENOTCONN;
+            return false;
+        }
+        return true;
+    }
+    void BrokerTransport::disconnect()
+    {
+        if(this->segment != nullptr) {
+            munmap(this->segment, sizeof(BrokerSegment));
+            this->segment = nullptr;
+        }
+    }
+
+    /** Take a free slot, starting from a different one in each process */
+    int BrokerTransport::claim()
+    {
+        if(!this->connect()) {
+            return -1;
+        }
+        for(uint32_t i = 0; i < detail::broker_slots; i++)
+        {
+            uint32_t index = uint32_t(this->pid + i) % detail::broker_slots;
+            BrokerSlot& slot = this->segment->slots[index];
+            uint32_t expected = detail::SLOT_FREE;
+            if(slot.state.load() == expected && slot.state.compare_exchange_strong(expected, detail::SLOT_CLAIMED)) {
+                slot.owner.store(this->pid);
+                return int(index);
+            }
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+    void BrokerTransport::release(uint32_t index)
+    {
+        BrokerSlot& slot = this->segment->slots[index];
+        slot.owner.store(0);
+        slot.state.store(detail::SLOT_FREE);
+    }
+
+    /**
+     * Queue a filled slot and wait for the broker to serve it.
+     * @returns True with the slot still held and its result set, false with the slot released and errno set
+     */
+    bool BrokerTransport::submit(uint32_t index)
+    {
+        BrokerSegment& shared = *this->segment;
+        BrokerSlot& slot = shared.slots[index];
+        slot.ticket = shared.tickets.fetch_add(1);
+        slot.state.store(detail::SLOT_SUBMITTED);
+        shared.doorbell.fetch_add(1);
+        if(shared.sleeping.load() != 0) {
+            futex_wake(shared.doorbell, 1);
+        }
+
+        // A broker which is awake usually answers within a few checks, with no system call at all
+        for(int i = 0; i < client_spins && slot.state.load() != detail::SLOT_DONE; i++) {
+            std::this_thread::yield();
+        }
+
+        int64_t deadline = this->timeout > 0 ? steady_ms() + this->timeout : 0;
+        uint32_t state;
+        while((state = slot.state.load()) != detail::SLOT_DONE)
+        {
+            int64_t remaining = deadline > 0 ? deadline - steady_ms() : int64_t(wait_slice);
+            if(remaining > 0 && shared.running.load() != 0 && process_alive(shared.pid))
+            {
+                slot.waiters.fetch_add(1);
+                futex_wait(slot.state, state, uint32_t(std::min<int64_t>(remaining, wait_slice)));
+                slot.waiters.fetch_sub(1);
+                continue;
+            }
+
+            int error = remaining > 0 ? ENOTCONN : ETIMEDOUT;
+            // Withdraw the request if the broker has not taken it yet, otherwise leave the slot to the broker
+            uint32_t expected = detail::SLOT_SUBMITTED;
+            if(slot.state.compare_exchange_strong(expected, detail::SLOT_CLAIMED)) {
+                this->release(index);
+                errno = error;
+                return false;
+            }
+            expected = detail::SLOT_BUSY;
+            if(slot.state.compare_exchange_strong(expected, detail::SLOT_ABANDONED)) {
+                errno = error;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int BrokerTransport::get_handle() const { return this->handle; }
+
+    int BrokerTransport::set_address(int address)
+    {
+        this->address = address;
+        return 0;
+    }
+
+    ssize_t BrokerTransport::read(uint_fast8_t* buffer, std::size_t length)
+    {
+        if(length > detail::broker_data) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        int index = this->claim();
+        if(index < 0) {
+            return -1;
+        }
+        BrokerSlot& slot = this->segment->slots[index];
+        slot.operation = detail::OPERATION_READ;
+        slot.address = this->address;
+        slot.count = uint32_t(length);
+        if(!this->submit(index)) {
+            return -1;
+        }
+        ssize_t result = ssize_t(slot.result);
+        if(result > 0) {
+            std::memcpy(buffer, slot.data, std::size_t(result) * sizeof(uint_fast8_t));
+        }
+        errno = slot.error;
+        this->release(index);
+        return result;
+    }
+    ssize_t BrokerTransport::write(const uint_fast8_t* buffer, std::size_t length)
+    {
+        if(length > detail::broker_data) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        int index = this->claim();
+        if(index < 0) {
+            return -1;
+        }
+        BrokerSlot& slot = this->segment->slots[index];
+        slot.operation = detail::OPERATION_WRITE;
+        slot.address = this->address;
+        slot.count = uint32_t(length);
+        std::memcpy(slot.data, buffer, length * sizeof(uint_fast8_t));
+        if(!this->submit(index)) {
+            return -1;
+        }
+        ssize_t result = ssize_t(slot.result);
+        errno = slot.error;
+        this->release(index);
+        return result;
+    }
+    int BrokerTransport::transfer(Message* messages, std::size_t count)
+    {
+        std::size_t total = 0;
+        for(std::size_t i = 0; i < count; i++) {
+            total += messages[i].length;
+        }
+        if(count > I2C_RDWR_IOCTL_MAX_MSGS || total > detail::broker_data) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        int index = this->claim();
+        if(index < 0) {
+            return -1;
+        }
+        BrokerSlot& slot = this->segment->slots[index];
+        slot.operation = detail::OPERATION_TRANSFER;
+        slot.count = uint32_t(count);
+        std::size_t offset = 0;
+        for(std::size_t i = 0; i < count; i++)
+        {
+            slot.messages[i] = detail::BrokerMessage{ uint16_t(messages[i].address), uint16_t(messages[i].length), uint8_t(messages[i].read) };
+            if(!messages[i].read) {
+                std::memcpy(slot.data + offset, messages[i].buffer, messages[i].length * sizeof(uint_fast8_t));
+            }
+            offset += messages[i].length;
+        }
+        if(!this->submit(index)) {
+            return -1;
+        }
+
+        int result = int(slot.result);
+        if(result >= 0)
+        {
+            offset = 0;
+            for(std::size_t i = 0; i < count; i++)
+            {
+                if(messages[i].read) {
+                    std::memcpy(messages[i].buffer, slot.data + offset, messages[i].length * sizeof(uint_fast8_t));
+                }
+                offset += messages[i].length;
+            }
+        }
+        errno = slot.error;
+        this->release(index);
+        return result;
+    }
+    unsigned long BrokerTransport::get_functionality()
+    {
+        return this->connect() ? static_cast<unsigned long>(this->segment->functionality) : Transport::get_functionality();
+    }
+    int BrokerTransport::set_pec(bool enable)
+    {
+        if(enable && (this->get_functionality() & I2C_FUNC_SMBUS_PEC) == 0) {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+        // Applied by the broker to each of this client's SMBus transactions
+        this->pec = enable;
+        return 0;
+    }
+    ssize_t BrokerTransport::smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length)
+    {
+        if(length > detail::broker_data) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        int index = this->claim();
+        if(index < 0) {
+            return -1;
+        }
+        BrokerSlot& slot = this->segment->slots[index];
+        slot.operation = detail::OPERATION_SMBUS;
+        slot.address = this->address;
+        slot.pec = this->pec ? 1 : 0;
+        slot.read = read ? 1 : 0;
+        slot.command = command;
+        slot.size = uint32_t(size);
+        slot.count = uint32_t(length);
+        if(!read) {
+            std::memcpy(slot.data, buffer, length * sizeof(uint_fast8_t));
+        }
+        if(!this->submit(index)) {
+            return -1;
+        }
+        ssize_t result = ssize_t(slot.result);
+        if(read && result > 0) {
+            std::memcpy(buffer, slot.data, length * sizeof(uint_fast8_t));
+        }
+        errno = slot.error;
+        this->release(index);
+        return result;
+    }
+}
@@ -0,0 +1,165 @@
+#include "i2cpp/bus_group.hpp"
+
+#include <time.h>
+
+#include "i2cpp/executor.hpp"
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** Current CLOCK_MONOTONIC time in nanoseconds */
+        int64_t monotonic_now()
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+        }
+
+        /** Decode a register's bytes as received from the bus */
+        uint_fast32_t decode(const uint_fast8_t* bytes, std::size_t width, Endian endian)
+        {
+            uint_fast32_t value = 0;
+            for(std::size_t i = 0; i < width; i++) {
+                value |= uint_fast32_t(bytes[i] & 0xff) << (8 * (endian == Endian::BIG ? width - 1 - i : i));
+            }
+            return value;
+        }
+    }
+
+
+    BusGroup::BusGroup() : total(0), remaining(0) {  }
+
+    std::size_t BusGroup::add(int adapter, int address, uint_fast8_t command, std::size_t width, Endian endian)
+    {
+        Bus* bus = nullptr;
+        for(std::unique_ptr<Bus>& existing : this->buses)
+        {
+            if(existing->adapter == adapter) {
+                bus = existing.get();
+            }
+        }
+        if(bus == nullptr)
+        {
+            this->buses.push_back(std::unique_ptr<Bus>(new Bus()));
+            bus = this->buses.back().get();
+            bus->adapter = adapter;
+            bus->times = Frame::Bus{ adapter, 0, 0, 0 };
+        }
+
+        Channel channel;
+        channel.address = address;
+        channel.command = command;
+        channel.width = width < 1 ? 1 : (width > 4 ? 4 : width);
+        channel.endian = endian;
+        channel.index = this->total++;
+        channel.value = 0;
+        channel.valid = false;
+        bus->channels.push_back(channel);
+        bus->messages.reserve(2 * bus->channels.size());
+        bus->batched.reserve(bus->channels.size());
+        return channel.index;
+    }
+    std::size_t BusGroup::add(const PCA9555& device) { return this->add<PCA9555::Registers::Input>(device); }
+    std::size_t BusGroup::add(const ADS1115& device) { return this->add<ADS1115::Registers::Conversion>(device); }
+
+    std::size_t BusGroup::size() const { return this->total; }
+
+    BusGroup::Frame BusGroup::make_frame() const
+    {
+        Frame frame;
+        frame.sequence = 0;
+        frame.values.assign(this->total, 0);
+        frame.valid.assign(this->total, 0);
+        frame.buses.resize(this->buses.size());
+        for(std::size_t i = 0; i < this->buses.size(); i++)
+        {
+            frame.buses[i].adapter = this->buses[i]->adapter;
+            frame.buses[i].started = frame.buses[i].finished = 0;
+            frame.buses[i].errors = 0;
+        }
+        return frame;
+    }
+
+    bool BusGroup::capture(Frame& frame)
+    {
+        if(frame.values.size() != this->total || frame.valid.size() != this->total || frame.buses.size() != this->buses.size()) {
+            uint64_t sequence = frame.sequence;
+            frame = this->make_frame();
+            frame.sequence = sequence;
+        }
+        frame.sequence++;
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->remaining = this->buses.size();
+        }
+        for(std::unique_ptr<Bus>& entry : this->buses)
+        {
+            Bus* bus = entry.get();
+            Executor::post(bus->adapter, [this, bus]() {
+                this->read_bus(*bus);
+                std::lock_guard<std::mutex> lock(this->mutex);
+                if(--this->remaining == 0) {
+                    this->done.notify_one();
+                }
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done.wait(lock, [this]() { return this->remaining == 0; });
+
+        bool success = true;
+        for(std::size_t i = 0; i < this->buses.size(); i++)
+        {
+            const Bus& bus = *this->buses[i];
+            for(const Channel& channel : bus.channels)
+            {
+                frame.values[channel.index] = channel.value;
+                frame.valid[channel.index] = channel.valid ? 1 : 0;
+            }
+            frame.buses[i] = bus.times;
+            success = success && bus.times.errors == 0;
+        }
+        return success;
+    }
+
+    /** Read one adapter's registers, on the adapter's Executor thread */
+    void BusGroup::read_bus(Bus& bus)
+    {
+        Frame::Bus& times = bus.times;
+        times.adapter = bus.adapter;
+        times.errors = 0;
+        times.started = monotonic_now();
+
+        // Registers the adapter can read with plain I2C go in one batch, the rest are read one by one
+        bus.messages.clear();
+        bus.batched.clear();
+        for(Channel& channel : bus.channels)
+        {
+            if(I2CPP::register_path(bus.adapter, channel.width, true) == I2CPP::RegisterPath::TRANSFER) {
+                bus.messages.push_back({ uint_fast8_t(channel.address), false, &channel.command, 1, 0 });
+                bus.messages.push_back({ uint_fast8_t(channel.address), true, channel.buffer, channel.width, 0 });
+                bus.batched.push_back(&channel);
+                continue;
+            }
+            channel.valid = I2CPP::read_register(bus.adapter, channel.address, channel.command, channel.buffer, channel.width) == channel.width;
+            channel.value = channel.valid ? decode(channel.buffer, channel.width, channel.endian) : 0;
+            times.errors += channel.valid ? 0 : 1;
+        }
+
+        if(!bus.messages.empty())
+        {
+            I2CPP::submit_batch(bus.adapter, bus.messages);
+            for(std::size_t i = 0; i < bus.batched.size(); i++)
+            {
+                Channel* channel = bus.batched[i];
+                channel->valid = bus.messages[2 * i].status == 0 && bus.messages[2 * i + 1].status == 0;
+                channel->value = channel->valid ? decode(channel->buffer, channel->width, channel->endian) : 0;
+                times.errors += channel->valid ? 0 : 1;
+            }
+        }
+        times.finished = monotonic_now();
+    }
+}
@@ -0,0 +1,130 @@
+#include "i2cpp/coro/scheduler.hpp"
+
+
+namespace i2cpp
+{
+    namespace coro
+    {
+        namespace
+        {
+            /** Scheduler of the calling worker thread */
+            thread_local Scheduler* current_scheduler = nullptr;
+        }
+
+
+        Scheduler::Scheduler(std::size_t threads) : sequence(0), tasks(0), stopping(false)
+        {
+            for(std::size_t i = 0; i < (threads < 1 ? 1 : threads); i++) {
+                this->workers.emplace_back(&Scheduler::run, this);
+            }
+        }
+        Scheduler::~Scheduler()
+        {
+            this->wait();
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->stopping = true;
+            }
+            this->ready.notify_all();
+            for(std::thread& worker : this->workers) {
+                worker.join();
+            }
+        }
+        Scheduler* Scheduler::current() { return current_scheduler; }
+
+        Scheduler::Detached Scheduler::launch(Scheduler* scheduler, Task<void> task)
+        {
+            try {
+                co_await task;
+            } catch(...) {
+                // A failing task must not take its worker down with it
+            }
+            scheduler->finished();
+        }
+        void Scheduler::spawn(Task<void> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->tasks++;
+            }
+            this->schedule(Scheduler::launch(this, std::move(task)).handle);
+        }
+        /** Count a spawned task as done, called by its Detached coroutine */
+        void Scheduler::finished()
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if(--this->tasks == 0) {
+                this->idle.notify_all();
+            }
+        }
+        void Scheduler::wait()
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->idle.wait(lock, [this]() { return this->tasks == 0; });
+        }
+        std::size_t Scheduler::active()
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            return this->tasks;
+        }
+
+        void Scheduler::schedule(std::coroutine_handle<> handle)
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->queue.push_back(handle);
+            }
+            this->ready.notify_one();
+        }
+        void Scheduler::schedule_at(Clock::time_point deadline, std::coroutine_handle<> handle)
+        {
+            bool earliest = false;
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                earliest = this->timers.empty() || deadline < this->timers.top().deadline;
+                this->timers.push(Timer{ deadline, this->sequence++, handle });
+            }
+            // Only a new earliest deadline changes how long idle workers should sleep
+            if(earliest) {
+                this->ready.notify_one();
+            }
+        }
+
+        /** Worker thread body: resume ready coroutines, releasing timers as they fall due */
+        void Scheduler::run()
+        {
+            current_scheduler = this;
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while(true)
+            {
+                Clock::time_point now = Clock::now();
+                while(!this->timers.empty() && this->timers.top().deadline <= now)
+                {
+                    this->queue.push_back(this->timers.top().handle);
+                    this->timers.pop();
+                }
+                if(!this->queue.empty())
+                {
+                    std::coroutine_handle<> handle = this->queue.front();
+                    this->queue.pop_front();
+                    // Let another worker pick up the rest of the queue meanwhile
+                    if(!this->queue.empty()) {
+                        this->ready.notify_one();
+                    }
+                    lock.unlock();
+                    handle.resume();
+                    lock.lock();
+                    continue;
+                }
+                if(this->stopping) {
+                    return;
+                }
+                if(this->timers.empty()) {
+                    this->ready.wait(lock);
+                } else {
+                    this->ready.wait_until(lock, this->timers.top().deadline);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#include "i2cpp/debouncer.hpp"
+
+
+namespace i2cpp
+{
+    const unsigned Debouncer::MAX_SAMPLES;
+    const std::size_t Debouncer::lane_width;
+    const std::size_t Debouncer::planes;
+
+    Debouncer::Debouncer(unsigned samples) : samples(samples < 1 ? 1 : (samples > MAX_SAMPLES ? MAX_SAMPLES : samples)) {  }
+
+    std::size_t Debouncer::add(PCA9555::SharedPtr device, Callback callback)
+    {
+        std::size_t index = this->entries.size();
+        Entry entry = { device, callback, this->group.add(*device) };
+        this->entries.push_back(entry);
+        this->frame = this->group.make_frame();
+
+        if(index % lane_width == 0)
+        {
+            this->inputs.push_back(0);
+            this->states.push_back(0);
+            this->known.push_back(0);
+            this->edges.push_back(0);
+            this->counters.resize(this->counters.size() + planes, 0);
+        }
+        // Left unknown if the read fails, so a failed read is not taken for every input low
+        uint_fast16_t initial = 0;
+        if(device->read_input(initial)) {
+            this->update(index, initial);
+        }
+        return index;
+    }
+    std::size_t Debouncer::size() const { return this->entries.size(); }
+
+    bool Debouncer::sweep()
+    {
+        bool success = this->group.capture(this->frame);
+        for(std::size_t i = 0; i < this->entries.size(); i++)
+        {
+            std::size_t channel = this->entries[i].channel;
+            if(this->frame.valid[channel]) {
+                this->update(i, uint_fast16_t(this->frame.values[channel]));
+            }
+        }
+        this->process();
+        return success;
+    }
+
+    void Debouncer::update(std::size_t index, uint_fast16_t input)
+    {
+        std::size_t shift = 16 * (index % lane_width);
+        uint64_t mask = uint64_t(0xffff) << shift;
+        uint64_t word = uint64_t(input & 0xffff) << shift;
+        uint64_t& lane = this->inputs[index / lane_width];
+        lane = (lane & ~mask) | word;
+
+        // The first input word of an expander with an unknown state becomes its state, without an edge
+        uint64_t& known = this->known[index / lane_width];
+        if((known & mask) == 0)
+        {
+            uint64_t& state = this->states[index / lane_width];
+            state = (state & ~mask) | word;
+            known |= mask;
+        }
+    }
+
+    std::size_t Debouncer::process()
+    {
+        // The bit pattern of samples - 1 in each plane, all ones or all zeroes
+        uint64_t target[planes];
+        for(std::size_t k = 0; k < planes; k++) {
+            target[k] = ((this->samples - 1) >> k) & 1 ? ~uint64_t(0) : 0;
+        }
+
+        bool any = false;
+        const std::size_t lanes = this->inputs.size();
+        for(std::size_t l = 0; l < lanes; l++)
+        {
+            uint64_t* counter = &this->counters[l * planes];
+            uint64_t differ = this->inputs[l] ^ this->states[l];
+
+            // Pins which have now disagreed for samples sweeps in a row take their new level
+            uint64_t reached = differ;
+            for(std::size_t k = 0; k < planes; k++) {
+                reached &= ~(counter[k] ^ target[k]);
+            }
+            this->states[l] ^= reached;
+            this->edges[l] = reached;
+            any = any || reached != 0;
+
+            // Count up pins still disagreeing, reset every other pin's count
+            uint64_t counting = differ & ~reached;
+            uint64_t carry = counting;
+            for(std::size_t k = 0; k < planes; k++)
+            {
+                uint64_t next = counter[k] & carry;
+                counter[k] = (counter[k] ^ carry) & counting;
+                carry = next;
+            }
+        }
+        if(!any) {
+            return 0;
+        }
+
+        std::size_t changed = 0;
+        for(std::size_t l = 0; l < lanes; l++)
+        {
+            for(uint64_t edge = this->edges[l]; edge != 0; )
+            {
+                std::size_t slot = 0;
+                while(((edge >> (16 * slot)) & 0xffff) == 0) {
+                    slot++;
+                }
+                std::size_t shift = 16 * slot;
+                edge &= ~(uint64_t(0xffff) << shift);
+
+                Entry& entry = this->entries[l * lane_width + slot];
+                uint_fast16_t bits = uint_fast16_t((this->edges[l] >> shift) & 0xffff);
+                uint_fast16_t state = uint_fast16_t((this->states[l] >> shift) & 0xffff);
+                changed++;
+                if(entry.callback) {
+                    entry.callback(*entry.device, state, bits & state, bits & ~state & 0xffff);
+                }
+            }
+        }
+        return changed;
+    }
+
+    uint_fast16_t Debouncer::get_state(std::size_t index) const
+    {
+        return uint_fast16_t((this->states[index / lane_width] >> (16 * (index % lane_width))) & 0xffff);
+    }
+    uint_fast16_t Debouncer::get_input(std::size_t index) const
+    {
+        return uint_fast16_t((this->inputs[index / lane_width] >> (16 * (index % lane_width))) & 0xffff);
+    }
+}
@@ -3,15 +3,21 @@
 
 namespace i2cpp
 {
-    Device::Device(int bus, uint_fast8_t address): address(address)
+    Device::Device(int bus, uint_fast8_t address): address(address), cached(false), max_age(0)
     {
         this->fd = I2CPP::open_adapter(bus);
     }
-    Device::Device(std::string filename, uint_fast8_t address): address(address)
+    Device::Device(std::string filename, uint_fast8_t address): address(address), cached(false), max_age(0)
     {
         this->fd = I2CPP::open_adapter(filename);
     }
     uint_fast8_t Device::get_address() const { return this->address; }
+    int Device::get_adapter() const { return this->fd; }
+    void Device::set_read_cache(bool enable, uint64_t max_age)
+    {
+        this->cached = enable;
+        this->max_age = max_age;
+    }
 
     std::size_t Device::write_i2c(uint_fast8_t* buffer, std::size_t length)
     {
@@ -21,4 +27,15 @@ namespace i2cpp
     {
         return I2CPP::read_i2c(this->fd, this->address, buffer, length);
     }
+    std::size_t Device::write_read_i2c(uint_fast8_t* out, std::size_t out_length, uint_fast8_t* in, std::size_t in_length)
+    {
+        return I2CPP::write_read_i2c(this->fd, this->address, out, out_length, in, in_length);
+    }
+    bool Device::transfer_i2c(Message* messages, std::size_t count)
+    {
+        for(std::size_t i = 0; i < count; i++) {
+            messages[i].address = this->address;
+        }
+        return I2CPP::transfer(this->fd, messages, count);
+    }
 }
\ No newline at end of file
@@ -1,9 +1,383 @@
 #include "i2cpp/devices/ads1115.hpp"
 
+#include <cerrno>
+#include <chrono>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+
 namespace i2cpp
 {
-    ADS1115::ADS1115(int bus, uint_fast8_t address) : Device(bus, address)
+    namespace
+    {
+        const double full_scales[8] = { 6.144, 4.096, 2.048, 1.024, 0.512, 0.256, 0.256, 0.256 };
+        const uint_fast16_t data_rates[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+
+        /** Current CLOCK_MONOTONIC time in nanoseconds */
+        int64_t monotonic_now()
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+        }
+        /** Sleep until an absolute CLOCK_MONOTONIC time in nanoseconds */
+        void monotonic_sleep_until(int64_t deadline)
+        {
+            struct timespec until;
+            until.tv_sec = deadline / 1000000000;
+            until.tv_nsec = deadline % 1000000000;
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) == EINTR) {  }
+        }
+        /** Time one conversion takes at a data rate, in nanoseconds */
+        int64_t conversion_period(ADS1115::DataRate rate)
+        {
+            return 1000000000 / int64_t(ADS1115::samples_per_second(rate));
+        }
+    }
+
+    ADS1115::Config::Config() : mux(Mux::AIN0_AIN1), gain(Gain::FS_2_048V), rate(DataRate::SPS_128), mode(Mode::SINGLE_SHOT),
+        comparator_mode(ComparatorMode::TRADITIONAL), comparator_active_high(false), comparator_latching(false),
+        comparator_queue(ComparatorQueue::DISABLED) {  }
+    uint_fast16_t ADS1115::Config::to_register() const
+    {
+        return Registers::Mux::make(this->mux) | Registers::Gain::make(this->gain) | Registers::Mode::make(this->mode)
+            | Registers::DataRate::make(this->rate) | Registers::ComparatorMode::make(this->comparator_mode)
+            | Registers::ComparatorPolarity::make(this->comparator_active_high)
+            | Registers::ComparatorLatch::make(this->comparator_latching) | Registers::ComparatorQueue::make(this->comparator_queue);
+    }
+    ADS1115::Config ADS1115::Config::from_register(uint_fast16_t value)
+    {
+        Config config;
+        config.mux = Registers::Mux::get(value);
+        // PGA codes 6 and 7 are aliases of the 0.256V range
+        config.gain = Registers::Gain::get(value) > Gain::FS_0_256V ? Gain::FS_0_256V : Registers::Gain::get(value);
+        config.mode = Registers::Mode::get(value);
+        config.rate = Registers::DataRate::get(value);
+        config.comparator_mode = Registers::ComparatorMode::get(value);
+        config.comparator_active_high = Registers::ComparatorPolarity::get(value);
+        config.comparator_latching = Registers::ComparatorLatch::get(value);
+        config.comparator_queue = Registers::ComparatorQueue::get(value);
+        return config;
+    }
+
+    ADS1115::ADS1115(int bus, uint_fast8_t address) : Device(bus, address), streaming(false), stop_fd(-1), ready_line(-1),
+        streamed(0), dropped(0), errors(0) {  }
+    ADS1115::ADS1115(std::string filename, uint_fast8_t address) : Device(filename, address), streaming(false), stop_fd(-1), ready_line(-1),
+        streamed(0), dropped(0), errors(0) {  }
+    ADS1115::~ADS1115() { this->stop_stream(); }
+
+
+    ADS1115::Config ADS1115::get_config() const { return this->config; }
+    ADS1115::Config ADS1115::read_config()
+    {
+        uint_fast16_t value = 0;
+        if(this->read_register<Registers::Config>(value)) {
+            this->config = Config::from_register(value);
+        }
+        return this->config;
+    }
+    bool ADS1115::write_config(const Config& config)
+    {
+        if(!this->write_register<Registers::Config>(config.to_register())) {
+            return false;
+        }
+        this->config = config;
+        return true;
+    }
+    bool ADS1115::set_mux(Mux mux)
     {
+        Config config = this->config;
+        config.mux = mux;
+        return this->write_config(config);
+    }
+    bool ADS1115::set_gain(Gain gain)
+    {
+        Config config = this->config;
+        config.gain = gain;
+        return this->write_config(config);
+    }
+    bool ADS1115::set_data_rate(DataRate rate)
+    {
+        Config config = this->config;
+        config.rate = rate;
+        return this->write_config(config);
+    }
+    bool ADS1115::set_mode(Mode mode)
+    {
+        Config config = this->config;
+        config.mode = mode;
+        return this->write_config(config);
+    }
+    bool ADS1115::set_comparator(ComparatorMode mode, bool active_high, bool latching, ComparatorQueue queue)
+    {
+        Config config = this->config;
+        config.comparator_mode = mode;
+        config.comparator_active_high = active_high;
+        config.comparator_latching = latching;
+        config.comparator_queue = queue;
+        return this->write_config(config);
+    }
+    bool ADS1115::write_thresholds(int_fast16_t low, int_fast16_t high)
+    {
+        return this->write_register<Registers::LowThreshold>(uint_fast16_t(low) & 0xffff)
+            && this->write_register<Registers::HighThreshold>(uint_fast16_t(high) & 0xffff);
+    }
+    bool ADS1115::read_thresholds(int_fast16_t& low, int_fast16_t& high)
+    {
+        uint_fast16_t low_value = 0;
+        uint_fast16_t high_value = 0;
+        if(!this->read_register<Registers::LowThreshold>(low_value) || !this->read_register<Registers::HighThreshold>(high_value)) {
+            return false;
+        }
+        low = int16_t(uint16_t(low_value));
+        high = int16_t(uint16_t(high_value));
+        return true;
+    }
+    bool ADS1115::enable_ready_pin(bool enable)
+    {
+        Config config = this->config;
+        if(enable)
+        {
+            // Hi_thresh MSB set and Lo_thresh MSB clear selects conversion-ready mode
+            config.comparator_latching = false;
+            if(config.comparator_queue == ComparatorQueue::DISABLED) {
+                config.comparator_queue = ComparatorQueue::ONE;
+            }
+            return this->write_register<Registers::LowThreshold>(0x0000) && this->write_register<Registers::HighThreshold>(0x8000)
+                && this->write_config(config);
+        }
+        config.comparator_queue = ComparatorQueue::DISABLED;
+        return this->write_config(config) && this->write_register<Registers::LowThreshold>(0x8000)
+            && this->write_register<Registers::HighThreshold>(0x7fff);
+    }
+
 
+    bool ADS1115::start_conversion()
+    {
+        return this->write_register<Registers::Config>(Registers::Status::set(this->config.to_register(), true));
+    }
+    bool ADS1115::is_converting()
+    {
+        uint_fast16_t value = 0;
+        return this->read_register<Registers::Config>(value) && !Registers::Status::get(value);
+    }
+    int_fast16_t ADS1115::read_conversion()
+    {
+        uint_fast16_t value = 0;
+        if(!this->read_register<Registers::Conversion>(value)) {
+            return 0;
+        }
+        return int16_t(uint16_t(value));
+    }
+    int_fast16_t ADS1115::read_single(Mux mux)
+    {
+        Config config = this->config;
+        config.mux = mux;
+        config.mode = Mode::SINGLE_SHOT;
+        if(!this->write_register<Registers::Config>(Registers::Status::set(config.to_register(), true))) {
+            return 0;
+        }
+        this->config = config;
+
+        // Sleep through the nominal conversion time, then poll in case the oscillator runs slow
+        int64_t period = conversion_period(config.rate);
+        int64_t start = monotonic_now();
+        int64_t deadline = start + 2 * period + 1000000;
+        monotonic_sleep_until(start + period);
+        while(true)
+        {
+            uint_fast16_t status = 0;
+            if(!this->read_register<Registers::Config>(status)) {
+                return 0;
+            }
+            if(Registers::Status::get(status)) {
+                break;
+            }
+            int64_t now = monotonic_now();
+            if(now > deadline) {
+                return 0;
+            }
+            monotonic_sleep_until(now + period / 16 + 50000);
+        }
+        return this->read_conversion();
+    }
+    double ADS1115::read_voltage(Mux mux) { return this->to_volts(this->read_single(mux)); }
+    double ADS1115::to_volts(int_fast16_t value) const { return value * ADS1115::full_scale(this->config.gain) / 32768.0; }
+    double ADS1115::full_scale(Gain gain) { return full_scales[uint_fast8_t(gain) & 0x07]; }
+    uint_fast16_t ADS1115::samples_per_second(DataRate rate) { return data_rates[uint_fast8_t(rate) & 0x07]; }
+
+
+    bool ADS1115::start_stream(Mux mux, DataRate rate, std::size_t capacity, int ready_line)
+    {
+        if(this->streaming.load()) {
+            return false;
+        }
+        Config config = this->config;
+        config.mux = mux;
+        config.rate = rate;
+        config.mode = Mode::CONTINUOUS;
+        if(ready_line >= 0)
+        {
+            config.comparator_latching = false;
+            if(config.comparator_queue == ComparatorQueue::DISABLED) {
+                config.comparator_queue = ComparatorQueue::ONE;
+            }
+            if(!this->write_register<Registers::LowThreshold>(0x0000) || !this->write_register<Registers::HighThreshold>(0x8000)) {
+                return false;
+            }
+        }
+        if(!this->write_config(config)) {
+            return false;
+        }
+        // Leave the address pointer on the conversion register, so every sample is a bare 2-byte read
+        uint_fast8_t pointer = Registers::Conversion::address;
+        if(this->write_i2c(&pointer, 1) != 1) {
+            return false;
+        }
+
+        this->stop_fd = eventfd(0, EFD_CLOEXEC);
+        if(this->stop_fd < 0) {
+            return false;
+        }
+        this->samples.reset(new RingBuffer<Sample>(capacity));
+        this->streamed.store(0);
+        this->dropped.store(0);
+        this->errors.store(0);
+        this->ready_line = ready_line;
+        this->streaming.store(true);
+        this->stream_thread = std::thread(&ADS1115::stream, this, conversion_period(rate));
+        return true;
+    }
+    void ADS1115::stop_stream()
+    {
+        if(!this->streaming.exchange(false)) {
+            return;
+        }
+        uint64_t one = 1;
+        ssize_t written = write(this->stop_fd, &one, sizeof(one));
+        (void)written;
+        this->stream_thread.join();
+        close(this->stop_fd);
+        this->stop_fd = -1;
+
+        Config config = this->config;
+        config.mode = Mode::SINGLE_SHOT;
+        this->write_config(config);
+    }
+    bool ADS1115::is_streaming() const { return this->streaming.load(); }
+    std::size_t ADS1115::read_samples(Sample* samples, std::size_t count)
+    {
+        if(!this->samples) {
+            return 0;
+        }
+        return this->samples->pop(samples, count);
+    }
+    std::size_t ADS1115::available() const
+    {
+        if(!this->samples) {
+            return 0;
+        }
+        return this->samples->size();
+    }
+    ADS1115::StreamStatistics ADS1115::get_stream_statistics() const
+    {
+        StreamStatistics statistics;
+        statistics.samples = this->streamed.load(std::memory_order_relaxed);
+        statistics.dropped = this->dropped.load(std::memory_order_relaxed);
+        statistics.errors = this->errors.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+
+    /** Stream thread: wait for each conversion, read it and queue it */
+    void ADS1115::stream(int64_t period)
+    {
+        // Streamed conversions are background reads, so give way to control and urgent transactions
+        PriorityScope bulk(BusPriority::BULK);
+        // Timed reads run a quarter period behind the conversions, so small drift never reads one twice
+        int64_t next = monotonic_now() + period + period / 4;
+        while(this->streaming.load(std::memory_order_relaxed))
+        {
+            if(this->ready_line >= 0)
+            {
+                struct pollfd fds[2] = { { this->ready_line, POLLIN, 0 }, { this->stop_fd, POLLIN, 0 } };
+                if(poll(fds, 2, -1) < 0)
+                {
+                    if(errno == EINTR) {
+                        continue;
+                    }
+                    this->errors.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                if(fds[1].revents != 0) {
+                    break;
+                }
+                if((fds[0].revents & POLLIN) == 0)
+                {
+                    this->errors.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                // Consume the edge events, their contents are not needed
+                char discard[256];
+                ssize_t consumed = read(this->ready_line, discard, sizeof(discard));
+                (void)consumed;
+            }
+            else
+            {
+                monotonic_sleep_until(next);
+                if(!this->streaming.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                int64_t now = monotonic_now();
+                next += period;
+                if(now >= next)
+                {
+                    // Woke more than a period late: the conversions in between were overwritten
+                    int64_t missed = (now - next) / period + 1;
+                    this->dropped.fetch_add(uint64_t(missed), std::memory_order_relaxed);
+                    next += missed * period;
+                }
+            }
+
+            Sample sample;
+            sample.timestamp = monotonic_now();
+            uint_fast8_t buffer[2] = { 0x00, 0x00 };
+            if(this->read_i2c(buffer, 2) != 2)
+            {
+                this->errors.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            sample.value = int16_t(uint16_t(Registers::Conversion::decode(buffer)));
+            if(this->samples->push(sample)) {
+                this->streamed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                this->dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Read a register; fails while streaming, since the stream owns the address pointer */
+    template<typename Reg>
+    bool ADS1115::read_register(uint_fast16_t& value)
+    {
+        if(this->streaming.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        // Config carries the conversion status bit, which must never be served from the read cache
+        if(Reg::address == Registers::Config::address) {
+            return this->Device::read_register_direct<Reg>(value);
+        }
+        return this->Device::read_register<Reg>(value);
+    }
+    /** Write a register; fails while streaming, since the stream owns the address pointer */
+    template<typename Reg>
+    bool ADS1115::write_register(uint_fast16_t value)
+    {
+        if(this->streaming.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return this->Device::write_register<Reg>(value);
     }
-}
\ No newline at end of file
+}
@@ -3,71 +3,280 @@
 
 namespace i2cpp
 {
-    PCA9555::PCA9555(int bus, uint_fast8_t address) : Device(bus, address) {  }
+    PCA9555::PCA9555(int bus, uint_fast8_t address) : Device(bus, address), prev_state(0), shadowing(false), shadow_valid(0), shadow{ 0, 0, 0 },
+        updating(false), staged_mask(0), committed_mask(0), staged{ 0, 0, 0 }, committed{ 0, 0, 0 } {  }
+    PCA9555::PCA9555(std::string filename, uint_fast8_t address) : Device(filename, address), prev_state(0), shadowing(false), shadow_valid(0), shadow{ 0, 0, 0 },
+        updating(false), staged_mask(0), committed_mask(0), staged{ 0, 0, 0 }, committed{ 0, 0, 0 } {  }
     uint_fast16_t PCA9555::get_state() const { return this->prev_state; }
     void PCA9555::set_state(uint_fast16_t state) { this->prev_state = state; }
 
+    void PCA9555::enable_shadow(bool enable)
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        this->shadowing = enable;
+        this->shadow_valid = 0;
+    }
+    bool PCA9555::is_shadow_enabled() const
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        return this->shadowing;
+    }
+    bool PCA9555::resync_shadow()
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        this->shadow_valid = 0;
+        bool success = this->resync_register<Registers::Output>();
+        success = this->resync_register<Registers::Polarity>() && success;
+        return this->resync_register<Registers::Configuration>() && success;
+    }
+    void PCA9555::invalidate_shadow()
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        this->shadow_valid = 0;
+    }
+
+    PCA9555::Update::Update(PCA9555& device) : device(device), done(false) { device.begin_update(); }
+    PCA9555::Update::~Update()
+    {
+        if(!this->done) {
+            this->device.commit_update();
+        }
+    }
+    bool PCA9555::Update::commit()
+    {
+        this->done = true;
+        return this->device.commit_update();
+    }
+    void PCA9555::Update::cancel()
+    {
+        this->done = true;
+        this->device.cancel_update();
+    }
 
-    uint_fast16_t PCA9555::read_input() { return this->read_register(0x00); }
-    bool PCA9555::read_input_pin(uint_fast8_t pin) { return this->read_register_pin(0x00, pin); }
+    void PCA9555::begin_update()
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        this->updating = true;
+        this->staged_mask = 0;
+        this->committed_mask = 0;
+    }
+    bool PCA9555::commit_update()
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        if(!this->updating) {
+            return true;
+        }
+        this->updating = false;
+        bool success = this->commit_register<Registers::Polarity>();
+        success = this->commit_register<Registers::Output>() && success;
+        success = this->commit_register<Registers::Configuration>() && success;
+        this->staged_mask = 0;
+        this->committed_mask = 0;
+        return success;
+    }
+    void PCA9555::cancel_update()
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        this->updating = false;
+        this->staged_mask = 0;
+        this->committed_mask = 0;
+    }
+    bool PCA9555::is_updating() const
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        return this->updating;
+    }
+
+
+    uint_fast16_t PCA9555::read_input() { return this->read_register<Registers::Input>(); }
+    bool PCA9555::read_input(uint_fast16_t& value)
+    {
+        bool success = false;
+        uint_fast16_t data = this->fetch_register<Registers::Input>(success);
+        if(success) {
+            value = data;
+        }
+        return success;
+    }
+    bool PCA9555::read_input_pin(uint_fast8_t pin) { return this->read_register_pin<Registers::Input>(pin); }
 
-    uint_fast16_t PCA9555::read_output() { return this->read_register(0x02); }
-    bool PCA9555::read_output_pin(uint_fast8_t pin) { return this->read_register_pin(0x02, pin); }
+    uint_fast16_t PCA9555::read_output() { return this->read_register<Registers::Output>(); }
+    bool PCA9555::read_output_pin(uint_fast8_t pin) { return this->read_register_pin<Registers::Output>(pin); }
 
-    uint_fast16_t PCA9555::read_polarity() { return this->read_register(0x04); }
-    bool PCA9555::read_polarity_pin(uint_fast8_t pin) { return this->read_register_pin(0x04, pin); }
+    uint_fast16_t PCA9555::read_polarity() { return this->read_register<Registers::Polarity>(); }
+    bool PCA9555::read_polarity_pin(uint_fast8_t pin) { return this->read_register_pin<Registers::Polarity>(pin); }
 
-    uint_fast16_t PCA9555::read_config() { return this->read_register(0x06); }
-    bool PCA9555::read_config_pin(uint_fast8_t pin) { return this->read_register_pin(0x06, pin); }
+    uint_fast16_t PCA9555::read_config() { return this->read_register<Registers::Configuration>(); }
+    bool PCA9555::read_config_pin(uint_fast8_t pin) { return this->read_register_pin<Registers::Configuration>(pin); }
 
 
-    bool PCA9555::write_output(uint_fast16_t data) { return this->write_register(0x02, data); }
-    bool PCA9555::write_output_pin(uint_fast8_t pin, bool value) { return this->write_register_pin(0x02, pin, value); }
-    bool PCA9555::write_output_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values) { return this->write_register_range(0x02, start_pin, end_pin, values); }
-    bool PCA9555::flip_output_pin(uint_fast8_t pin) { return this->flip_register_pin(0x02, pin); }
+    bool PCA9555::write_output(uint_fast16_t data) { return this->write_register<Registers::Output>(data); }
+    bool PCA9555::write_output_pin(uint_fast8_t pin, bool value) { return this->write_register_pin<Registers::Output>(pin, value); }
+    bool PCA9555::write_output_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values) { return this->write_register_range<Registers::Output>(start_pin, end_pin, values); }
+    bool PCA9555::flip_output_pin(uint_fast8_t pin) { return this->flip_register_pin<Registers::Output>(pin); }
 
-    bool PCA9555::write_polarity(uint_fast16_t data) { return this->write_register(0x04, data); }
-    bool PCA9555::write_polarity_pin(uint_fast8_t pin, bool value) { return this->write_register_pin(0x04, pin, value); }
-    bool PCA9555::write_polarity_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values) { return this->write_register_range(0x04, start_pin, end_pin, values); }
-    bool PCA9555::flip_polarity_pin(uint_fast8_t pin) { return this->flip_register_pin(0x04, pin); }
+    bool PCA9555::write_polarity(uint_fast16_t data) { return this->write_register<Registers::Polarity>(data); }
+    bool PCA9555::write_polarity_pin(uint_fast8_t pin, bool value) { return this->write_register_pin<Registers::Polarity>(pin, value); }
+    bool PCA9555::write_polarity_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values) { return this->write_register_range<Registers::Polarity>(start_pin, end_pin, values); }
+    bool PCA9555::flip_polarity_pin(uint_fast8_t pin) { return this->flip_register_pin<Registers::Polarity>(pin); }
 
-    bool PCA9555::write_config(uint_fast16_t data) { return this->write_register(0x06, data); }
-    bool PCA9555::write_config_pin(uint_fast8_t pin, bool value) { return this->write_register_pin(0x06, pin, value); }
-    bool PCA9555::write_config_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values) { return this->write_register_range(0x06, start_pin, end_pin, values); }
-    bool PCA9555::flip_config_pin(uint_fast8_t pin) { return this->flip_register_pin(0x06, pin); }
+    bool PCA9555::write_config(uint_fast16_t data) { return this->write_register<Registers::Configuration>(data); }
+    bool PCA9555::write_config_pin(uint_fast8_t pin, bool value) { return this->write_register_pin<Registers::Configuration>(pin, value); }
+    bool PCA9555::write_config_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values) { return this->write_register_range<Registers::Configuration>(start_pin, end_pin, values); }
+    bool PCA9555::flip_config_pin(uint_fast8_t pin) { return this->flip_register_pin<Registers::Configuration>(pin); }
 
 
+    std::future<uint_fast16_t> PCA9555::read_input_async() { return this->run_async<uint_fast16_t>([this]() { return this->read_input(); }); }
+    void PCA9555::read_input_async(std::function<void(uint_fast16_t)> callback) { this->run_async<uint_fast16_t>([this]() { return this->read_input(); }, callback); }
+    // Queued jobs skip deferred updates, which belong to the thread that began them
+    std::future<uint_fast16_t> PCA9555::read_output_async() { return this->run_async<uint_fast16_t>([this]() { return this->read_register_now<Registers::Output>(); }); }
+    void PCA9555::read_output_async(std::function<void(uint_fast16_t)> callback) { this->run_async<uint_fast16_t>([this]() { return this->read_register_now<Registers::Output>(); }, callback); }
+    std::future<uint_fast16_t> PCA9555::read_polarity_async() { return this->run_async<uint_fast16_t>([this]() { return this->read_register_now<Registers::Polarity>(); }); }
+    void PCA9555::read_polarity_async(std::function<void(uint_fast16_t)> callback) { this->run_async<uint_fast16_t>([this]() { return this->read_register_now<Registers::Polarity>(); }, callback); }
+    std::future<uint_fast16_t> PCA9555::read_config_async() { return this->run_async<uint_fast16_t>([this]() { return this->read_register_now<Registers::Configuration>(); }); }
+    void PCA9555::read_config_async(std::function<void(uint_fast16_t)> callback) { this->run_async<uint_fast16_t>([this]() { return this->read_register_now<Registers::Configuration>(); }, callback); }
 
-    uint_fast16_t PCA9555::read_register(uint_fast8_t reg)
+    std::future<bool> PCA9555::write_output_async(uint_fast16_t data) { return this->run_async<bool>([this, data]() { return this->write_register_now<Registers::Output>(data); }); }
+    void PCA9555::write_output_async(uint_fast16_t data, std::function<void(bool)> callback) { this->run_async<bool>([this, data]() { return this->write_register_now<Registers::Output>(data); }, callback); }
+    std::future<bool> PCA9555::write_polarity_async(uint_fast16_t data) { return this->run_async<bool>([this, data]() { return this->write_register_now<Registers::Polarity>(data); }); }
+    void PCA9555::write_polarity_async(uint_fast16_t data, std::function<void(bool)> callback) { this->run_async<bool>([this, data]() { return this->write_register_now<Registers::Polarity>(data); }, callback); }
+    std::future<bool> PCA9555::write_config_async(uint_fast16_t data) { return this->run_async<bool>([this, data]() { return this->write_register_now<Registers::Configuration>(data); }); }
+    void PCA9555::write_config_async(uint_fast16_t data, std::function<void(bool)> callback) { this->run_async<bool>([this, data]() { return this->write_register_now<Registers::Configuration>(data); }, callback); }
+
+
+    template<typename Reg>
+    bool PCA9555::is_shadowed() const
+    {
+        return Reg::writable && this->shadowing && (this->shadow_valid & (1 << PCA9555::slot<Reg>())) != 0;
+    }
+    /**
+     * Read a register from the board, bypassing the shadow.
+     * Only the input register goes through the read cache. The others feed read-modify-write
+     * sequences, which must start from the board's current value rather than a shared earlier read.
+     */
+    template<typename Reg>
+    uint_fast16_t PCA9555::fetch_register(bool& success)
     {
-        uint_fast8_t buffer[3] = { reg, 0x00, 0x00 };
-        this->read_i2c(buffer, 3);
-        return uint_fast16_t((buffer[1] << 8) | buffer[0]);
+        uint_fast16_t data = 0;
+        success = Reg::writable ? this->Device::read_register_direct<Reg>(data) : this->Device::read_register<Reg>(data);
+        return data;
     }
-    bool PCA9555::read_register_pin(uint_fast8_t reg, uint_fast8_t pin)
+
+    /** Current value of a register: pending during an update, otherwise served from the shadow when possible */
+    template<typename Reg>
+    uint_fast16_t PCA9555::read_register()
     {
-        uint_fast16_t pins = this->read_register(reg);
+        bool success = false;
+        // The input register is never shadowed nor staged, so its reads need no lock
+        if(!Reg::writable) {
+            return this->fetch_register<Reg>(success);
+        }
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        const uint_fast8_t slot = PCA9555::slot<Reg>();
+        if(Reg::writable && this->updating) {
+            if((this->staged_mask & (1 << slot)) == 0) {
+                this->committed[slot] = this->load_register<Reg>(success);
+                this->staged[slot] = this->committed[slot];
+                this->staged_mask |= (1 << slot);
+                if(success) {
+                    this->committed_mask |= (1 << slot);
+                }
+            }
+            return this->staged[slot];
+        }
+        return this->load_register<Reg>(success);
+    }
+    /** Value of a register on the board, ignoring any deferred update */
+    template<typename Reg>
+    uint_fast16_t PCA9555::read_register_now()
+    {
+        bool success = false;
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        return this->load_register<Reg>(success);
+    }
+    /** Value of a register on the board, served from the shadow when possible */
+    template<typename Reg>
+    uint_fast16_t PCA9555::load_register(bool& success)
+    {
+        const uint_fast8_t slot = PCA9555::slot<Reg>();
+        if(this->is_shadowed<Reg>()) {
+            success = true;
+            return this->shadow[slot];
+        }
+        uint_fast16_t data = this->fetch_register<Reg>(success);
+        if(success && this->shadowing && Reg::writable) {
+            this->shadow[slot] = data;
+            this->shadow_valid |= (1 << slot);
+        }
+        return data;
+    }
+    template<typename Reg>
+    bool PCA9555::read_register_pin(uint_fast8_t pin)
+    {
+        uint_fast16_t pins = this->read_register<Reg>();
         return (pins & (1 << pin)) > 0;
     }
+    /** Reload one register's shadow from the board */
+    template<typename Reg>
+    bool PCA9555::resync_register()
+    {
+        bool success = false;
+        uint_fast16_t data = this->fetch_register<Reg>(success);
+        if(success && this->shadowing) {
+            this->shadow[PCA9555::slot<Reg>()] = data;
+            this->shadow_valid |= (1 << PCA9555::slot<Reg>());
+        }
+        return success;
+    }
 
-    bool PCA9555::write_register(uint_fast8_t reg, uint_fast16_t data)
+    template<typename Reg>
+    bool PCA9555::write_register(uint_fast16_t data)
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        const uint_fast8_t slot = PCA9555::slot<Reg>();
+        if(this->updating) {
+            this->staged[slot] = data & 0xffff;
+            this->staged_mask |= (1 << slot);
+            return true;
+        }
+        return this->write_register_now<Reg>(data);
+    }
+    /** Write a register to the board, ignoring any deferred update */
+    template<typename Reg>
+    bool PCA9555::write_register_now(uint_fast16_t data)
     {
-        uint_fast8_t buffer[3] = { reg, uint_fast8_t(data & 0xff), uint_fast8_t(data >> 8) };
-        return this->write_i2c(buffer, 3) == 3;
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        const uint_fast8_t slot = PCA9555::slot<Reg>();
+        bool success = this->Device::write_register<Reg>(data & 0xffff);
+        if(this->shadowing) {
+            if(success) {
+                this->shadow[slot] = data & 0xffff;
+                this->shadow_valid |= (1 << slot);
+            } else {
+                this->shadow_valid &= ~(1 << slot);
+            }
+        }
+        // The board no longer holds the value recorded when the register was staged, so commit must send it
+        this->committed_mask &= ~(1 << slot);
+        return success;
     }
-    bool PCA9555::write_register_pin(uint_fast8_t reg, uint_fast8_t pin, bool value)
+    template<typename Reg>
+    bool PCA9555::write_register_pin(uint_fast8_t pin, bool value)
     {
-        uint_fast16_t old = this->read_register(reg);
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        uint_fast16_t old = this->read_register<Reg>();
         if(value) {
             old |= (1 << pin);
         } else {
             old &= ~(1 << pin);
         }
-        return this->write_register(reg, old);
+        return this->write_register<Reg>(old);
     }
-    bool PCA9555::write_register_range(uint_fast8_t reg, uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values)
+    template<typename Reg>
+    bool PCA9555::write_register_range(uint_fast8_t start_pin, uint_fast8_t end_pin, uint_fast16_t values)
     {
-        uint_fast16_t old = this->read_register(reg);
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        uint_fast16_t old = this->read_register<Reg>();
         for(uint_fast8_t i = start_pin; i < end_pin; i++)
         {
             if((values & (1 << (i - start_pin))) > 0) {
@@ -76,16 +285,31 @@ namespace i2cpp
                 old &= ~(1 << i);
             }
         }
-        return this->write_register(reg, old);
+        return this->write_register<Reg>(old);
     }
-    bool PCA9555::flip_register_pin(uint_fast8_t reg, uint_fast8_t pin)
+    template<typename Reg>
+    bool PCA9555::flip_register_pin(uint_fast8_t pin)
     {
-        uint_fast16_t old = this->read_register(reg);
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        uint_fast16_t old = this->read_register<Reg>();
         if((old & (1 << pin)) == 0) {
             old |= (1 << pin);
         } else {
             old &= ~(1 << pin);
         }
-        return this->write_register(reg, old);
+        return this->write_register<Reg>(old);
+    }
+    /** Send one register's staged value, unless it is known to be on the board already */
+    template<typename Reg>
+    bool PCA9555::commit_register()
+    {
+        const uint_fast8_t slot = PCA9555::slot<Reg>();
+        if((this->staged_mask & (1 << slot)) == 0) {
+            return true;
+        }
+        if((this->committed_mask & (1 << slot)) != 0 && this->committed[slot] == this->staged[slot]) {
+            return true;
+        }
+        return this->write_register<Reg>(this->staged[slot]);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,230 @@
+#include "i2cpp/discovery.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <dirent.h>
+
+#include "i2cpp/i2cpp.hpp"
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** First line of a cache file, identifying its format */
+        const char* const inventory_header = "i2cpp-inventory 1";
+
+        /** Bus number of an i2c-dev path, -1 if it is not one */
+        long bus_number(const std::string& path)
+        {
+            std::size_t name = path.rfind('/');
+            name = name == std::string::npos ? 0 : name + 1;
+            if(path.compare(name, 4, "i2c-") != 0 || path.size() == name + 4) {
+                return -1;
+            }
+            char* end = nullptr;
+            long number = std::strtol(path.c_str() + name + 4, &end, 10);
+            return *end == '\0' ? number : -1;
+        }
+    }
+
+
+    const Inventory::Bus* Inventory::find(const std::string& filename) const
+    {
+        for(const Bus& bus : this->buses)
+        {
+            if(bus.filename == filename) {
+                return &bus;
+            }
+        }
+        return nullptr;
+    }
+    bool Inventory::contains(const std::string& filename, int address) const
+    {
+        const Bus* bus = this->find(filename);
+        return bus != nullptr && std::binary_search(bus->addresses.begin(), bus->addresses.end(), uint_fast8_t(address));
+    }
+
+
+    std::vector<std::string> Discovery::list_adapters(const std::string& directory)
+    {
+        std::vector<std::string> filenames;
+        DIR* dir = opendir(directory.c_str());
+        if(dir == nullptr) {
+            return filenames;
+        }
+        while(struct dirent* entry = readdir(dir))
+        {
+            std::string path = directory + "/" + entry->d_name;
+            if(bus_number(path) >= 0) {
+                filenames.push_back(path);
+            }
+        }
+        closedir(dir);
+
+        std::sort(filenames.begin(), filenames.end(), [](const std::string& a, const std::string& b) {
+            return bus_number(a) < bus_number(b);
+        });
+        return filenames;
+    }
+
+    Inventory::Bus Discovery::scan(const std::string& filename, int first_address, int last_address)
+    {
+        Inventory::Bus bus;
+        bus.filename = filename;
+        int adapter = I2CPP::open_adapter(filename);
+        bus.available = adapter >= 0;
+        bus.functionality = bus.available ? I2CPP::get_functionality(adapter) : 0;
+        for(int address = first_address; bus.available && address <= last_address; address++)
+        {
+            if(I2CPP::probe(adapter, address)) {
+                bus.addresses.push_back(uint_fast8_t(address));
+            }
+        }
+        return bus;
+    }
+
+    Inventory Discovery::discover(const std::vector<std::string>& filenames, int first_address, int last_address)
+    {
+        Inventory inventory;
+        inventory.first_address = first_address;
+        inventory.last_address = last_address;
+        inventory.buses.resize(filenames.size());
+
+        // Each worker fills in its own entry, so they share nothing but the I2CPP registry
+        std::vector<std::thread> workers;
+        for(std::size_t i = 0; i < filenames.size(); i++)
+        {
+            Inventory::Bus* bus = &inventory.buses[i];
+            const std::string* filename = &filenames[i];
+            workers.push_back(std::thread([bus, filename, first_address, last_address]() {
+                *bus = Discovery::scan(*filename, first_address, last_address);
+            }));
+        }
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+        return inventory;
+    }
+    Inventory Discovery::discover() { return Discovery::discover(Discovery::list_adapters()); }
+
+    bool Discovery::save(const Inventory& inventory, const std::string& path)
+    {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary.c_str(), std::ios::trunc);
+            if(!file) {
+                return false;
+            }
+            file << inventory_header << ' ' << inventory.first_address << ' ' << inventory.last_address << '\n';
+            file << std::hex;
+            for(const Inventory::Bus& bus : inventory.buses)
+            {
+                file << (bus.available ? 1 : 0) << ' ' << bus.functionality << ' ' << bus.addresses.size();
+                for(uint_fast8_t address : bus.addresses) {
+                    file << ' ' << unsigned(address);
+                }
+                file << ' ' << bus.filename << '\n';
+            }
+            file.flush();
+            if(!file) {
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+    bool Discovery::load(const std::string& path, Inventory& inventory)
+    {
+        std::ifstream file(path.c_str());
+        std::string line;
+        if(!std::getline(file, line) || line.compare(0, std::string(inventory_header).size(), inventory_header) != 0) {
+            return false;
+        }
+        Inventory loaded;
+        std::istringstream header(line.substr(std::string(inventory_header).size()));
+        if(!(header >> loaded.first_address >> loaded.last_address)) {
+            return false;
+        }
+
+        while(std::getline(file, line))
+        {
+            // The filename comes last and takes the rest of the line, so it may contain spaces
+            std::istringstream fields(line);
+            Inventory::Bus bus;
+            unsigned available;
+            std::size_t count;
+            if(!(fields >> std::hex >> available >> bus.functionality >> count) || count > 128) {
+                return false;
+            }
+            bus.available = available != 0;
+            for(std::size_t i = 0; i < count; i++)
+            {
+                unsigned address;
+                if(!(fields >> address) || address > 0x7f) {
+                    return false;
+                }
+                bus.addresses.push_back(uint_fast8_t(address));
+            }
+            fields.get();
+            if(!std::getline(fields, bus.filename) || bus.filename.empty()) {
+                return false;
+            }
+            loaded.buses.push_back(bus);
+        }
+        inventory = loaded;
+        return true;
+    }
+
+    bool Discovery::verify(const Inventory& inventory, const std::vector<std::string>& filenames, int first_address, int last_address)
+    {
+        if(inventory.first_address != first_address || inventory.last_address != last_address
+                || inventory.buses.size() != filenames.size()) {
+            return false;
+        }
+        for(const std::string& filename : filenames)
+        {
+            const Inventory::Bus* bus = inventory.find(filename);
+            if(bus == nullptr) {
+                return false;
+            }
+            int adapter = I2CPP::open_adapter(filename);
+            if((adapter >= 0) != bus->available) {
+                return false;
+            }
+            if(adapter < 0) {
+                continue;
+            }
+            if(I2CPP::get_functionality(adapter) != bus->functionality) {
+                return false;
+            }
+            for(uint_fast8_t address : bus->addresses)
+            {
+                if(!I2CPP::probe(adapter, address)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    Inventory Discovery::load_or_discover(const std::string& path, const std::vector<std::string>& filenames, int first_address, int last_address)
+    {
+        Inventory inventory;
+        if(Discovery::load(path, inventory) && Discovery::verify(inventory, filenames, first_address, last_address)) {
+            return inventory;
+        }
+        inventory = Discovery::discover(filenames, first_address, last_address);
+        Discovery::save(inventory, path);
+        return inventory;
+    }
+    Inventory Discovery::load_or_discover(const std::string& path)
+    {
+        return Discovery::load_or_discover(path, Discovery::list_adapters());
+    }
+}
@@ -0,0 +1,140 @@
+#include "i2cpp/executor.hpp"
+
+
+namespace i2cpp
+{
+    Executor &Executor::instance() {
+        static Executor inst;
+        return inst;
+    }
+
+    void Executor::post(int adapter, Job job) {
+        Node* node = new Node();
+        node->job = std::move(job);
+        node->priority = PriorityScope::current();
+        instance()._worker(adapter).push(node);
+    }
+
+
+    Executor::Executor() {
+        for (int i = 0; i < Executor::lookup_size; i++) {
+            this->lookup[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    /** Finishes every queued job, then stops all I/O threads */
+    Executor::~Executor() {
+        std::map<int, std::unique_ptr<Worker>>::iterator itr;
+        for (itr = this->workers.begin(); itr != this->workers.end(); itr++) {
+            Worker& worker = *itr->second;
+            worker.running.store(false);
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.wakeup.notify_one();
+            }
+            worker.thread.join();
+        }
+    }
+
+    /** Find the Worker for an adapter, starting its thread on first use */
+    Executor::Worker& Executor::_worker(int adapter) {
+        if (adapter >= 0 && adapter < Executor::lookup_size) {
+            Worker* found = this->lookup[adapter].load(std::memory_order_acquire);
+            if (found != nullptr) {
+                return *found;
+            }
+        }
+        std::lock_guard<std::mutex> lock(this->start_mutex);
+        std::unique_ptr<Worker>& worker = this->workers[adapter];
+        if (!worker) {
+            worker.reset(new Worker());
+            worker->thread = std::thread(&Worker::run, worker.get());
+            if (adapter >= 0 && adapter < Executor::lookup_size) {
+                this->lookup[adapter].store(worker.get(), std::memory_order_release);
+            }
+        }
+        return *worker;
+    }
+
+
+    Executor::Worker::Worker(): tail(&stub), sleeping(false), running(true) {
+        this->stub.next.store(nullptr, std::memory_order_relaxed);
+        this->head.store(&this->stub, std::memory_order_relaxed);
+    }
+
+    /** Append a node, safe to call from any thread */
+    void Executor::Worker::push(Node* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = this->head.exchange(node);
+        prev->next.store(node, std::memory_order_release);
+
+        if (this->sleeping.load()) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->wakeup.notify_one();
+        }
+    }
+
+    /** Remove the oldest node, only called from the worker thread. Returns nullptr if nothing is ready */
+    Executor::Node* Executor::Worker::pop() {
+        Node* tail = this->tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &this->stub) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            this->tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            this->tail = next;
+            return tail;
+        }
+        if (tail != this->head.load()) {
+            // A producer is halfway through push(), its node will be linked shortly
+            return nullptr;
+        }
+        this->push(&this->stub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            this->tail = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    /** I/O thread body: run jobs until stopped and drained */
+    void Executor::Worker::run() {
+        while (true) {
+            Node* node = this->pop();
+            if (node != nullptr) {
+                try {
+                    PriorityScope scope(node->priority);
+                    node->job();
+                } catch (...) {
+                    // A failing job must not take the adapter's I/O thread down with it
+                }
+                delete node;
+                continue;
+            }
+
+            bool empty = this->tail->next.load() == nullptr && this->head.load() == this->tail;
+            if (empty && !this->running.load()) {
+                return;
+            }
+            if (!empty) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            this->sleeping.store(true);
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->wakeup.wait(lock, [this]() {
+                    return !this->running.load() || this->tail->next.load() != nullptr || this->head.load() != this->tail;
+                });
+            }
+            this->sleeping.store(false);
+        }
+    }
+}
@@ -1,14 +1,71 @@
 #include "i2cpp/i2cpp.hpp"
 
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 
+#include "i2cpp/trace.hpp"
+
+#if !defined(I2CPP_NO_STATISTICS) || !defined(I2CPP_NO_TRACE)
+#define I2CPP_TIMED
+#endif
+
 
 namespace i2cpp
 {
+#ifndef I2CPP_NO_TRACE
+    namespace
+    {
+        /** Append one operation to the trace, if tracing */
+        void trace_io(TraceKind kind, int adapter, int address, uint_fast8_t command, const uint_fast8_t* payload, std::size_t captured,
+                std::size_t length, ssize_t result, int error, uint64_t start, uint64_t end) {
+            if (!Tracer::is_enabled()) {
+                return;
+            }
+            TraceRecord record;
+            record.timestamp = start;
+            record.duration = uint32_t(std::min<uint64_t>(end - start, UINT32_MAX));
+            record.adapter = adapter;
+            record.result = int32_t(result);
+            record.length = uint16_t(length);
+            record.error = int16_t(result < 0 ? error : 0);
+            record.address = uint16_t(address);
+            record.kind = kind;
+            record.index = 0;
+            record.count = 1;
+            record.command = uint8_t(command);
+            record.reserved = 0;
+            Tracer::record(record, payload, captured);
+        }
+
+        /** Append each message of a transfer to the trace, if tracing */
+        void trace_transfer(int adapter, const Message* messages, std::size_t count, int status, uint64_t start, uint64_t end) {
+            if (!Tracer::is_enabled()) {
+                return;
+            }
+            TraceRecord record;
+            record.timestamp = start;
+            record.duration = uint32_t(std::min<uint64_t>(end - start, UINT32_MAX));
+            record.adapter = adapter;
+            record.error = int16_t(status);
+            record.count = uint8_t(count);
+            record.command = 0;
+            record.reserved = 0;
+            for (std::size_t i = 0; i < count; i++) {
+                record.result = status == 0 ? int32_t(messages[i].length) : -1;
+                record.length = uint16_t(messages[i].length);
+                record.address = uint16_t(messages[i].address);
+                record.kind = messages[i].read ? TraceKind::TRANSFER_READ : TraceKind::TRANSFER_WRITE;
+                record.index = uint8_t(i);
+                // Reads only hold data once they succeed
+                Tracer::record(record, messages[i].buffer, messages[i].read && status != 0 ? 0 : messages[i].length);
+            }
+        }
+    }
+#endif
+
     I2CPP &I2CPP::instance() {
         static I2CPP inst;
         return inst;
@@ -19,13 +76,31 @@ namespace i2cpp
     }
 
     int I2CPP::open_adapter(std::string filename) {
-        if (instance().fds.find(filename) == instance().fds.end()) {
-            int fd = open(filename.c_str(), O_RDWR);
-            instance().fds.insert(std::make_pair(filename, fd));
-            return fd;
-        } else {
-            return instance().fds.at(filename);
+        I2CPP& inst = instance();
+        std::lock_guard<std::mutex> lock(inst.open_mutex);
+        std::map<std::string, int>::iterator found = inst.fds.find(filename);
+        if (found != inst.fds.end()) {
+            return found->second;
+        }
+        Transport::SharedPtr transport = std::make_shared<LinuxTransport>(filename);
+        int fd = transport->get_handle();
+        if (fd >= 0) {
+            inst.fds.insert(std::make_pair(filename, fd));
+            inst._register(fd, transport);
+        }
+        return fd;
+    }
+
+    int I2CPP::attach_adapter(std::string filename, Transport::SharedPtr transport) {
+        I2CPP& inst = instance();
+        std::lock_guard<std::mutex> lock(inst.open_mutex);
+        int handle = transport->get_handle();
+        if (handle < 0 || inst.fds.find(filename) != inst.fds.end() || inst.adapters.find(handle) != inst.adapters.end()) {
+            return -1;
         }
+        inst.fds.insert(std::make_pair(filename, handle));
+        inst._register(handle, transport);
+        return handle;
     }
 
     std::size_t I2CPP::write_i2c(int adapter, int address, uint_fast8_t *buffer, std::size_t length) {
@@ -36,36 +111,443 @@ namespace i2cpp
         return instance()._read(adapter, address, buffer, length);
     }
 
+    bool I2CPP::transfer(int adapter, Message* messages, std::size_t count) {
+        return instance()._transfer(adapter, messages, count);
+    }
 
-    I2CPP::I2CPP() {}
+    std::size_t I2CPP::write_read_i2c(int adapter, int address, uint_fast8_t* out, std::size_t out_length, uint_fast8_t* in, std::size_t in_length) {
+        Message messages[2] = {
+            { uint_fast8_t(address), false, out, out_length, 0 },
+            { uint_fast8_t(address), true, in, in_length, 0 }
+        };
+        return instance()._transfer(adapter, messages, 2) ? in_length : 0;
+    }
 
-    I2CPP::~I2CPP() {
-        std::map<std::string, int>::iterator fd_itr;
-        for (fd_itr = this->fds.begin(); fd_itr != this->fds.end(); fd_itr++) {
-            close(fd_itr->second);
+    std::size_t I2CPP::submit_batch(int adapter, std::vector<Message>& messages) {
+        std::size_t sent = 0;
+        std::size_t start = 0;
+        while (start < messages.size()) {
+            // Pack as many whole transactions as fit in one call
+            std::size_t end = start;
+            while (end < messages.size()) {
+                std::size_t next = end + I2CPP::_transaction_length(messages, end);
+                if (next - start > I2C_RDWR_IOCTL_MAX_MSGS) {
+                    break;
+                }
+                end = next;
+            }
+
+            if (instance()._transfer(adapter, &messages[start], end - start)) {
+                sent += end - start;
+            } else if (I2CPP::_transaction_length(messages, start) < end - start) {
+                // Isolate the failing device(s)
+                for (std::size_t i = start; i < end; ) {
+                    std::size_t length = I2CPP::_transaction_length(messages, i);
+                    if (instance()._transfer(adapter, &messages[i], length)) {
+                        sent += length;
+                    }
+                    i += length;
+                }
+            }
+            start = end;
         }
+        return sent;
     }
 
-    /** Instance version of read_i2c() */
-    std::size_t I2CPP::_write(int adapter, int address, uint_fast8_t* buffer, std::size_t length) {
-        this->_set_address(adapter, address);
-        return write(adapter, buffer, length);
+    std::size_t I2CPP::max_messages() { return I2C_RDWR_IOCTL_MAX_MSGS; }
+
+    unsigned long I2CPP::get_functionality(int adapter) {
+        return instance()._adapter(adapter).functionality;
+    }
+
+    bool I2CPP::set_pec(int adapter, bool enable) {
+        Adapter& state = instance()._adapter(adapter);
+        std::lock_guard<Arbiter> lock(state.mutex);
+        if (enable && (state.functionality & I2C_FUNC_SMBUS_PEC) == 0) {
+            return false;
+        }
+        if (state.transport->set_pec(enable) < 0) {
+            return false;
+        }
+        state.pec = enable;
+        return true;
+    }
+
+    I2CPP::RegisterPath I2CPP::register_path(int adapter, std::size_t length, bool read) {
+        Adapter& state = instance()._adapter(adapter);
+        std::lock_guard<Arbiter> lock(state.mutex);
+        return I2CPP::_register_path(state, length, read);
+    }
+
+    std::size_t I2CPP::read_register(int adapter, int address, uint_fast8_t command, uint_fast8_t* buffer, std::size_t length) {
+        return instance()._read_register(adapter, address, command, buffer, length);
+    }
+
+    std::size_t I2CPP::write_register(int adapter, int address, uint_fast8_t command, const uint_fast8_t* buffer, std::size_t length) {
+        return instance()._write_register(adapter, address, command, buffer, length);
+    }
+
+    bool I2CPP::probe(int adapter, int address) {
+        return instance()._probe(adapter, address);
+    }
+
+    std::vector<AdapterStatistics> I2CPP::get_statistics() {
+        std::vector<AdapterStatistics> statistics;
+#ifndef I2CPP_NO_STATISTICS
+        I2CPP& inst = instance();
+        std::lock_guard<std::mutex> lock(inst.open_mutex);
+        std::map<int, std::unique_ptr<Adapter>>::iterator adapter;
+        for (adapter = inst.adapters.begin(); adapter != inst.adapters.end(); adapter++) {
+            std::string name;
+            std::map<std::string, int>::iterator fd;
+            for (fd = inst.fds.begin(); fd != inst.fds.end(); fd++) {
+                if (fd->second == adapter->first) {
+                    name = fd->first;
+                }
+            }
+            statistics.push_back(adapter->second->counters.snapshot(adapter->first, name));
+        }
+#endif
+        return statistics;
+    }
+
+    std::string I2CPP::dump_statistics() {
+        return format_statistics(I2CPP::get_statistics());
+    }
+
+    void I2CPP::reset_statistics() {
+#ifndef I2CPP_NO_STATISTICS
+        I2CPP& inst = instance();
+        std::lock_guard<std::mutex> lock(inst.open_mutex);
+        std::map<int, std::unique_ptr<Adapter>>::iterator adapter;
+        for (adapter = inst.adapters.begin(); adapter != inst.adapters.end(); adapter++) {
+            adapter->second->counters.reset();
+        }
+#endif
+    }
+
+    std::vector<ArbitrationStatistics> I2CPP::get_arbitration(int adapter) {
+        std::vector<ArbitrationStatistics> statistics(bus_priorities);
+        instance()._adapter(adapter).mutex.snapshot(statistics.data());
+        return statistics;
+    }
+
+    void I2CPP::reset_arbitration(int adapter) {
+        instance()._adapter(adapter).mutex.reset();
+    }
+
+
+    I2CPP::I2CPP() {
+        for (int i = 0; i < I2CPP::lookup_size; i++) {
+            this->lookup[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    /** Adapters release their transports, which close any device files they opened */
+    I2CPP::~I2CPP() {}
+
+    /** Find the Adapter for a File Descriptor, registering it if it was opened outside of I2CPP */
+    I2CPP::Adapter& I2CPP::_adapter(int fd) {
+        if (fd >= 0 && fd < I2CPP::lookup_size) {
+            Adapter* found = this->lookup[fd].load(std::memory_order_acquire);
+            if (found != nullptr) {
+                return *found;
+            }
+        }
+        std::lock_guard<std::mutex> lock(this->open_mutex);
+        return this->_register(fd, nullptr);
+    }
+
+    /**
+     * Create (or fetch) the Adapter for a handle, open_mutex must be held.
+     * Without a transport, the handle is treated as an i2c-dev File Descriptor owned by the caller.
+     */
+    I2CPP::Adapter& I2CPP::_register(int handle, Transport::SharedPtr transport) {
+        std::unique_ptr<Adapter>& adapter = this->adapters[handle];
+        if (!adapter) {
+            if (!transport) {
+                transport = std::make_shared<LinuxTransport>(handle, false);
+            }
+            adapter.reset(new Adapter(transport));
+            adapter->functionality = transport->get_functionality();
+            if (handle >= 0 && handle < I2CPP::lookup_size) {
+                this->lookup[handle].store(adapter.get(), std::memory_order_release);
+            }
+        }
+        return *adapter;
     }
 
     /** Instance version of write_i2c() */
+    std::size_t I2CPP::_write(int adapter, int address, uint_fast8_t* buffer, std::size_t length) {
+        Adapter& state = this->_adapter(adapter);
+        std::lock_guard<Arbiter> lock(state.mutex);
+#ifdef I2CPP_TIMED
+        uint64_t start = I2CPP::_clock();
+#endif
+        // Never send the data to whichever device was selected before
+        ssize_t result = this->_set_address(state, address) ? state.transport->write(buffer, length) : -1;
+#ifdef I2CPP_TIMED
+        int error = errno;
+        uint64_t end = I2CPP::_clock();
+#endif
+#ifndef I2CPP_NO_STATISTICS
+        state.counters.record_io(address, false, length, result, error, end - start);
+#endif
+#ifndef I2CPP_NO_TRACE
+        trace_io(TraceKind::WRITE, adapter, address, 0, buffer, length, length, result, error, start, end);
+#endif
+        return result;
+    }
+
+    /** Instance version of read_i2c() */
     std::size_t I2CPP::_read(int adapter, int address, uint_fast8_t* buffer, std::size_t length) {
-        this->_set_address(adapter, address);
-        return read(adapter, buffer, length);
+        Adapter& state = this->_adapter(adapter);
+        std::lock_guard<Arbiter> lock(state.mutex);
+#ifdef I2CPP_TIMED
+        uint64_t start = I2CPP::_clock();
+#endif
+        ssize_t result = this->_set_address(state, address) ? state.transport->read(buffer, length) : -1;
+#ifdef I2CPP_TIMED
+        int error = errno;
+        uint64_t end = I2CPP::_clock();
+#endif
+#ifndef I2CPP_NO_STATISTICS
+        state.counters.record_io(address, true, length, result, error, end - start);
+#endif
+#ifndef I2CPP_NO_TRACE
+        trace_io(TraceKind::READ, adapter, address, 0, buffer, result < 0 ? 0 : result, length, result, error, start, end);
+#endif
+        return result;
+    }
+
+    /** Instance version of transfer() */
+    bool I2CPP::_transfer(int adapter, Message* messages, std::size_t count) {
+        if (count == 0 || count > I2C_RDWR_IOCTL_MAX_MSGS) {
+            for (std::size_t i = 0; i < count; i++) {
+                messages[i].status = EINVAL;
+            }
+            return false;
+        }
+        Adapter& state = this->_adapter(adapter);
+        std::unique_lock<Arbiter> lock(state.mutex);
+#ifdef I2CPP_TIMED
+        uint64_t start = I2CPP::_clock();
+#endif
+        int result = state.transport->transfer(messages, count);
+        int error = errno;
+        int status = result == int(count) ? 0 : (result < 0 ? error : EIO);
+#ifdef I2CPP_TIMED
+        uint64_t end = I2CPP::_clock();
+#endif
+#ifndef I2CPP_NO_STATISTICS
+        state.counters.record_transfer(messages, count, status, end - start);
+#endif
+#ifndef I2CPP_NO_TRACE
+        trace_transfer(adapter, messages, count, status, start, end);
+#endif
+        lock.unlock();
+        for (std::size_t i = 0; i < count; i++) {
+            messages[i].status = status;
+        }
+        return status == 0;
+    }
+
+    /** Cheapest primitive for a register access, given the adapter's capabilities */
+    I2CPP::RegisterPath I2CPP::_register_path(const Adapter& adapter, std::size_t length, bool read) {
+        unsigned long functions = adapter.functionality;
+        RegisterPath smbus = RegisterPath::RAW;
+        if (length == 1 && (functions & (read ? I2C_FUNC_SMBUS_READ_BYTE_DATA : I2C_FUNC_SMBUS_WRITE_BYTE_DATA)) != 0) {
+            smbus = RegisterPath::SMBUS_BYTE;
+        } else if (length == 2 && (functions & (read ? I2C_FUNC_SMBUS_READ_WORD_DATA : I2C_FUNC_SMBUS_WRITE_WORD_DATA)) != 0) {
+            smbus = RegisterPath::SMBUS_WORD;
+        } else if (length >= 1 && length <= I2C_SMBUS_BLOCK_MAX
+                && (functions & (read ? I2C_FUNC_SMBUS_READ_I2C_BLOCK : I2C_FUNC_SMBUS_WRITE_I2C_BLOCK)) != 0) {
+            smbus = RegisterPath::SMBUS_BLOCK;
+        }
+
+        // Only SMBus byte and word transactions carry a PEC byte
+        if (adapter.pec && (smbus == RegisterPath::SMBUS_BYTE || smbus == RegisterPath::SMBUS_WORD)) {
+            return smbus;
+        }
+        if ((functions & I2C_FUNC_I2C) != 0) {
+            return RegisterPath::TRANSFER;
+        }
+        return smbus;
     }
 
-    /** Conditionally reconfigures ioctl and updates this->regs */
-    void I2CPP::_set_address(int adapter, int address) {
-        if (this->regs[adapter] != address) {
-            if (ioctl(adapter, I2C_SLAVE, address) < 0) {
-                this->regs[adapter] = -1;
+    /** Instance version of probe() */
+    bool I2CPP::_probe(int adapter, int address) {
+        Adapter& state = this->_adapter(adapter);
+        std::lock_guard<Arbiter> lock(state.mutex);
+#ifdef I2CPP_TIMED
+        uint64_t start = I2CPP::_clock();
+#endif
+        unsigned long functions = state.functionality;
+        bool quick = (functions & I2C_FUNC_SMBUS_QUICK) != 0;
+        bool byte = (functions & I2C_FUNC_SMBUS_READ_BYTE) != 0;
+        if (byte && ((address >= 0x30 && address <= 0x37) || (address >= 0x50 && address <= 0x5f))) {
+            quick = false;
+        }
+
+        uint_fast8_t data = 0;
+        std::size_t length = quick ? 0 : 1;
+        ssize_t result = -1;
+        if (quick || byte) {
+            if (this->_set_address(state, address)) {
+                result = state.transport->smbus(!quick, 0, quick ? SMBusSize::QUICK : SMBusSize::BYTE, &data, length);
+            }
+        } else if ((functions & I2C_FUNC_I2C) != 0) {
+            Message message = { uint_fast8_t(address), true, &data, 1, 0 };
+            result = state.transport->transfer(&message, 1) == 1 ? 1 : -1;
+        } else {
+            errno = EOPNOTSUPP;
+        }
+#ifdef I2CPP_TIMED
+        int error = errno;
+        uint64_t end = I2CPP::_clock();
+#endif
+#ifndef I2CPP_NO_STATISTICS
+        state.counters.record_io(address, !quick, length, result, error, end - start);
+#endif
+#ifndef I2CPP_NO_TRACE
+        trace_io(TraceKind::PROBE, adapter, address, 0, &data, 0, length, result, error, start, end);
+#endif
+        return result >= 0;
+    }
+
+    /** Instance version of read_register() */
+    std::size_t I2CPP::_read_register(int adapter, int address, uint_fast8_t command, uint_fast8_t* buffer, std::size_t length) {
+        Adapter& state = this->_adapter(adapter);
+        std::lock_guard<Arbiter> lock(state.mutex);
+#ifdef I2CPP_TIMED
+        uint64_t start = I2CPP::_clock();
+#endif
+        ssize_t result = -1;
+        RegisterPath path = I2CPP::_register_path(state, length, true);
+        if (path == RegisterPath::TRANSFER) {
+            Message messages[2] = {
+                { uint_fast8_t(address), false, &command, 1, 0 },
+                { uint_fast8_t(address), true, buffer, length, 0 }
+            };
+            int sent = state.transport->transfer(messages, 2);
+            result = sent == 2 ? ssize_t(length) : -1;
+            if (sent >= 0 && sent < 2) {
+                errno = EIO;
+            }
+        } else if (this->_set_address(state, address)) {
+            if (path == RegisterPath::RAW) {
+                if (state.transport->write(&command, 1) == 1) {
+                    result = state.transport->read(buffer, length);
+                }
             } else {
-                this->regs[adapter] = address;
+                SMBusSize size = path == RegisterPath::SMBUS_BYTE ? SMBusSize::BYTE_DATA
+                    : (path == RegisterPath::SMBUS_WORD ? SMBusSize::WORD_DATA : SMBusSize::I2C_BLOCK_DATA);
+                result = state.transport->smbus(true, command, size, buffer, length);
             }
         }
+#ifdef I2CPP_TIMED
+        int error = errno;
+        uint64_t end = I2CPP::_clock();
+#endif
+#ifndef I2CPP_NO_STATISTICS
+        state.counters.record_io(address, true, length, result, error, end - start);
+#endif
+#ifndef I2CPP_NO_TRACE
+        trace_io(TraceKind::REGISTER_READ, adapter, address, command, buffer, result < 0 ? 0 : result, length, result, error, start, end);
+#endif
+        return result < 0 ? 0 : std::size_t(result);
+    }
+
+    /** Instance version of write_register() */
+    std::size_t I2CPP::_write_register(int adapter, int address, uint_fast8_t command, const uint_fast8_t* buffer, std::size_t length) {
+        Adapter& state = this->_adapter(adapter);
+        std::lock_guard<Arbiter> lock(state.mutex);
+#ifdef I2CPP_TIMED
+        uint64_t start = I2CPP::_clock();
+#endif
+        ssize_t result = -1;
+        RegisterPath path = I2CPP::_register_path(state, length, false);
+        if (path == RegisterPath::SMBUS_BYTE || path == RegisterPath::SMBUS_WORD || path == RegisterPath::SMBUS_BLOCK) {
+            SMBusSize size = path == RegisterPath::SMBUS_BYTE ? SMBusSize::BYTE_DATA
+                : (path == RegisterPath::SMBUS_WORD ? SMBusSize::WORD_DATA : SMBusSize::I2C_BLOCK_DATA);
+            if (this->_set_address(state, address)) {
+                result = state.transport->smbus(false, command, size, const_cast<uint_fast8_t*>(buffer), length);
+            }
+        } else {
+            // The command byte and data go out as one message, so they need one contiguous buffer
+            uint_fast8_t small[I2C_SMBUS_BLOCK_MAX + 1];
+            std::vector<uint_fast8_t> large;
+            uint_fast8_t* data = small;
+            if (length + 1 > sizeof(small) / sizeof(small[0])) {
+                large.resize(length + 1);
+                data = large.data();
+            }
+            data[0] = command;
+            std::copy(buffer, buffer + length, data + 1);
+
+            if (path == RegisterPath::TRANSFER) {
+                Message message = { uint_fast8_t(address), false, data, length + 1, 0 };
+                int sent = state.transport->transfer(&message, 1);
+                result = sent == 1 ? ssize_t(length) : -1;
+                if (sent == 0) {
+                    errno = EIO;
+                }
+            } else if (this->_set_address(state, address)) {
+                ssize_t written = state.transport->write(data, length + 1);
+                result = written < 0 ? -1 : (written > 0 ? written - 1 : 0);
+            }
+        }
+#ifdef I2CPP_TIMED
+        int error = errno;
+        uint64_t end = I2CPP::_clock();
+#endif
+#ifndef I2CPP_NO_STATISTICS
+        state.counters.record_io(address, false, length, result, error, end - start);
+#endif
+#ifndef I2CPP_NO_TRACE
+        trace_io(TraceKind::REGISTER_WRITE, adapter, address, command, buffer, length, length, result, error, start, end);
+#endif
+        return result < 0 ? 0 : std::size_t(result);
+    }
+
+    /** Number of messages, starting at index, which must be sent together in one transfer */
+    std::size_t I2CPP::_transaction_length(const std::vector<Message>& messages, std::size_t index) {
+        if (index + 1 < messages.size() && !messages[index].read && messages[index + 1].read
+                && messages[index].address == messages[index + 1].address) {
+            return 2;
+        }
+        return 1;
+    }
+
+    /**
+     * Select a device on an adapter, unless it is already selected. adapter.mutex must be held.
+     * @returns True if the device is selected, false with errno set if I2C_SLAVE failed
+     */
+    bool I2CPP::_set_address(Adapter& adapter, int address) {
+        if (adapter.address == address) {
+            return true;
+        }
+#ifndef I2CPP_NO_TRACE
+        uint64_t start = Tracer::is_enabled() ? I2CPP::_clock() : 0;
+#endif
+        int result = adapter.transport->set_address(address);
+        int error = errno;
+        adapter.address = result < 0 ? -1 : address;
+#ifndef I2CPP_NO_STATISTICS
+        adapter.counters.record_address_change(result == 0, error);
+#endif
+#ifndef I2CPP_NO_TRACE
+        if (start != 0) {
+            trace_io(TraceKind::SET_ADDRESS, adapter.transport->get_handle(), address, 0, nullptr, 0, 0, result, error, start, I2CPP::_clock());
+        }
+#endif
+        errno = error;
+        return result == 0;
+    }
+
+    /** Monotonic timestamp in nanoseconds for latency statistics and traces */
+    uint64_t I2CPP::_clock() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 }
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "i2cpp/input_watcher.hpp"
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+
+namespace i2cpp
+{
+    InputWatcher::InputWatcher() : running(false)
+    {
+        this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        this->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = this->stop_fd;
+        epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->stop_fd, &event);
+    }
+    InputWatcher::~InputWatcher()
+    {
+        this->stop();
+        close(this->stop_fd);
+        close(this->epoll_fd);
+    }
+
+    bool InputWatcher::watch(int line, PCA9555::SharedPtr device, Callback callback)
+    {
+        Entry entry = { device, callback, 0, false };
+        entry.known = device->read_input(entry.state);
+
+        std::lock_guard<std::mutex> lock(this->lines_mutex);
+        std::shared_ptr<Line>& watched = this->lines[line];
+        if(!watched) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = line;
+            if(epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, line, &event) < 0) {
+                this->lines.erase(line);
+                return false;
+            }
+            watched = std::make_shared<Line>();
+            watched->fd = line;
+        }
+        std::lock_guard<std::mutex> line_lock(watched->mutex);
+        watched->entries.push_back(entry);
+        return true;
+    }
+    void InputWatcher::unwatch(int line)
+    {
+        std::lock_guard<std::mutex> lock(this->lines_mutex);
+        if(this->lines.erase(line) > 0) {
+            epoll_ctl(this->epoll_fd, EPOLL_CTL_DEL, line, nullptr);
+        }
+    }
+
+    bool InputWatcher::start()
+    {
+        if(this->running) {
+            return false;
+        }
+        this->running = true;
+        this->thread = std::thread(&InputWatcher::run, this);
+        return true;
+    }
+    void InputWatcher::stop()
+    {
+        if(!this->running) {
+            return;
+        }
+        uint64_t one = 1;
+        ssize_t written = write(this->stop_fd, &one, sizeof(one));
+        (void)written;
+        this->thread.join();
+        this->running = false;
+
+        uint64_t count;
+        ssize_t drained = read(this->stop_fd, &count, sizeof(count));
+        (void)drained;
+    }
+
+    std::size_t InputWatcher::poll(int timeout)
+    {
+        struct epoll_event events[16];
+        int count = epoll_wait(this->epoll_fd, events, 16, timeout);
+
+        std::size_t handled = 0;
+        for(int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+            if(fd == this->stop_fd) {
+                continue;
+            }
+
+            // Consume the event so a level-triggered epoll doesn't report it again.
+            // Large enough for several GPIO line events or one eventfd counter.
+            uint8_t discard[256];
+            ssize_t consumed = read(fd, discard, sizeof(discard));
+            (void)consumed;
+
+            std::shared_ptr<Line> line;
+            {
+                std::lock_guard<std::mutex> lock(this->lines_mutex);
+                std::map<int, std::shared_ptr<Line>>::iterator found = this->lines.find(fd);
+                if(found == this->lines.end()) {
+                    continue;
+                }
+                line = found->second;
+            }
+            this->dispatch(*line);
+            handled++;
+        }
+        return handled;
+    }
+
+    /** Event loop thread body */
+    void InputWatcher::run()
+    {
+        while(true)
+        {
+            uint64_t stop = 0;
+            if(read(this->stop_fd, &stop, sizeof(stop)) == sizeof(stop)) {
+                return;
+            }
+            this->poll(-1);
+        }
+    }
+
+    /** Read every expander on a line and notify those whose inputs changed, after releasing the line */
+    void InputWatcher::dispatch(Line& line)
+    {
+        std::vector<Change> changes;
+        {
+            std::lock_guard<std::mutex> lock(line.mutex);
+            for(Entry& entry : line.entries)
+            {
+                uint_fast16_t state = 0;
+                // A failed read says nothing about the pins, so the expander keeps its last state
+                if(!entry.device->read_input(state)) {
+                    continue;
+                }
+                uint_fast16_t changed = state ^ entry.state;
+                bool known = entry.known;
+                entry.state = state;
+                entry.known = true;
+                if(known && changed != 0) {
+                    changes.push_back(Change{ entry.device, entry.callback, state, changed });
+                }
+            }
+        }
+        // Callbacks may watch() more expanders on this line, so they run without its lock
+        for(Change& change : changes) {
+            change.callback(*change.device, change.state, change.changed);
+        }
+    }
+}
@@ -0,0 +1,302 @@
+#include "i2cpp/output_port.hpp"
+
+#include <algorithm>
+
+#include "i2cpp/executor.hpp"
+#include "i2cpp/read_cache.hpp"
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** Bitmask of the bits from first to last within a word, last exclusive and at most 64 */
+        uint64_t bit_range(std::size_t first, std::size_t last)
+        {
+            uint64_t below_last = last >= 64 ? ~uint64_t(0) : (uint64_t(1) << last) - 1;
+            return below_last & ~((uint64_t(1) << first) - 1);
+        }
+    }
+
+
+    const std::size_t OutputPort::lane_width;
+
+    OutputPort::OutputPort(const std::vector<PCA9555::SharedPtr>& devices) : devices(devices), remaining(0)
+    {
+        std::size_t words = (devices.size() + lane_width - 1) / lane_width;
+        this->desired.assign(words, 0);
+        this->written.assign(words, 0);
+        for(const PCA9555::SharedPtr& device : devices)
+        {
+            std::size_t index = 0;
+            while(index < this->buses.size() && this->buses[index].adapter != device->get_adapter()) {
+                index++;
+            }
+            if(index == this->buses.size())
+            {
+                Bus bus;
+                bus.adapter = device->get_adapter();
+                bus.batch = I2CPP::register_path(bus.adapter, PCA9555::Registers::Output::width, false) == I2CPP::RegisterPath::TRANSFER;
+                this->buses.push_back(bus);
+            }
+            this->bus_of.push_back(index);
+        }
+        this->resync();
+    }
+
+    std::size_t OutputPort::size() const { return 16 * this->devices.size(); }
+    std::size_t OutputPort::words() const { return this->desired.size(); }
+
+    /** Output word of one expander within a bitset */
+    uint_fast16_t OutputPort::word(const std::vector<uint64_t>& bits, std::size_t device)
+    {
+        return uint_fast16_t((bits[device / lane_width] >> (16 * (device % lane_width))) & 0xffff);
+    }
+
+    bool OutputPort::get(std::size_t pin) const
+    {
+        return pin < this->size() && ((this->desired[pin / 64] >> (pin % 64)) & 1) != 0;
+    }
+    void OutputPort::set(std::size_t pin, bool value)
+    {
+        if(pin >= this->size()) {
+            return;
+        }
+        uint64_t bit = uint64_t(1) << (pin % 64);
+        if(value) {
+            this->desired[pin / 64] |= bit;
+        } else {
+            this->desired[pin / 64] &= ~bit;
+        }
+    }
+    void OutputPort::clear(std::size_t pin) { this->set(pin, false); }
+
+    void OutputPort::set_range(std::size_t start_pin, std::size_t end_pin, bool value)
+    {
+        end_pin = std::min(end_pin, this->size());
+        for(std::size_t pin = start_pin; pin < end_pin; )
+        {
+            // Whole words at a time
+            std::size_t last = std::min(end_pin, (pin / 64 + 1) * 64);
+            uint64_t mask = bit_range(pin % 64, last - pin + pin % 64);
+            if(value) {
+                this->desired[pin / 64] |= mask;
+            } else {
+                this->desired[pin / 64] &= ~mask;
+            }
+            pin = last;
+        }
+    }
+    void OutputPort::assign_range(std::size_t start_pin, std::size_t end_pin, uint64_t values)
+    {
+        end_pin = std::min(std::min(end_pin, this->size()), start_pin + 64);
+        for(std::size_t pin = start_pin; pin < end_pin; )
+        {
+            std::size_t last = std::min(end_pin, (pin / 64 + 1) * 64);
+            std::size_t shift = pin % 64;
+            uint64_t mask = bit_range(shift, last - pin + shift);
+            uint64_t bits = (values >> (pin - start_pin)) << shift;
+            this->desired[pin / 64] = (this->desired[pin / 64] & ~mask) | (bits & mask);
+            pin = last;
+        }
+    }
+
+    void OutputPort::set_mask(const std::vector<uint64_t>& mask)
+    {
+        std::size_t words = std::min(mask.size(), this->desired.size());
+        for(std::size_t i = 0; i < words; i++) {
+            this->desired[i] |= mask[i];
+        }
+        this->trim();
+    }
+    void OutputPort::clear_mask(const std::vector<uint64_t>& mask)
+    {
+        std::size_t words = std::min(mask.size(), this->desired.size());
+        for(std::size_t i = 0; i < words; i++) {
+            this->desired[i] &= ~mask[i];
+        }
+    }
+    void OutputPort::assign_mask(const std::vector<uint64_t>& mask, const std::vector<uint64_t>& values)
+    {
+        std::size_t words = std::min(std::min(mask.size(), values.size()), this->desired.size());
+        for(std::size_t i = 0; i < words; i++) {
+            this->desired[i] = (this->desired[i] & ~mask[i]) | (values[i] & mask[i]);
+        }
+        this->trim();
+    }
+    void OutputPort::assign(const std::vector<uint64_t>& values)
+    {
+        this->assign_mask(std::vector<uint64_t>(this->desired.size(), ~uint64_t(0)), values);
+    }
+    const std::vector<uint64_t>& OutputPort::get_bits() const { return this->desired; }
+
+    /** Clear the bits past the last expander, so they never count as changes */
+    void OutputPort::trim()
+    {
+        std::size_t spare = this->desired.size() * lane_width - this->devices.size();
+        if(spare > 0) {
+            this->desired.back() &= bit_range(0, 16 * (lane_width - spare));
+        }
+    }
+
+    std::size_t OutputPort::pending() const
+    {
+        std::size_t count = 0;
+        for(std::size_t l = 0; l < this->desired.size(); l++)
+        {
+            uint64_t differ = this->desired[l] ^ this->written[l];
+            for(std::size_t slot = 0; slot < lane_width; slot++) {
+                count += ((differ >> (16 * slot)) & 0xffff) != 0 ? 1 : 0;
+            }
+        }
+        return count;
+    }
+
+    bool OutputPort::apply()
+    {
+        for(Bus& bus : this->buses) {
+            bus.changed.clear();
+        }
+        // Compare four expanders at a time, most words are usually unchanged
+        for(std::size_t l = 0; l < this->desired.size(); l++)
+        {
+            uint64_t differ = this->desired[l] ^ this->written[l];
+            for(std::size_t slot = 0; differ != 0 && slot < lane_width; slot++)
+            {
+                if(((differ >> (16 * slot)) & 0xffff) != 0)
+                {
+                    std::size_t device = l * lane_width + slot;
+                    this->buses[this->bus_of[device]].changed.push_back(device);
+                    differ &= ~(uint64_t(0xffff) << (16 * slot));
+                }
+            }
+        }
+
+        std::size_t active = 0;
+        for(const Bus& bus : this->buses) {
+            active += bus.changed.empty() ? 0 : 1;
+        }
+        if(active == 1)
+        {
+            // A single bus is written on the calling thread, skipping the hand-off
+            for(Bus& bus : this->buses)
+            {
+                if(!bus.changed.empty()) {
+                    this->write_bus(bus);
+                }
+            }
+        }
+        else if(active > 1)
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->remaining = active;
+            }
+            for(Bus& bus : this->buses)
+            {
+                if(bus.changed.empty()) {
+                    continue;
+                }
+                Bus* target = &bus;
+                Executor::post(bus.adapter, [this, target]() {
+                    this->write_bus(*target);
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    if(--this->remaining == 0) {
+                        this->done.notify_one();
+                    }
+                });
+            }
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->done.wait(lock, [this]() { return this->remaining == 0; });
+        }
+
+        // Words are shared between buses, so only this thread records what was written
+        bool success = true;
+        for(const Bus& bus : this->buses)
+        {
+            for(std::size_t i = 0; i < bus.changed.size(); i++)
+            {
+                if(!bus.written[i])
+                {
+                    success = false;
+                    continue;
+                }
+                std::size_t device = bus.changed[i];
+                uint64_t mask = uint64_t(0xffff) << (16 * (device % lane_width));
+                uint64_t& word = this->written[device / lane_width];
+                word = (word & ~mask) | (this->desired[device / lane_width] & mask);
+            }
+        }
+        return success;
+    }
+
+    /** Write one adapter's changed expanders, on the calling or the adapter's Executor thread */
+    void OutputPort::write_bus(Bus& bus)
+    {
+        bus.written.assign(bus.changed.size(), 0);
+        bus.messages.clear();
+        bus.buffers.resize(3 * bus.changed.size());
+        for(std::size_t i = 0; i < bus.changed.size(); i++)
+        {
+            const PCA9555& device = *this->devices[bus.changed[i]];
+            uint_fast8_t* buffer = &bus.buffers[3 * i];
+            buffer[0] = PCA9555::Registers::Output::address;
+            PCA9555::Registers::Output::encode(OutputPort::word(this->desired, bus.changed[i]), buffer + 1);
+            if(!bus.batch) {
+                bus.written[i] = I2CPP::write_register(bus.adapter, device.get_address(), buffer[0], buffer + 1, 2) == 2 ? 1 : 0;
+            } else {
+                bus.messages.push_back({ device.get_address(), false, buffer, 3, 0 });
+            }
+        }
+        if(bus.batch)
+        {
+            I2CPP::submit_batch(bus.adapter, bus.messages);
+            for(std::size_t i = 0; i < bus.changed.size(); i++) {
+                bus.written[i] = bus.messages[i].status == 0 ? 1 : 0;
+            }
+        }
+
+        // The expanders' own shadows and any cached reads no longer match the boards
+        for(std::size_t device : bus.changed)
+        {
+            this->devices[device]->invalidate_shadow();
+            ReadCache::invalidate(bus.adapter, this->devices[device]->get_address());
+        }
+    }
+
+    bool OutputPort::resync()
+    {
+        bool success = true;
+        for(std::size_t device = 0; device < this->devices.size(); device++)
+        {
+            // Read the board itself, the expander's shadow may predate writes made through this port
+            uint_fast8_t buffer[PCA9555::Registers::Output::width];
+            bool read = I2CPP::read_register(this->devices[device]->get_adapter(), this->devices[device]->get_address(),
+                PCA9555::Registers::Output::address, buffer, PCA9555::Registers::Output::width) == PCA9555::Registers::Output::width;
+            uint_fast16_t output = read ? PCA9555::Registers::Output::decode(buffer) : 0;
+            success = success && read;
+
+            std::size_t shift = 16 * (device % lane_width);
+            uint64_t mask = uint64_t(0xffff) << shift;
+            uint64_t bits = uint64_t(output & 0xffff) << shift;
+            uint64_t& desired = this->desired[device / lane_width];
+            uint64_t& written = this->written[device / lane_width];
+            desired = (desired & ~mask) | bits;
+            // An expander which cannot be read is unknown, so the next apply() writes it
+            written = (written & ~mask) | (read ? bits : ~bits & mask);
+        }
+        return success;
+    }
+
+    void OutputPort::invalidate()
+    {
+        for(std::size_t l = 0; l < this->written.size(); l++) {
+            this->written[l] = ~this->desired[l];
+        }
+        // Spare bits past the last expander must match
+        std::size_t spare = this->written.size() * lane_width - this->devices.size();
+        if(spare > 0) {
+            this->written.back() &= bit_range(0, 16 * (lane_width - spare));
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#include "i2cpp/read_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "i2cpp/i2cpp.hpp"
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        uint64_t steady_now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+
+    constexpr std::size_t ReadCache::max_length;
+    constexpr std::size_t ReadCache::shard_count;
+
+    ReadCache::Entry::Entry() : in_flight(false), generation(0), epoch(0), valid(false), finished(0), length(0), result(0) {  }
+
+    ReadCache::Shard::Shard() : statistics() {  }
+
+    ReadCache::ReadCache() : active(false) {  }
+    ReadCache& ReadCache::instance()
+    {
+        static ReadCache inst;
+        return inst;
+    }
+    ReadCache::Shard& ReadCache::shard(int adapter)
+    {
+        return instance().shards[uint32_t(adapter) % ReadCache::shard_count];
+    }
+    uint64_t ReadCache::key(int adapter, int address, uint_fast8_t command)
+    {
+        return (uint64_t(uint32_t(adapter)) << 24) | (uint64_t(address & 0xffff) << 8) | uint64_t(command & 0xff);
+    }
+
+    std::size_t ReadCache::read(int adapter, int address, uint_fast8_t command, uint_fast8_t* buffer, std::size_t length, uint64_t max_age)
+    {
+        if(length == 0 || length > ReadCache::max_length) {
+            return I2CPP::read_register(adapter, address, command, buffer, length);
+        }
+        ReadCache& inst = instance();
+        Shard& shard = ReadCache::shard(adapter);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        // Only the first read stores, so the flag's line stays shared between every adapter's readers.
+        // Release pairs with the acquire in invalidate(), whose writer then locks this shard and finds the entry
+        if(!inst.active.load(std::memory_order_acquire)) {
+            inst.active.store(true, std::memory_order_release);
+        }
+        Entry& entry = shard.entries[ReadCache::key(adapter, address, command)];
+
+        if(entry.length == length)
+        {
+            if(entry.valid && max_age > 0 && steady_now() - entry.finished <= max_age)
+            {
+                std::copy(entry.data, entry.data + length, buffer);
+                shard.statistics.hits++;
+                return length;
+            }
+            if(entry.in_flight)
+            {
+                uint64_t generation = entry.generation;
+                entry.done.wait(lock, [&entry, generation]() { return entry.generation != generation; });
+                std::copy(entry.data, entry.data + entry.result, buffer);
+                shard.statistics.coalesced++;
+                return entry.result;
+            }
+        }
+        if(entry.in_flight)
+        {
+            // A read of another length is in flight, so bypass the entry it owns
+            shard.statistics.misses++;
+            lock.unlock();
+            return I2CPP::read_register(adapter, address, command, buffer, length);
+        }
+
+        entry.in_flight = true;
+        entry.length = length;
+        uint64_t epoch = entry.epoch;
+        shard.statistics.misses++;
+        lock.unlock();
+        std::size_t result = I2CPP::read_register(adapter, address, command, buffer, length);
+        uint64_t finished = steady_now();
+        lock.lock();
+
+        std::copy(buffer, buffer + result, entry.data);
+        entry.result = result;
+        entry.valid = result == length && entry.epoch == epoch;
+        entry.finished = finished;
+        entry.in_flight = false;
+        entry.generation++;
+        entry.done.notify_all();
+        return result;
+    }
+
+    void ReadCache::invalidate(int adapter, int address)
+    {
+        if(!instance().active.load(std::memory_order_acquire)) {
+            return;
+        }
+        Shard& shard = ReadCache::shard(adapter);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // A device's registers have adjacent keys
+        std::map<uint64_t, Entry>::iterator entry = shard.entries.lower_bound(ReadCache::key(adapter, address, 0));
+        std::map<uint64_t, Entry>::iterator end = shard.entries.upper_bound(ReadCache::key(adapter, address, 0xff));
+        for(; entry != end; entry++)
+        {
+            entry->second.epoch++;
+            if(entry->second.valid)
+            {
+                entry->second.valid = false;
+                shard.statistics.invalidations++;
+            }
+        }
+    }
+
+    void ReadCache::clear()
+    {
+        for(Shard& shard : instance().shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            std::map<uint64_t, Entry>::iterator entry;
+            for(entry = shard.entries.begin(); entry != shard.entries.end(); entry++)
+            {
+                entry->second.epoch++;
+                entry->second.valid = false;
+            }
+        }
+    }
+
+    ReadCacheStatistics ReadCache::get_statistics()
+    {
+        ReadCacheStatistics total = ReadCacheStatistics();
+        for(Shard& shard : instance().shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total.hits += shard.statistics.hits;
+            total.coalesced += shard.statistics.coalesced;
+            total.misses += shard.statistics.misses;
+            total.invalidations += shard.statistics.invalidations;
+        }
+        return total;
+    }
+    void ReadCache::reset_statistics()
+    {
+        for(Shard& shard : instance().shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.statistics = ReadCacheStatistics();
+        }
+    }
+}
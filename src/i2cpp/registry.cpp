@@ -0,0 +1,433 @@
+#include "i2cpp/registry.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "i2cpp/executor.hpp"
+#include "i2cpp/read_cache.hpp"
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** Channel of devices whose bus could not be opened */
+        const std::size_t no_channel = std::size_t(-1);
+
+        /** Parse a decimal or 0x-prefixed hexadecimal number of at most max */
+        bool parse_number(const std::string& text, unsigned long max, unsigned long& value)
+        {
+            if(text.empty()) {
+                return false;
+            }
+            char* end = nullptr;
+            value = std::strtoul(text.c_str(), &end, 0);
+            return *end == '\0' && value <= max;
+        }
+    }
+
+
+    DeviceSpec::DeviceSpec(DeviceType type, const std::string& bus, uint_fast8_t address) : type(type), bus(bus), address(address),
+        config(type == DeviceType::PCA9555 ? 0xffff : ADS1115::Config().to_register()), polarity(0), output(0xffff) {  }
+
+
+    DeviceRegistry::Expander::Expander(DeviceRegistry& registry, std::size_t index) : registry(&registry), index(index) {  }
+    std::size_t DeviceRegistry::Expander::get_index() const { return this->index; }
+    int DeviceRegistry::Expander::get_adapter() const { return this->registry->expander_state.adapters[this->index]; }
+    uint_fast8_t DeviceRegistry::Expander::get_address() const { return this->registry->expander_state.addresses[this->index]; }
+    bool DeviceRegistry::Expander::is_configured() const { return this->registry->expander_state.configured[this->index] != 0; }
+
+    uint_fast16_t DeviceRegistry::Expander::read_input()
+    {
+        Expanders& state = this->registry->expander_state;
+        uint_fast8_t buffer[PCA9555::Registers::Input::width];
+        if(state.adapters[this->index] >= 0 && I2CPP::read_register(state.adapters[this->index], state.addresses[this->index],
+                PCA9555::Registers::Input::address, buffer, PCA9555::Registers::Input::width) == PCA9555::Registers::Input::width) {
+            state.inputs[this->index] = uint16_t(PCA9555::Registers::Input::decode(buffer));
+        }
+        return state.inputs[this->index];
+    }
+    uint_fast16_t DeviceRegistry::Expander::get_input() const { return this->registry->expander_state.inputs[this->index]; }
+    uint_fast16_t DeviceRegistry::Expander::get_output() const { return this->registry->expander_state.outputs[this->index]; }
+    uint_fast16_t DeviceRegistry::Expander::get_polarity() const { return this->registry->expander_state.polarities[this->index]; }
+    uint_fast16_t DeviceRegistry::Expander::get_config() const { return this->registry->expander_state.configs[this->index]; }
+
+    bool DeviceRegistry::Expander::write_output(uint_fast16_t data)
+    {
+        Expanders& state = this->registry->expander_state;
+        if(!this->registry->write(state.adapters[this->index], state.addresses[this->index], PCA9555::Registers::Output::address, data, Endian::LITTLE)) {
+            return false;
+        }
+        state.outputs[this->index] = uint16_t(data);
+        return true;
+    }
+    bool DeviceRegistry::Expander::write_output_pin(uint_fast8_t pin, bool value)
+    {
+        uint_fast16_t output = this->get_output();
+        return this->write_output(value ? (output | (1 << pin)) : (output & ~(1 << pin)));
+    }
+    bool DeviceRegistry::Expander::write_polarity(uint_fast16_t data)
+    {
+        Expanders& state = this->registry->expander_state;
+        if(!this->registry->write(state.adapters[this->index], state.addresses[this->index], PCA9555::Registers::Polarity::address, data, Endian::LITTLE)) {
+            return false;
+        }
+        state.polarities[this->index] = uint16_t(data);
+        return true;
+    }
+    bool DeviceRegistry::Expander::write_config(uint_fast16_t data)
+    {
+        Expanders& state = this->registry->expander_state;
+        if(!this->registry->write(state.adapters[this->index], state.addresses[this->index], PCA9555::Registers::Configuration::address, data, Endian::LITTLE)) {
+            return false;
+        }
+        state.configs[this->index] = uint16_t(data);
+        return true;
+    }
+
+
+    DeviceRegistry::Converter::Converter(DeviceRegistry& registry, std::size_t index) : registry(&registry), index(index) {  }
+    std::size_t DeviceRegistry::Converter::get_index() const { return this->index; }
+    int DeviceRegistry::Converter::get_adapter() const { return this->registry->converter_state.adapters[this->index]; }
+    uint_fast8_t DeviceRegistry::Converter::get_address() const { return this->registry->converter_state.addresses[this->index]; }
+    bool DeviceRegistry::Converter::is_configured() const { return this->registry->converter_state.configured[this->index] != 0; }
+
+    int_fast16_t DeviceRegistry::Converter::read_conversion()
+    {
+        Converters& state = this->registry->converter_state;
+        uint_fast8_t buffer[ADS1115::Registers::Conversion::width];
+        if(state.adapters[this->index] >= 0 && I2CPP::read_register(state.adapters[this->index], state.addresses[this->index],
+                ADS1115::Registers::Conversion::address, buffer, ADS1115::Registers::Conversion::width) == ADS1115::Registers::Conversion::width) {
+            state.conversions[this->index] = int16_t(uint16_t(ADS1115::Registers::Conversion::decode(buffer)));
+        }
+        return state.conversions[this->index];
+    }
+    int_fast16_t DeviceRegistry::Converter::get_conversion() const { return this->registry->converter_state.conversions[this->index]; }
+    double DeviceRegistry::Converter::to_volts(int_fast16_t value) const
+    {
+        return value * ADS1115::full_scale(ADS1115::Config::from_register(this->get_config()).gain) / 32768.0;
+    }
+    uint_fast16_t DeviceRegistry::Converter::get_config() const { return this->registry->converter_state.configs[this->index]; }
+    bool DeviceRegistry::Converter::write_config(uint_fast16_t data)
+    {
+        Converters& state = this->registry->converter_state;
+        if(!this->registry->write(state.adapters[this->index], state.addresses[this->index], ADS1115::Registers::Config::address, data, Endian::BIG)) {
+            return false;
+        }
+        state.configs[this->index] = uint16_t(ADS1115::Registers::Status::set(data, false));
+        return true;
+    }
+
+
+    DeviceRegistry::DeviceRegistry() : remaining(0) {  }
+
+    bool DeviceRegistry::load(const std::string& path, std::vector<DeviceSpec>& specs)
+    {
+        std::ifstream file(path.c_str());
+        if(!file) {
+            return false;
+        }
+        std::vector<DeviceSpec> loaded;
+        std::string line;
+        while(std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string type, bus, address;
+            if(!(fields >> type) || type[0] == '#') {
+                continue;
+            }
+            unsigned long value = 0;
+            if(!(fields >> bus >> address) || !parse_number(address, 0x7f, value)) {
+                return false;
+            }
+            if(type == "pca9555") {
+                loaded.push_back(DeviceSpec(DeviceType::PCA9555, bus, uint_fast8_t(value)));
+            } else if(type == "ads1115") {
+                loaded.push_back(DeviceSpec(DeviceType::ADS1115, bus, uint_fast8_t(value)));
+            } else {
+                return false;
+            }
+
+            DeviceSpec& spec = loaded.back();
+            std::string field;
+            while(fields >> field)
+            {
+                std::string::size_type equals = field.find('=');
+                if(equals == std::string::npos || !parse_number(field.substr(equals + 1), 0xffff, value)) {
+                    return false;
+                }
+                std::string name = field.substr(0, equals);
+                if(name == "config") {
+                    spec.config = uint_fast16_t(value);
+                } else if(name == "polarity" && spec.type == DeviceType::PCA9555) {
+                    spec.polarity = uint_fast16_t(value);
+                } else if(name == "output" && spec.type == DeviceType::PCA9555) {
+                    spec.output = uint_fast16_t(value);
+                } else {
+                    return false;
+                }
+            }
+        }
+        specs = loaded;
+        return true;
+    }
+
+    /** Adapter of a bus, opening it on first use */
+    int DeviceRegistry::open(const std::string& bus)
+    {
+        std::map<std::string, int>::iterator found = this->buses.find(bus);
+        if(found != this->buses.end()) {
+            return found->second;
+        }
+        int adapter = I2CPP::open_adapter(bus);
+        this->buses.insert(std::make_pair(bus, adapter));
+        if(adapter >= 0) {
+            this->adapters.push_back(adapter);
+        }
+        return adapter;
+    }
+
+    std::size_t DeviceRegistry::add(const DeviceSpec& spec)
+    {
+        int adapter = this->open(spec.bus);
+        this->group.reset();
+        if(spec.type == DeviceType::PCA9555)
+        {
+            Expanders& state = this->expander_state;
+            state.adapters.push_back(adapter);
+            state.addresses.push_back(spec.address);
+            state.inputs.push_back(0);
+            state.outputs.push_back(uint16_t(spec.output));
+            state.polarities.push_back(uint16_t(spec.polarity));
+            state.configs.push_back(uint16_t(spec.config));
+            state.configured.push_back(0);
+            state.channels.push_back(no_channel);
+            return state.adapters.size() - 1;
+        }
+        Converters& state = this->converter_state;
+        state.adapters.push_back(adapter);
+        state.addresses.push_back(spec.address);
+        state.conversions.push_back(0);
+        state.configs.push_back(uint16_t(ADS1115::Registers::Status::set(spec.config, false)));
+        state.configured.push_back(0);
+        state.channels.push_back(no_channel);
+        return state.adapters.size() - 1;
+    }
+
+    bool DeviceRegistry::build(const std::vector<DeviceSpec>& specs)
+    {
+        // Order by bus, keeping the description's order within each bus
+        std::vector<std::string> order;
+        for(const DeviceSpec& spec : specs)
+        {
+            if(std::find(order.begin(), order.end(), spec.bus) == order.end()) {
+                order.push_back(spec.bus);
+            }
+        }
+        for(const std::string& bus : order)
+        {
+            for(const DeviceSpec& spec : specs)
+            {
+                if(spec.bus == bus) {
+                    this->add(spec);
+                }
+            }
+        }
+        return this->configure();
+    }
+
+    bool DeviceRegistry::configure()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->remaining = this->adapters.size();
+        }
+        for(int adapter : this->adapters)
+        {
+            Executor::post(adapter, [this, adapter]() {
+                this->configure_bus(adapter);
+                std::lock_guard<std::mutex> lock(this->mutex);
+                if(--this->remaining == 0) {
+                    this->done.notify_one();
+                }
+            });
+        }
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done.wait(lock, [this]() { return this->remaining == 0; });
+
+        bool success = true;
+        for(uint8_t configured : this->expander_state.configured) {
+            success = success && configured != 0;
+        }
+        for(uint8_t configured : this->converter_state.configured) {
+            success = success && configured != 0;
+        }
+        return success;
+    }
+
+    /** Write the registers of one adapter's devices, on the adapter's Executor thread */
+    void DeviceRegistry::configure_bus(int adapter)
+    {
+        Expanders& expanders = this->expander_state;
+        Converters& converters = this->converter_state;
+        if(I2CPP::register_path(adapter, 2, false) != I2CPP::RegisterPath::TRANSFER)
+        {
+            for(std::size_t i = 0; i < expanders.adapters.size(); i++)
+            {
+                if(expanders.adapters[i] == adapter) {
+                    expanders.configured[i] = this->write(adapter, expanders.addresses[i], PCA9555::Registers::Polarity::address, expanders.polarities[i], Endian::LITTLE)
+                        && this->write(adapter, expanders.addresses[i], PCA9555::Registers::Output::address, expanders.outputs[i], Endian::LITTLE)
+                        && this->write(adapter, expanders.addresses[i], PCA9555::Registers::Configuration::address, expanders.configs[i], Endian::LITTLE) ? 1 : 0;
+                }
+            }
+            for(std::size_t i = 0; i < converters.adapters.size(); i++)
+            {
+                if(converters.adapters[i] == adapter) {
+                    converters.configured[i] = this->write(adapter, converters.addresses[i], ADS1115::Registers::Config::address, converters.configs[i], Endian::BIG) ? 1 : 0;
+                }
+            }
+            return;
+        }
+
+        // Every register write of the adapter in one batch, three bytes of buffer per message
+        std::size_t count = 0;
+        for(int owner : expanders.adapters) {
+            count += owner == adapter ? 3 : 0;
+        }
+        for(int owner : converters.adapters) {
+            count += owner == adapter ? 1 : 0;
+        }
+        std::vector<uint_fast8_t> buffers(3 * count);
+        std::vector<Message> messages;
+        messages.reserve(count);
+        auto queue = [&](uint_fast8_t address, uint_fast8_t command, uint_fast16_t value, Endian endian) {
+            uint_fast8_t* buffer = &buffers[3 * messages.size()];
+            buffer[0] = command;
+            buffer[endian == Endian::LITTLE ? 1 : 2] = value & 0xff;
+            buffer[endian == Endian::LITTLE ? 2 : 1] = (value >> 8) & 0xff;
+            messages.push_back({ address, false, buffer, 3, 0 });
+        };
+        for(std::size_t i = 0; i < expanders.adapters.size(); i++)
+        {
+            if(expanders.adapters[i] == adapter)
+            {
+                queue(expanders.addresses[i], PCA9555::Registers::Polarity::address, expanders.polarities[i], Endian::LITTLE);
+                queue(expanders.addresses[i], PCA9555::Registers::Output::address, expanders.outputs[i], Endian::LITTLE);
+                queue(expanders.addresses[i], PCA9555::Registers::Configuration::address, expanders.configs[i], Endian::LITTLE);
+            }
+        }
+        for(std::size_t i = 0; i < converters.adapters.size(); i++)
+        {
+            if(converters.adapters[i] == adapter) {
+                queue(converters.addresses[i], ADS1115::Registers::Config::address, converters.configs[i], Endian::BIG);
+            }
+        }
+        I2CPP::submit_batch(adapter, messages);
+
+        // Messages were queued in device order, so walk them again in the same order, dropping any cached reads of each device
+        std::size_t next = 0;
+        for(std::size_t i = 0; i < expanders.adapters.size(); i++)
+        {
+            if(expanders.adapters[i] == adapter)
+            {
+                expanders.configured[i] = messages[next].status == 0 && messages[next + 1].status == 0 && messages[next + 2].status == 0 ? 1 : 0;
+                ReadCache::invalidate(adapter, expanders.addresses[i]);
+                next += 3;
+            }
+        }
+        for(std::size_t i = 0; i < converters.adapters.size(); i++)
+        {
+            if(converters.adapters[i] == adapter)
+            {
+                converters.configured[i] = messages[next++].status == 0 ? 1 : 0;
+                ReadCache::invalidate(adapter, converters.addresses[i]);
+            }
+        }
+    }
+
+    /** Write a 16-bit register */
+    bool DeviceRegistry::write(int adapter, uint_fast8_t address, uint_fast8_t command, uint_fast16_t value, Endian endian)
+    {
+        if(adapter < 0) {
+            return false;
+        }
+        uint_fast8_t buffer[2];
+        buffer[endian == Endian::LITTLE ? 0 : 1] = value & 0xff;
+        buffer[endian == Endian::LITTLE ? 1 : 0] = (value >> 8) & 0xff;
+        bool success = I2CPP::write_register(adapter, address, command, buffer, 2) == 2;
+        ReadCache::invalidate(adapter, address);
+        return success;
+    }
+
+    bool DeviceRegistry::sweep()
+    {
+        Expanders& expanders = this->expander_state;
+        Converters& converters = this->converter_state;
+        if(!this->group)
+        {
+            // Add each adapter's registers together, so each adapter's values share cache lines only with each other
+            this->group.reset(new BusGroup());
+            for(int adapter : this->adapters)
+            {
+                for(std::size_t i = 0; i < expanders.adapters.size(); i++)
+                {
+                    if(expanders.adapters[i] == adapter) {
+                        expanders.channels[i] = this->group->add(adapter, expanders.addresses[i], PCA9555::Registers::Input::address, 2, Endian::LITTLE);
+                    }
+                }
+                for(std::size_t i = 0; i < converters.adapters.size(); i++)
+                {
+                    if(converters.adapters[i] == adapter) {
+                        converters.channels[i] = this->group->add(adapter, converters.addresses[i], ADS1115::Registers::Conversion::address, 2, Endian::BIG);
+                    }
+                }
+            }
+            this->frame = this->group->make_frame();
+        }
+
+        bool success = this->group->capture(this->frame);
+        for(std::size_t i = 0; i < expanders.adapters.size(); i++)
+        {
+            std::size_t channel = expanders.channels[i];
+            if(channel == no_channel) {
+                success = false;
+            } else if(this->frame.valid[channel]) {
+                expanders.inputs[i] = uint16_t(this->frame.values[channel]);
+            }
+        }
+        for(std::size_t i = 0; i < converters.adapters.size(); i++)
+        {
+            std::size_t channel = converters.channels[i];
+            if(channel == no_channel) {
+                success = false;
+            } else if(this->frame.valid[channel]) {
+                converters.conversions[i] = int16_t(uint16_t(this->frame.values[channel]));
+            }
+        }
+        return success;
+    }
+
+    std::size_t DeviceRegistry::expanders() const { return this->expander_state.adapters.size(); }
+    std::size_t DeviceRegistry::converters() const { return this->converter_state.adapters.size(); }
+    DeviceRegistry::Expander DeviceRegistry::expander(std::size_t index) { return Expander(*this, index); }
+    DeviceRegistry::Converter DeviceRegistry::converter(std::size_t index) { return Converter(*this, index); }
+
+    std::size_t DeviceRegistry::find(DeviceType type, const std::string& bus, uint_fast8_t address) const
+    {
+        std::map<std::string, int>::const_iterator found = this->buses.find(bus);
+        if(found == this->buses.end()) {
+            return std::size_t(-1);
+        }
+        const std::vector<int>& adapters = type == DeviceType::PCA9555 ? this->expander_state.adapters : this->converter_state.adapters;
+        const std::vector<uint_fast8_t>& addresses = type == DeviceType::PCA9555 ? this->expander_state.addresses : this->converter_state.addresses;
+        for(std::size_t i = 0; i < adapters.size(); i++)
+        {
+            if(adapters[i] == found->second && addresses[i] == address) {
+                return i;
+            }
+        }
+        return std::size_t(-1);
+    }
+}
@@ -0,0 +1,159 @@
+#include "i2cpp/scheduler.hpp"
+
+#include <algorithm>
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** Current monotonic time in nanoseconds, on the steady clock the adapter threads sleep on */
+        int64_t monotonic_now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    Scheduler::Scheduler() : running(false) {  }
+    Scheduler::~Scheduler() { this->stop(); }
+
+    int Scheduler::add_task(int adapter, std::chrono::nanoseconds period, Task task)
+    {
+        if(this->running.load() || period.count() <= 0) {
+            return -1;
+        }
+        this->entries.emplace_back(new Entry(task, period.count()));
+        this->groups[adapter].entries.push_back(this->entries.back().get());
+        return int(this->entries.size() - 1);
+    }
+    int Scheduler::add_task(const Device& device, std::chrono::nanoseconds period, Task task)
+    {
+        return this->add_task(device.get_adapter(), period, task);
+    }
+
+    bool Scheduler::start()
+    {
+        if(this->running.exchange(true)) {
+            return false;
+        }
+        int64_t now = monotonic_now();
+        std::map<int, Group>::iterator itr;
+        for(itr = this->groups.begin(); itr != this->groups.end(); itr++)
+        {
+            Group& group = itr->second;
+            // Shortest period first, so high-rate tasks win ties and see the least jitter
+            std::stable_sort(group.entries.begin(), group.entries.end(), [](const Entry* a, const Entry* b) {
+                return a->period < b->period;
+            });
+            for(Entry* entry : group.entries) {
+                entry->deadline = now;
+            }
+            group.thread = std::thread(&Scheduler::run, this, std::ref(group));
+        }
+        return true;
+    }
+    void Scheduler::stop()
+    {
+        {
+            // Cleared under the lock, so no thread can check it and then miss the wakeup
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if(!this->running.exchange(false)) {
+                return;
+            }
+        }
+        this->wake.notify_all();
+        std::map<int, Group>::iterator itr;
+        for(itr = this->groups.begin(); itr != this->groups.end(); itr++) {
+            itr->second.thread.join();
+        }
+    }
+
+    Scheduler::Statistics Scheduler::get_statistics(int task) const
+    {
+        Statistics stats = {};
+        if(task < 0 || std::size_t(task) >= this->entries.size()) {
+            return stats;
+        }
+        const Entry& entry = *this->entries[task];
+        stats.runs = entry.runs.load(std::memory_order_relaxed);
+        stats.overruns = entry.overruns.load(std::memory_order_relaxed);
+        stats.max_jitter = entry.max_jitter.load(std::memory_order_relaxed);
+        stats.total_jitter = entry.total_jitter.load(std::memory_order_relaxed);
+        for(std::size_t i = 0; i < Scheduler::histogram_size; i++) {
+            stats.jitter_histogram[i] = entry.jitter_histogram[i].load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    /** Adapter thread body: earliest deadline first, running every due task per wakeup */
+    void Scheduler::run(Group& group)
+    {
+        while(this->running.load())
+        {
+            int64_t next = group.entries.front()->deadline;
+            for(Entry* entry : group.entries) {
+                next = std::min(next, entry->deadline);
+            }
+            if(!this->sleep_until(next)) {
+                return;
+            }
+
+            int64_t now = monotonic_now();
+            for(Entry* entry : group.entries)
+            {
+                if(entry->deadline > now) {
+                    continue;
+                }
+                int64_t start = monotonic_now();
+                entry->record(start - entry->deadline);
+                entry->task();
+
+                entry->deadline += entry->period;
+                int64_t finished = monotonic_now();
+                if(entry->deadline <= finished) {
+                    int64_t missed = (finished - entry->deadline) / entry->period + 1;
+                    entry->overruns.fetch_add(missed, std::memory_order_relaxed);
+                    entry->deadline += missed * entry->period;
+                }
+            }
+        }
+    }
+
+
+    /**
+     * Sleep until an absolute monotonic time in nanoseconds, waking early for stop().
+     * @returns False if the scheduler was stopped
+     */
+    bool Scheduler::sleep_until(int64_t deadline)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        std::chrono::steady_clock::time_point until((std::chrono::nanoseconds(deadline)));
+        return !this->wake.wait_until(lock, until, [this]() { return !this->running.load(); });
+    }
+
+
+    Scheduler::Entry::Entry(Task task, int64_t period) : task(task), period(period), deadline(0),
+        runs(0), overruns(0), max_jitter(0), total_jitter(0)
+    {
+        for(std::size_t i = 0; i < Scheduler::histogram_size; i++) {
+            this->jitter_histogram[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /** Count a run started jitter nanoseconds after its deadline, only called from the adapter thread */
+    void Scheduler::Entry::record(int64_t jitter)
+    {
+        uint64_t late = jitter > 0 ? uint64_t(jitter) : 0;
+        std::size_t bucket = 0;
+        while(bucket + 1 < Scheduler::histogram_size && (late >> bucket) != 0) {
+            bucket++;
+        }
+        this->runs.fetch_add(1, std::memory_order_relaxed);
+        this->total_jitter.fetch_add(late, std::memory_order_relaxed);
+        this->jitter_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        if(late > this->max_jitter.load(std::memory_order_relaxed)) {
+            this->max_jitter.store(late, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,488 @@
+#include "i2cpp/simulated_bus.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <linux/i2c.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** Current steady clock time in nanoseconds */
+        int64_t steady_now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        /**
+         * Wait until a steady clock time in nanoseconds.
+         * Sleeps, so simulated buses overlap in time even on fewer cores than buses, and only spins
+         * through the last few microseconds for precision.
+         */
+        void wait_until(int64_t until)
+        {
+            const int64_t spin = 20000;
+            if(until - steady_now() > spin) {
+                std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(until - spin)));
+            }
+            while(steady_now() < until) {  }
+        }
+
+        /** ADS1115 full-scale range of each PGA setting, in volts */
+        const double ads1115_ranges[8] = { 6.144, 4.096, 2.048, 1.024, 0.512, 0.256, 0.256, 0.256 };
+        /** ADS1115 samples per second of each data rate setting */
+        const int64_t ads1115_rates[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+    }
+
+
+    SimulatedPCA9555::SimulatedPCA9555() : command(0), output(0xffff), polarity(0), config(0xffff),
+        external(0), last_input(0), interrupt(false), interrupt_fd(-1)
+    {
+        this->last_input = this->input();
+    }
+
+    void SimulatedPCA9555::set_pins(uint_fast16_t levels)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->external = levels & 0xffff;
+        this->update_interrupt();
+    }
+    uint_fast16_t SimulatedPCA9555::get_pins() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return (this->external & this->config) | (this->output & ~this->config & 0xffff);
+    }
+    uint_fast16_t SimulatedPCA9555::get_output() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->output;
+    }
+    uint_fast16_t SimulatedPCA9555::get_polarity() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->polarity;
+    }
+    uint_fast16_t SimulatedPCA9555::get_config() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->config;
+    }
+    bool SimulatedPCA9555::get_interrupt() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->interrupt;
+    }
+    void SimulatedPCA9555::set_interrupt_fd(int fd)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->interrupt_fd = fd;
+    }
+
+    void SimulatedPCA9555::write(const uint_fast8_t* buffer, std::size_t length)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if(length == 0) {
+            return;
+        }
+        this->command = buffer[0] & 0x07;
+        for(std::size_t i = 1; i < length; i++)
+        {
+            uint_fast16_t shift = (this->command & 0x01) * 8;
+            uint_fast16_t mask = uint_fast16_t(0xff) << shift;
+            uint_fast16_t value = uint_fast16_t(buffer[i] & 0xff) << shift;
+            switch(this->command >> 1)
+            {
+                case 1: this->output = (this->output & ~mask) | value; break;
+                case 2: this->polarity = (this->polarity & ~mask) | value; break;
+                case 3: this->config = (this->config & ~mask) | value; break;
+                default: break; // The input port is read-only
+            }
+            this->command ^= 0x01;
+        }
+        this->update_interrupt();
+    }
+    void SimulatedPCA9555::read(uint_fast8_t* buffer, std::size_t length)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for(std::size_t i = 0; i < length; i++)
+        {
+            uint_fast16_t shift = (this->command & 0x01) * 8;
+            uint_fast16_t value = 0;
+            switch(this->command >> 1)
+            {
+                case 0:
+                    value = this->input();
+                    this->last_input = value;
+                    this->interrupt = false;
+                    break;
+                case 1: value = this->output; break;
+                case 2: value = this->polarity; break;
+                case 3: value = this->config; break;
+            }
+            buffer[i] = uint_fast8_t((value >> shift) & 0xff);
+            this->command ^= 0x01;
+        }
+    }
+
+    /** Input port value: external levels (with inversion) on inputs, driven levels on outputs */
+    uint_fast16_t SimulatedPCA9555::input() const
+    {
+        return (((this->external ^ this->polarity) & this->config) | (this->output & ~this->config)) & 0xffff;
+    }
+    /** INT follows any difference between the input port and its last read value */
+    void SimulatedPCA9555::update_interrupt()
+    {
+        bool changed = this->input() != this->last_input;
+        if(changed && !this->interrupt && this->interrupt_fd >= 0) {
+            uint64_t one = 1;
+            ssize_t written = ::write(this->interrupt_fd, &one, sizeof(one));
+            (void)written;
+        }
+        this->interrupt = changed;
+    }
+
+
+    SimulatedADS1115::SimulatedADS1115() : pointer(0), registers{ 0x0000, 0x8583, 0x8000, 0x7fff },
+        inputs{ 0, 0, 0, 0 }, realtime(false), converting(false), ready_at(0), conversions(0) {  }
+
+    void SimulatedADS1115::set_input(uint_fast8_t channel, double volts)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if(channel < 4) {
+            this->inputs[channel] = volts;
+        }
+    }
+    void SimulatedADS1115::set_realtime(bool realtime)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->realtime = realtime;
+    }
+    uint64_t SimulatedADS1115::get_conversions() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->conversions;
+    }
+
+    void SimulatedADS1115::write(const uint_fast8_t* buffer, std::size_t length)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if(length == 0) {
+            return;
+        }
+        this->pointer = buffer[0] & 0x03;
+        if(length < 3 || this->pointer == 0x00) {
+            return;
+        }
+        uint_fast16_t value = uint_fast16_t(((buffer[1] & 0xff) << 8) | (buffer[2] & 0xff));
+        if(this->pointer != 0x01) {
+            this->registers[this->pointer] = value;
+            return;
+        }
+
+        this->update();
+        this->registers[1] = value & 0x7fff;
+        bool single_shot = (value & 0x0100) != 0;
+        if(single_shot && (value & 0x8000) != 0 && !this->converting) {
+            this->converting = true;
+            this->ready_at = steady_now() + this->conversion_time();
+        } else if(!single_shot) {
+            this->converting = false;
+            this->ready_at = steady_now() + this->conversion_time();
+        }
+        this->update();
+    }
+    void SimulatedADS1115::read(uint_fast8_t* buffer, std::size_t length)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->update();
+        uint_fast16_t value = this->registers[this->pointer];
+        if(this->pointer == 0x01 && !this->converting) {
+            value |= 0x8000;
+        }
+        for(std::size_t i = 0; i < length; i++) {
+            buffer[i] = uint_fast8_t((i % 2 == 0 ? value >> 8 : value) & 0xff);
+        }
+    }
+
+    /** Time one conversion takes at the configured data rate, 0 if not realtime */
+    int64_t SimulatedADS1115::conversion_time() const
+    {
+        if(!this->realtime) {
+            return 0;
+        }
+        return 1000000000 / ads1115_rates[(this->registers[1] >> 5) & 0x07];
+    }
+    /** Conversion result for the current mux and gain settings */
+    int_fast16_t SimulatedADS1115::convert() const
+    {
+        uint_fast8_t mux = (this->registers[1] >> 12) & 0x07;
+        double volts;
+        switch(mux)
+        {
+            case 0: volts = this->inputs[0] - this->inputs[1]; break;
+            case 1: volts = this->inputs[0] - this->inputs[3]; break;
+            case 2: volts = this->inputs[1] - this->inputs[3]; break;
+            case 3: volts = this->inputs[2] - this->inputs[3]; break;
+            default: volts = this->inputs[mux - 4]; break;
+        }
+        double code = std::round(volts / ads1115_ranges[(this->registers[1] >> 9) & 0x07] * 32768.0);
+        if(code > 32767.0) {
+            return 32767;
+        }
+        if(code < -32768.0) {
+            return -32768;
+        }
+        return int_fast16_t(code);
+    }
+    /** Complete any conversions which are due */
+    void SimulatedADS1115::update()
+    {
+        int64_t now = steady_now();
+        bool single_shot = (this->registers[1] & 0x0100) != 0;
+        if(single_shot) {
+            if(this->converting && now >= this->ready_at) {
+                this->registers[0] = uint_fast16_t(this->convert()) & 0xffff;
+                this->converting = false;
+                this->conversions++;
+            }
+            return;
+        }
+
+        int64_t period = this->conversion_time();
+        if(period == 0) {
+            this->registers[0] = uint_fast16_t(this->convert()) & 0xffff;
+            this->conversions++;
+        } else if(now >= this->ready_at) {
+            int64_t completed = (now - this->ready_at) / period + 1;
+            this->registers[0] = uint_fast16_t(this->convert()) & 0xffff;
+            this->conversions += completed;
+            this->ready_at += completed * period;
+        }
+    }
+
+
+    SimulatedBus::SimulatedBus() : address(-1), clock_rate(0), realtime(false),
+        functionality(I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL), pec(false), statistics()
+    {
+        this->handle = eventfd(0, EFD_CLOEXEC);
+    }
+    SimulatedBus::~SimulatedBus()
+    {
+        if(this->handle >= 0) {
+            close(this->handle);
+        }
+    }
+
+    void SimulatedBus::attach(int address, SimulatedDevice::SharedPtr device)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->devices[address] = device;
+    }
+    void SimulatedBus::detach(int address)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->devices.erase(address);
+    }
+    void SimulatedBus::set_nack(int address, bool nack)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if(nack) {
+            this->nacks.insert(address);
+        } else {
+            this->nacks.erase(address);
+        }
+    }
+    void SimulatedBus::set_clock(uint32_t clock_rate, bool realtime)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->clock_rate = clock_rate;
+        this->realtime = realtime && clock_rate > 0;
+    }
+    void SimulatedBus::set_functionality(unsigned long functionality)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->functionality = functionality;
+    }
+
+    SimulatedBus::Statistics SimulatedBus::get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->statistics;
+    }
+    void SimulatedBus::reset_statistics()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->statistics = Statistics();
+    }
+
+    int SimulatedBus::get_handle() const { return this->handle; }
+
+    int SimulatedBus::set_address(int address)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->statistics.calls++;
+        this->statistics.address_changes++;
+        this->address = address;
+        return 0;
+    }
+    ssize_t SimulatedBus::read(uint_fast8_t* buffer, std::size_t length)
+    {
+        Message message = { uint_fast8_t(0), true, buffer, length, 0 };
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            message.address = uint_fast8_t(this->address);
+        }
+        return this->transfer(&message, 1) == 1 ? ssize_t(length) : -1;
+    }
+    ssize_t SimulatedBus::write(const uint_fast8_t* buffer, std::size_t length)
+    {
+        Message message = { uint_fast8_t(0), false, const_cast<uint_fast8_t*>(buffer), length, 0 };
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            message.address = uint_fast8_t(this->address);
+        }
+        return this->transfer(&message, 1) == 1 ? ssize_t(length) : -1;
+    }
+    int SimulatedBus::transfer(Message* messages, std::size_t count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if((this->functionality & I2C_FUNC_I2C) == 0) {
+                errno = EOPNOTSUPP;
+                return -1;
+            }
+        }
+        return this->deliver(messages, count);
+    }
+    unsigned long SimulatedBus::get_functionality()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->functionality;
+    }
+    int SimulatedBus::set_pec(bool enable)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if(enable && (this->functionality & I2C_FUNC_SMBUS_PEC) == 0) {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+        this->pec = enable;
+        return 0;
+    }
+    ssize_t SimulatedBus::smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length)
+    {
+        unsigned long required;
+        switch(size)
+        {
+            case SMBusSize::QUICK: required = I2C_FUNC_SMBUS_QUICK; break;
+            case SMBusSize::BYTE: required = read ? I2C_FUNC_SMBUS_READ_BYTE : I2C_FUNC_SMBUS_WRITE_BYTE; break;
+            case SMBusSize::BYTE_DATA: required = read ? I2C_FUNC_SMBUS_READ_BYTE_DATA : I2C_FUNC_SMBUS_WRITE_BYTE_DATA; break;
+            case SMBusSize::WORD_DATA: required = read ? I2C_FUNC_SMBUS_READ_WORD_DATA : I2C_FUNC_SMBUS_WRITE_WORD_DATA; break;
+            default: required = read ? I2C_FUNC_SMBUS_READ_I2C_BLOCK : I2C_FUNC_SMBUS_WRITE_I2C_BLOCK; break;
+        }
+        uint_fast8_t address;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if((this->functionality & required) == 0) {
+                errno = EOPNOTSUPP;
+                return -1;
+            }
+            address = uint_fast8_t(this->address);
+        }
+        if(!valid_smbus_length(read, size, length)) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        // The bus sees the same messages as the equivalent I2C access; PEC bytes are not modelled
+        if(size == SMBusSize::QUICK || size == SMBusSize::BYTE)
+        {
+            Message message = { address, read, read ? buffer : &command, read ? length : std::size_t(size == SMBusSize::BYTE), 0 };
+            return this->deliver(&message, 1) == 1 ? ssize_t(length) : -1;
+        }
+        if(read)
+        {
+            Message messages[2] = {
+                { address, false, &command, 1, 0 },
+                { address, true, buffer, length, 0 }
+            };
+            return this->deliver(messages, 2) == 2 ? ssize_t(length) : -1;
+        }
+        uint_fast8_t data[I2C_SMBUS_BLOCK_MAX + 1];
+        data[0] = command;
+        for(std::size_t i = 0; i < length; i++) {
+            data[i + 1] = buffer[i];
+        }
+        Message message = { address, false, data, length + 1, 0 };
+        return this->deliver(&message, 1) == 1 ? ssize_t(length) : -1;
+    }
+
+    /** Route messages to the device models, regardless of the adapter's capabilities */
+    int SimulatedBus::deliver(Message* messages, std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->statistics.calls++;
+
+        uint64_t clocks = 1; // STOP
+        int result = int(count);
+        for(std::size_t i = 0; i < count; i++)
+        {
+            this->statistics.messages++;
+            SimulatedDevice* device = this->find(messages[i].address);
+            if(device == nullptr) {
+                this->statistics.nacks++;
+                this->statistics.bytes++;
+                clocks += this->clocks(0);
+                result = -1;
+                break;
+            }
+            if(messages[i].read) {
+                device->read(messages[i].buffer, messages[i].length);
+            } else {
+                device->write(messages[i].buffer, messages[i].length);
+            }
+            this->statistics.bytes += messages[i].length + 1;
+            clocks += this->clocks(messages[i].length);
+        }
+        int64_t wait = this->elapse(clocks);
+        lock.unlock();
+
+        if(wait > 0) {
+            wait_until(steady_now() + wait);
+        }
+        if(result < 0) {
+            errno = ENXIO;
+        }
+        return result;
+    }
+
+    /** Model at an address, nullptr if nothing acknowledges it */
+    SimulatedDevice* SimulatedBus::find(int address)
+    {
+        if(this->nacks.count(address) > 0) {
+            return nullptr;
+        }
+        std::map<int, SimulatedDevice::SharedPtr>::iterator found = this->devices.find(address);
+        return found == this->devices.end() ? nullptr : found->second.get();
+    }
+    /** Clocks taken by one message: START, then the address byte and data bytes with their ACKs */
+    uint64_t SimulatedBus::clocks(std::size_t length) const
+    {
+        return 1 + 9 * (uint64_t(length) + 1);
+    }
+    /** Account for bus time, returning how long the caller must wait it out */
+    int64_t SimulatedBus::elapse(uint64_t clocks)
+    {
+        if(this->clock_rate == 0) {
+            return 0;
+        }
+        uint64_t duration = clocks * 1000000000 / this->clock_rate;
+        this->statistics.bus_time += duration;
+        return this->realtime ? int64_t(duration) : 0;
+    }
+}
@@ -0,0 +1,230 @@
+#include "i2cpp/statistics.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+
+namespace i2cpp
+{
+    uint64_t LatencyHistogram::count() const
+    {
+        uint64_t total = 0;
+        for(std::size_t i = 0; i < LatencyHistogram::size; i++) {
+            total += this->buckets[i];
+        }
+        return total;
+    }
+    uint64_t LatencyHistogram::percentile(double fraction) const
+    {
+        uint64_t total = this->count();
+        if(total == 0) {
+            return 0;
+        }
+        uint64_t target = uint64_t(fraction * total);
+        uint64_t seen = 0;
+        for(std::size_t i = 0; i < LatencyHistogram::size; i++)
+        {
+            seen += this->buckets[i];
+            if(seen > target) {
+                return i == 0 ? 0 : (uint64_t(1) << i);
+            }
+        }
+        return uint64_t(1) << (LatencyHistogram::size - 1);
+    }
+
+
+    AdapterCounters::AdapterCounters() { this->reset(); }
+
+    void AdapterCounters::record_io(int address, bool read, std::size_t requested, ssize_t result, int error, uint64_t latency)
+    {
+        this->transactions.fetch_add(1, std::memory_order_relaxed);
+        this->latency.record(latency);
+
+        Address& device = this->addresses[address & 0x7f];
+        device.messages.fetch_add(1, std::memory_order_relaxed);
+        device.latency.record(latency);
+        if(result < 0) {
+            this->record_error(error);
+            device.errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        (read ? this->bytes_read : this->bytes_written).fetch_add(uint64_t(result), std::memory_order_relaxed);
+        (read ? device.bytes_read : device.bytes_written).fetch_add(uint64_t(result), std::memory_order_relaxed);
+        if(std::size_t(result) < requested) {
+            (read ? this->short_reads : this->short_writes).fetch_add(1, std::memory_order_relaxed);
+            device.short_transfers.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void AdapterCounters::record_transfer(const Message* messages, std::size_t count, int error, uint64_t latency)
+    {
+        this->transactions.fetch_add(1, std::memory_order_relaxed);
+        this->latency.record(latency);
+        if(error != 0) {
+            this->record_error(error);
+        }
+
+        bool single_address = true;
+        for(std::size_t i = 0; i < count; i++)
+        {
+            Address& device = this->addresses[messages[i].address & 0x7f];
+            device.messages.fetch_add(1, std::memory_order_relaxed);
+            if(error != 0) {
+                device.errors.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            bool read = messages[i].read;
+            (read ? this->bytes_read : this->bytes_written).fetch_add(messages[i].length, std::memory_order_relaxed);
+            (read ? device.bytes_read : device.bytes_written).fetch_add(messages[i].length, std::memory_order_relaxed);
+            single_address = single_address && messages[i].address == messages[0].address;
+        }
+        if(count > 0 && single_address) {
+            this->addresses[messages[0].address & 0x7f].latency.record(latency);
+        }
+    }
+    void AdapterCounters::record_address_change(bool success, int error)
+    {
+        this->address_changes.fetch_add(1, std::memory_order_relaxed);
+        if(!success) {
+            this->address_errors.fetch_add(1, std::memory_order_relaxed);
+            this->record_error(error);
+        }
+    }
+
+    AdapterStatistics AdapterCounters::snapshot(int adapter, const std::string& name) const
+    {
+        AdapterStatistics stats;
+        stats.adapter = adapter;
+        stats.name = name;
+        stats.transactions = this->transactions.load(std::memory_order_relaxed);
+        stats.bytes_read = this->bytes_read.load(std::memory_order_relaxed);
+        stats.bytes_written = this->bytes_written.load(std::memory_order_relaxed);
+        stats.address_changes = this->address_changes.load(std::memory_order_relaxed);
+        stats.address_errors = this->address_errors.load(std::memory_order_relaxed);
+        stats.short_reads = this->short_reads.load(std::memory_order_relaxed);
+        stats.short_writes = this->short_writes.load(std::memory_order_relaxed);
+        stats.errors = this->errors.load(std::memory_order_relaxed);
+        for(std::size_t i = 0; i < AdapterCounters::error_slots; i++)
+        {
+            uint64_t count = this->errors_by_errno[i].load(std::memory_order_relaxed);
+            if(count > 0) {
+                stats.errors_by_errno[int(i)] = count;
+            }
+        }
+        this->latency.snapshot(stats.latency);
+
+        for(std::size_t i = 0; i < AdapterCounters::address_slots; i++)
+        {
+            const Address& device = this->addresses[i];
+            uint64_t messages = device.messages.load(std::memory_order_relaxed);
+            if(messages == 0) {
+                continue;
+            }
+            AddressStatistics address;
+            address.address = uint_fast8_t(i);
+            address.messages = messages;
+            address.bytes_read = device.bytes_read.load(std::memory_order_relaxed);
+            address.bytes_written = device.bytes_written.load(std::memory_order_relaxed);
+            address.short_transfers = device.short_transfers.load(std::memory_order_relaxed);
+            address.errors = device.errors.load(std::memory_order_relaxed);
+            device.latency.snapshot(address.latency);
+            stats.addresses.push_back(address);
+        }
+        return stats;
+    }
+    void AdapterCounters::reset()
+    {
+        this->transactions.store(0, std::memory_order_relaxed);
+        this->bytes_read.store(0, std::memory_order_relaxed);
+        this->bytes_written.store(0, std::memory_order_relaxed);
+        this->address_changes.store(0, std::memory_order_relaxed);
+        this->address_errors.store(0, std::memory_order_relaxed);
+        this->short_reads.store(0, std::memory_order_relaxed);
+        this->short_writes.store(0, std::memory_order_relaxed);
+        this->errors.store(0, std::memory_order_relaxed);
+        for(std::size_t i = 0; i < AdapterCounters::error_slots; i++) {
+            this->errors_by_errno[i].store(0, std::memory_order_relaxed);
+        }
+        this->latency.reset();
+        for(std::size_t i = 0; i < AdapterCounters::address_slots; i++)
+        {
+            Address& device = this->addresses[i];
+            device.messages.store(0, std::memory_order_relaxed);
+            device.bytes_read.store(0, std::memory_order_relaxed);
+            device.bytes_written.store(0, std::memory_order_relaxed);
+            device.short_transfers.store(0, std::memory_order_relaxed);
+            device.errors.store(0, std::memory_order_relaxed);
+            device.latency.reset();
+        }
+    }
+
+    void AdapterCounters::record_error(int error)
+    {
+        this->errors.fetch_add(1, std::memory_order_relaxed);
+        std::size_t slot = error < 0 || std::size_t(error) >= AdapterCounters::error_slots ? AdapterCounters::error_slots - 1 : std::size_t(error);
+        this->errors_by_errno[slot].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AdapterCounters::Histogram::record(uint64_t latency)
+    {
+        std::size_t bucket = 0;
+        while(bucket + 1 < LatencyHistogram::size && (latency >> bucket) != 0) {
+            bucket++;
+        }
+        this->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+    void AdapterCounters::Histogram::snapshot(LatencyHistogram& into) const
+    {
+        for(std::size_t i = 0; i < LatencyHistogram::size; i++) {
+            into.buckets[i] = this->buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    void AdapterCounters::Histogram::reset()
+    {
+        for(std::size_t i = 0; i < LatencyHistogram::size; i++) {
+            this->buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+
+    std::string format_statistics(const std::vector<AdapterStatistics>& statistics)
+    {
+        std::string text;
+        char line[256];
+        for(const AdapterStatistics& adapter : statistics)
+        {
+            std::snprintf(line, sizeof(line), "adapter %d (%s): %llu transactions, %llu bytes read, %llu bytes written, "
+                          "%llu address changes (%llu failed), %llu short reads, %llu short writes, %llu errors, "
+                          "latency p50 <= %lluns p99 <= %lluns p999 <= %lluns\n",
+                          adapter.adapter, adapter.name.c_str(),
+                          (unsigned long long)adapter.transactions, (unsigned long long)adapter.bytes_read,
+                          (unsigned long long)adapter.bytes_written, (unsigned long long)adapter.address_changes,
+                          (unsigned long long)adapter.address_errors, (unsigned long long)adapter.short_reads,
+                          (unsigned long long)adapter.short_writes, (unsigned long long)adapter.errors,
+                          (unsigned long long)adapter.latency.percentile(0.50),
+                          (unsigned long long)adapter.latency.percentile(0.99),
+                          (unsigned long long)adapter.latency.percentile(0.999));
+            text += line;
+
+            std::map<int, uint64_t>::const_iterator error;
+            for(error = adapter.errors_by_errno.begin(); error != adapter.errors_by_errno.end(); error++)
+            {
+                std::snprintf(line, sizeof(line), "  errno %d (%s): %llu\n",
+                              error->first, std::strerror(error->first), (unsigned long long)error->second);
+                text += line;
+            }
+            for(const AddressStatistics& address : adapter.addresses)
+            {
+                std::snprintf(line, sizeof(line), "  0x%02x: %llu messages, %llu bytes read, %llu bytes written, "
+                              "%llu short, %llu errors, latency p50 <= %lluns p99 <= %lluns\n",
+                              unsigned(address.address), (unsigned long long)address.messages,
+                              (unsigned long long)address.bytes_read, (unsigned long long)address.bytes_written,
+                              (unsigned long long)address.short_transfers, (unsigned long long)address.errors,
+                              (unsigned long long)address.latency.percentile(0.50),
+                              (unsigned long long)address.latency.percentile(0.99));
+                text += line;
+            }
+        }
+        return text;
+    }
+}
@@ -0,0 +1,305 @@
+#include "i2cpp/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "i2cpp/i2cpp.hpp"
+
+
+namespace i2cpp
+{
+    namespace
+    {
+        /** Header at the start of every trace file */
+        struct TraceHeader
+        {
+            char magic[8];
+            uint32_t record_size;
+            uint32_t reserved;
+        };
+        const char trace_magic[8] = { 'I', '2', 'C', 'P', 'T', 'R', 'C', '1' };
+
+        /** Current steady clock time in nanoseconds, on the same clock as the recorded timestamps */
+        uint64_t steady_now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+
+    constexpr std::size_t TraceRecord::payload_size;
+
+
+    Tracer::Buffer::Buffer() : count(0)
+    {
+        Tracer& tracer = Tracer::instance();
+        std::lock_guard<std::mutex> lock(tracer.mutex);
+        tracer.buffers.push_back(this);
+    }
+    /** Write out the exiting thread's records */
+    Tracer::Buffer::~Buffer()
+    {
+        Tracer& tracer = Tracer::instance();
+        std::lock_guard<std::mutex> lock(tracer.mutex);
+        {
+            std::lock_guard<std::mutex> own(this->mutex);
+            tracer._flush(*this);
+        }
+        tracer.buffers.erase(std::find(tracer.buffers.begin(), tracer.buffers.end(), this));
+    }
+
+    Tracer::Tracer() : enabled(false), fd(-1), mapping(nullptr), capacity(0), written(0), dropped(0) {  }
+    Tracer::~Tracer()
+    {
+        Tracer::stop();
+    }
+    Tracer& Tracer::instance()
+    {
+        static Tracer inst;
+        return inst;
+    }
+    /** The calling thread's buffer, allocated and registered on first use */
+    Tracer::Buffer& Tracer::buffer()
+    {
+        static thread_local std::unique_ptr<Buffer> buffer;
+        if(!buffer) {
+            buffer.reset(new Buffer());
+        }
+        return *buffer;
+    }
+
+    bool Tracer::start(const std::string& path, std::size_t capacity)
+    {
+        Tracer& inst = instance();
+        std::lock_guard<std::mutex> lock(inst.mutex);
+        if(inst.mapping != nullptr || capacity == 0) {
+            return false;
+        }
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fd < 0) {
+            return false;
+        }
+        std::size_t size = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+        void* mapping = MAP_FAILED;
+        if(ftruncate(fd, off_t(size)) == 0) {
+            mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if(mapping == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+
+        TraceHeader header;
+        std::memcpy(header.magic, trace_magic, sizeof(header.magic));
+        header.record_size = sizeof(TraceRecord);
+        header.reserved = 0;
+        std::memcpy(mapping, &header, sizeof(header));
+
+        inst.fd = fd;
+        inst.mapping = static_cast<uint8_t*>(mapping);
+        inst.capacity = capacity;
+        inst.written.store(0, std::memory_order_relaxed);
+        inst.dropped.store(0, std::memory_order_relaxed);
+        inst.enabled.store(true, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t Tracer::stop()
+    {
+        Tracer& inst = instance();
+        std::lock_guard<std::mutex> lock(inst.mutex);
+        if(inst.mapping == nullptr) {
+            return 0;
+        }
+        inst.enabled.store(false, std::memory_order_relaxed);
+        // Threads check enabled again under their buffer's lock, so none can append past this point
+        for(Buffer* buffer : inst.buffers)
+        {
+            std::lock_guard<std::mutex> own(buffer->mutex);
+            inst._flush(*buffer);
+        }
+
+        std::size_t records = std::min(inst.written.load(std::memory_order_relaxed), inst.capacity);
+        munmap(inst.mapping, sizeof(TraceHeader) + inst.capacity * sizeof(TraceRecord));
+        // If truncating fails, the unused tail stays zeroed and readers stop at its first empty record
+        int truncated = ftruncate(inst.fd, off_t(sizeof(TraceHeader) + records * sizeof(TraceRecord)));
+        (void)truncated;
+        close(inst.fd);
+        inst.fd = -1;
+        inst.mapping = nullptr;
+        return records;
+    }
+
+    uint64_t Tracer::get_dropped() { return instance().dropped.load(std::memory_order_relaxed); }
+
+    void Tracer::record(const TraceRecord& record, const uint_fast8_t* payload, std::size_t length)
+    {
+        Tracer& inst = instance();
+        Buffer& buffer = Tracer::buffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        // Acquire pairs with the release in start(), so the mapping and capacity are visible once enabled is seen
+        if(!inst.enabled.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        TraceRecord& entry = buffer.records[buffer.count++];
+        entry = record;
+        entry.captured = uint8_t(std::min(length, TraceRecord::payload_size));
+        for(std::size_t i = 0; i < entry.captured; i++) {
+            entry.payload[i] = uint8_t(payload[i]);
+        }
+        std::memset(entry.payload + entry.captured, 0, TraceRecord::payload_size - entry.captured);
+
+        if(buffer.count == Tracer::buffer_size) {
+            inst._flush(buffer);
+        }
+    }
+
+    void Tracer::flush()
+    {
+        Tracer& inst = instance();
+        Buffer& buffer = Tracer::buffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        if(inst.enabled.load(std::memory_order_acquire)) {
+            inst._flush(buffer);
+        }
+    }
+
+    /** Copy a buffer's records into the file, the buffer's lock must be held */
+    void Tracer::_flush(Buffer& buffer)
+    {
+        if(buffer.count == 0) {
+            return;
+        }
+        if(this->mapping != nullptr)
+        {
+            std::size_t first = this->written.fetch_add(buffer.count, std::memory_order_relaxed);
+            std::size_t fits = first >= this->capacity ? 0 : std::min(buffer.count, this->capacity - first);
+            std::memcpy(this->mapping + sizeof(TraceHeader) + first * sizeof(TraceRecord), buffer.records, fits * sizeof(TraceRecord));
+            this->dropped.fetch_add(buffer.count - fits, std::memory_order_relaxed);
+        }
+        buffer.count = 0;
+    }
+
+    bool Tracer::load(const std::string& path, std::vector<TraceRecord>& records)
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            return false;
+        }
+        TraceHeader header;
+        bool valid = read(fd, &header, sizeof(header)) == ssize_t(sizeof(header))
+            && std::memcmp(header.magic, trace_magic, sizeof(header.magic)) == 0
+            && header.record_size == sizeof(TraceRecord);
+
+        records.clear();
+        TraceRecord record;
+        while(valid && read(fd, &record, sizeof(record)) == ssize_t(sizeof(record)) && record.kind != TraceKind::NONE) {
+            records.push_back(record);
+        }
+        close(fd);
+        return valid;
+    }
+
+
+    TraceReplayer::TraceReplayer(const std::vector<TraceRecord>& records) : records(records)
+    {
+        // Threads write their records out in batches, so restore the order they happened in
+        std::stable_sort(this->records.begin(), this->records.end(), [](const TraceRecord& a, const TraceRecord& b) {
+            if(a.timestamp != b.timestamp) {
+                return a.timestamp < b.timestamp;
+            }
+            return a.adapter != b.adapter ? a.adapter < b.adapter : a.index < b.index;
+        });
+    }
+
+    void TraceReplayer::map_adapter(int recorded, int adapter) { this->adapters[recorded] = adapter; }
+
+    TraceReplayer::Result TraceReplayer::replay(double speed)
+    {
+        Result result = Result();
+        if(this->records.empty()) {
+            return result;
+        }
+        uint64_t origin = this->records.front().timestamp;
+        result.recorded = this->records.back().timestamp - origin;
+
+        std::vector<uint_fast8_t> data;
+        std::vector<std::vector<uint_fast8_t>> buffers;
+        std::vector<Message> messages;
+        uint64_t start = steady_now();
+        for(std::size_t i = 0; i < this->records.size(); )
+        {
+            const TraceRecord& record = this->records[i];
+            std::size_t count = (record.kind == TraceKind::TRANSFER_READ || record.kind == TraceKind::TRANSFER_WRITE)
+                ? std::max<std::size_t>(record.count, 1) : 1;
+            count = std::min(count, this->records.size() - i);
+
+            std::map<int, int>::const_iterator adapter = this->adapters.find(record.adapter);
+            if(adapter == this->adapters.end() || record.kind == TraceKind::SET_ADDRESS) {
+                result.skipped += adapter == this->adapters.end() ? count : 0;
+                i += count;
+                continue;
+            }
+
+            if(speed > 0)
+            {
+                uint64_t due = start + uint64_t(double(record.timestamp - origin) / speed);
+                uint64_t now = steady_now();
+                if(now < due) {
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+                } else {
+                    result.max_lag = std::max(result.max_lag, now - due);
+                }
+            }
+
+            bool success = false;
+            bool recorded = record.result >= 0;
+            data.assign(record.payload, record.payload + record.captured);
+            data.resize(std::max<std::size_t>(record.length, 1), 0);
+            switch(record.kind)
+            {
+                case TraceKind::READ:
+                    success = I2CPP::read_i2c(adapter->second, record.address, data.data(), record.length) == record.length;
+                    break;
+                case TraceKind::WRITE:
+                    success = I2CPP::write_i2c(adapter->second, record.address, data.data(), record.length) == record.length;
+                    break;
+                case TraceKind::REGISTER_READ:
+                    success = I2CPP::read_register(adapter->second, record.address, record.command, data.data(), record.length) == record.length;
+                    break;
+                case TraceKind::REGISTER_WRITE:
+                    success = I2CPP::write_register(adapter->second, record.address, record.command, data.data(), record.length) == record.length;
+                    break;
+                case TraceKind::PROBE:
+                    success = I2CPP::probe(adapter->second, record.address);
+                    break;
+                default:
+                    buffers.resize(count);
+                    messages.resize(count);
+                    for(std::size_t m = 0; m < count; m++)
+                    {
+                        const TraceRecord& part = this->records[i + m];
+                        buffers[m].assign(part.payload, part.payload + part.captured);
+                        buffers[m].resize(std::max<std::size_t>(part.length, 1), 0);
+                        messages[m] = { uint_fast8_t(part.address), part.kind == TraceKind::TRANSFER_READ, buffers[m].data(), part.length, 0 };
+                        recorded = recorded && part.result >= 0;
+                    }
+                    success = I2CPP::transfer(adapter->second, messages.data(), count);
+                    break;
+            }
+            result.operations++;
+            result.mismatches += success != recorded ? 1 : 0;
+            i += count;
+        }
+        result.elapsed = steady_now() - start;
+        return result;
+    }
+}
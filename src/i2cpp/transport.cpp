@@ -0,0 +1,164 @@
+#include "i2cpp/transport.hpp"
+
+#include <string>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+
+namespace i2cpp
+{
+    unsigned long Transport::get_functionality() { return I2C_FUNC_I2C; }
+    int Transport::set_pec(bool enable)
+    {
+        (void)enable;
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    ssize_t Transport::smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length)
+    {
+        (void)read, (void)command, (void)size, (void)buffer, (void)length;
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    bool valid_smbus_length(bool read, SMBusSize size, std::size_t length)
+    {
+        switch(size)
+        {
+            case SMBusSize::QUICK: return length == 0;
+            case SMBusSize::BYTE: return length == (read ? 1u : 0u);
+            case SMBusSize::BYTE_DATA: return length == 1;
+            case SMBusSize::WORD_DATA: return length == 2;
+            default: return length >= 1 && length <= I2C_SMBUS_BLOCK_MAX;
+        }
+    }
+
+
+    LinuxTransport::LinuxTransport(const std::string& filename) : owned(true)
+    {
+        this->fd = open(filename.c_str(), O_RDWR);
+    }
+    LinuxTransport::LinuxTransport(int fd, bool owned) : fd(fd), owned(owned) {  }
+    LinuxTransport::~LinuxTransport()
+    {
+        if(this->owned && this->fd >= 0) {
+            close(this->fd);
+        }
+    }
+
+    int LinuxTransport::get_handle() const { return this->fd; }
+
+    int LinuxTransport::set_address(int address)
+    {
+        return ioctl(this->fd, I2C_SLAVE, address) < 0 ? -1 : 0;
+    }
+    ssize_t LinuxTransport::read(uint_fast8_t* buffer, std::size_t length)
+    {
+        return ::read(this->fd, buffer, length);
+    }
+    ssize_t LinuxTransport::write(const uint_fast8_t* buffer, std::size_t length)
+    {
+        return ::write(this->fd, buffer, length);
+    }
+    int LinuxTransport::transfer(Message* messages, std::size_t count)
+    {
+        if(count > I2C_RDWR_IOCTL_MAX_MSGS) {
+            errno = EINVAL;
+            return -1;
+        }
+        struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+        for(std::size_t i = 0; i < count; i++)
+        {
+            // i2c_msg lengths are 16 bits wide, so longer buffers would silently be cut short
+            if(messages[i].length > UINT16_MAX) {
+                errno = EINVAL;
+                return -1;
+            }
+            msgs[i].addr = messages[i].address;
+            msgs[i].flags = messages[i].read ? I2C_M_RD : 0;
+            msgs[i].len = messages[i].length;
+            msgs[i].buf = reinterpret_cast<uint8_t*>(messages[i].buffer);
+        }
+        struct i2c_rdwr_ioctl_data data = { msgs, uint32_t(count) };
+        return ioctl(this->fd, I2C_RDWR, &data);
+    }
+    unsigned long LinuxTransport::get_functionality()
+    {
+        unsigned long functionality = 0;
+        if(ioctl(this->fd, I2C_FUNCS, &functionality) < 0) {
+            return 0;
+        }
+        return functionality;
+    }
+    int LinuxTransport::set_pec(bool enable)
+    {
+        return ioctl(this->fd, I2C_PEC, enable ? 1 : 0) < 0 ? -1 : 0;
+    }
+    ssize_t LinuxTransport::smbus(bool read, uint_fast8_t command, SMBusSize size, uint_fast8_t* buffer, std::size_t length)
+    {
+        if(!valid_smbus_length(read, size, length)) {
+            errno = EINVAL;
+            return -1;
+        }
+        union i2c_smbus_data data;
+        struct i2c_smbus_ioctl_data args;
+        args.read_write = read ? I2C_SMBUS_READ : I2C_SMBUS_WRITE;
+        args.command = uint8_t(command);
+        args.data = &data;
+        switch(size)
+        {
+            case SMBusSize::QUICK:
+                args.size = I2C_SMBUS_QUICK;
+                args.data = nullptr;
+                break;
+            case SMBusSize::BYTE:
+                args.size = I2C_SMBUS_BYTE;
+                data.byte = 0;
+                break;
+            case SMBusSize::BYTE_DATA:
+                args.size = I2C_SMBUS_BYTE_DATA;
+                data.byte = read ? 0 : uint8_t(buffer[0]);
+                break;
+            case SMBusSize::WORD_DATA:
+                args.size = I2C_SMBUS_WORD_DATA;
+                data.word = read ? 0 : uint16_t((buffer[0] & 0xff) | ((buffer[1] & 0xff) << 8));
+                break;
+            default:
+                args.size = I2C_SMBUS_I2C_BLOCK_DATA;
+                data.block[0] = uint8_t(length);
+                for(std::size_t i = 0; !read && i < length; i++) {
+                    data.block[i + 1] = uint8_t(buffer[i]);
+                }
+                break;
+        }
+        if(ioctl(this->fd, I2C_SMBUS, &args) < 0) {
+            return -1;
+        }
+        if(read)
+        {
+            switch(size)
+            {
+                case SMBusSize::QUICK:
+                    break;
+                case SMBusSize::BYTE:
+                case SMBusSize::BYTE_DATA:
+                    buffer[0] = data.byte;
+                    break;
+                case SMBusSize::WORD_DATA:
+                    buffer[0] = data.word & 0xff;
+                    buffer[1] = data.word >> 8;
+                    break;
+                default:
+                    for(std::size_t i = 0; i < length; i++) {
+                        buffer[i] = data.block[i + 1];
+                    }
+                    break;
+            }
+        }
+        return ssize_t(length);
+    }
+}
@@ -0,0 +1,134 @@
+/**
+ * @file arbiter.cpp
+ * @author Scott Fasone
+ *
+ * Arbiter grants: most urgent class first, arrival order within a class with no barging by the
+ * releasing thread, and a class passed over starvation_limit times served next regardless.
+ */
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/arbiter.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** Threads queued on an arbiter, recording the order they are granted it in */
+    class Queue
+    {
+        public:
+            explicit Queue(Arbiter& arbiter) : arbiter(arbiter) {  }
+            ~Queue() { this->join(); }
+
+            /** Start a thread waiting in a class, once the previous one is surely waiting */
+            void add(BusPriority priority, int id)
+            {
+                this->threads.emplace_back([this, priority, id]() {
+                    PriorityScope scope(priority);
+                    this->arbiter.lock();
+                    {
+                        std::lock_guard<std::mutex> lock(this->mutex);
+                        this->order.push_back(id);
+                    }
+                    this->arbiter.unlock();
+                });
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            void join()
+            {
+                for(std::thread& thread : this->threads) {
+                    thread.join();
+                }
+                this->threads.clear();
+            }
+
+            std::vector<int> order;
+
+        private:
+            Arbiter& arbiter;
+            std::mutex mutex;
+            std::vector<std::thread> threads;
+    };
+
+    void priority_order()
+    {
+        Arbiter arbiter;
+        arbiter.lock();
+        CHECK(!arbiter.try_lock());
+        Queue queue(arbiter);
+        queue.add(BusPriority::BULK, 2);
+        queue.add(BusPriority::CONTROL, 1);
+        queue.add(BusPriority::URGENT, 0);
+        arbiter.unlock();
+        queue.join();
+        CHECK(queue.order == std::vector<int>({ 0, 1, 2 }));
+
+        ArbitrationStatistics statistics[bus_priorities];
+        arbiter.snapshot(statistics);
+        CHECK(statistics[int(BusPriority::URGENT)].contended == 1);
+        CHECK(statistics[int(BusPriority::CONTROL)].grants == 2);
+        CHECK(arbiter.try_lock());
+        arbiter.unlock();
+    }
+
+    /** Waiters of one class go in arrival order, even ahead of the releasing thread locking again at once */
+    void arrival_order()
+    {
+        Arbiter arbiter;
+        arbiter.lock();
+        Queue queue(arbiter);
+        for(int i = 0; i < 4; i++) {
+            queue.add(BusPriority::CONTROL, i);
+        }
+        arbiter.unlock();
+        arbiter.lock();
+        {
+            // Every queued thread must have gone first
+            queue.join();
+        }
+        arbiter.unlock();
+        CHECK(queue.order == std::vector<int>({ 0, 1, 2, 3 }));
+    }
+
+    /** A bulk waiter behind a stream of urgent ones is served after starvation_limit urgent grants */
+    void starvation()
+    {
+        Arbiter arbiter;
+        arbiter.lock();
+        Queue queue(arbiter);
+        queue.add(BusPriority::BULK, 100);
+        const int urgent = int(Arbiter::starvation_limit) + 2;
+        for(int i = 0; i < urgent; i++) {
+            queue.add(BusPriority::URGENT, i);
+        }
+        arbiter.unlock();
+        queue.join();
+
+        std::vector<int> expected;
+        for(int i = 0; i < urgent; i++)
+        {
+            if(i == int(Arbiter::starvation_limit)) {
+                expected.push_back(100);
+            }
+            expected.push_back(i);
+        }
+        CHECK(queue.order == expected);
+        ArbitrationStatistics statistics[bus_priorities];
+        arbiter.snapshot(statistics);
+        CHECK(statistics[int(BusPriority::BULK)].starvation_grants == 1);
+        CHECK(statistics[int(BusPriority::URGENT)].starvation_grants == 0);
+    }
+}
+
+int main()
+{
+    priority_order();
+    arrival_order();
+    starvation();
+    return check::result();
+}
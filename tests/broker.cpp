@@ -0,0 +1,112 @@
+/**
+ * @file broker.cpp
+ * @author Scott Fasone
+ *
+ * A BrokerTransport must notice a broker killed without cleaning up, whose segment still reads as
+ * running, and reconnect to the broker started in its place.
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "check.hpp"
+#include "i2cpp/broker.hpp"
+#include "i2cpp/simulated_bus.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** Read a PCA9555 input port through a transport */
+    int read_input(Transport& transport, int address)
+    {
+        uint_fast8_t command = 0x00;
+        uint_fast8_t data[2] = { 0, 0 };
+        Message messages[2] = {
+            { uint_fast8_t(address), false, &command, 1, 0 },
+            { uint_fast8_t(address), true, data, 2, 0 }
+        };
+        if(transport.transfer(messages, 2) != 2) {
+            return -1;
+        }
+        return int(data[0] | (data[1] << 8));
+    }
+
+    /**
+     * Serve a simulated expander from a child process until it is killed.
+     * @returns Process ID of the broker, once it serves requests, or -1 if it failed to start
+     */
+    pid_t spawn_broker(const std::string& filename, uint_fast16_t pins)
+    {
+        int ready[2];
+        if(pipe(ready) != 0) {
+            return -1;
+        }
+        pid_t child = fork();
+        if(child == 0)
+        {
+            close(ready[0]);
+            SimulatedPCA9555::SharedPtr board = std::make_shared<SimulatedPCA9555>();
+            board->set_pins(pins);
+            SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+            bus->attach(0x20, board);
+            Broker broker(filename, bus);
+            char started = broker.start() ? 1 : 0;
+            ssize_t sent = ::write(ready[1], &started, 1);
+            (void)sent;
+            for(;;) {
+                pause();
+            }
+        }
+        close(ready[1]);
+        char started = 0;
+        if(child < 0 || ::read(ready[0], &started, 1) != 1 || !started)
+        {
+            if(child > 0) {
+                kill(child, SIGKILL);
+                waitpid(child, nullptr, 0);
+            }
+            child = -1;
+        }
+        close(ready[0]);
+        return child;
+    }
+
+    void kill_and_restart()
+    {
+        std::string filename = "/test-broker-" + std::to_string(getpid());
+        pid_t first = spawn_broker(filename, 0x1234);
+        CHECK(first > 0);
+
+        BrokerTransport client(filename, 1000);
+        CHECK(client.is_connected());
+        CHECK(read_input(client, 0x20) == 0x1234);
+
+        // Killed brokers leave their segment behind, still marked as running
+        kill(first, SIGKILL);
+        waitpid(first, nullptr, 0);
+        CHECK(!client.is_connected());
+        CHECK(read_input(client, 0x20) == -1);
+
+        pid_t second = spawn_broker(filename, 0x4321);
+        CHECK(second > 0);
+        CHECK(read_input(client, 0x20) == 0x4321);
+        CHECK(client.is_connected());
+
+        kill(second, SIGKILL);
+        waitpid(second, nullptr, 0);
+        shm_unlink(Broker::segment_name(filename).c_str());
+    }
+}
+
+int main()
+{
+    kill_and_restart();
+    return check::result();
+}
@@ -0,0 +1,76 @@
+/**
+ * @file bus_group.cpp
+ * @author Scott Fasone
+ *
+ * BusGroup snapshots over several adapters, with channels of different adapters added interleaved.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/bus_group.hpp"
+#include "i2cpp/simulated_bus.hpp"
+
+using namespace i2cpp;
+
+int main()
+{
+    const int buses = 3;
+    const int devices = 4;
+
+    std::vector<SimulatedBus::SharedPtr> simulated;
+    std::vector<std::vector<SimulatedPCA9555::SharedPtr>> boards(buses);
+    std::vector<std::vector<PCA9555::SharedPtr>> expanders(buses);
+    for(int i = 0; i < buses; i++)
+    {
+        simulated.push_back(std::make_shared<SimulatedBus>());
+        std::string name = "test-group-" + std::to_string(i);
+        CHECK(I2CPP::attach_adapter(name, simulated[i]) >= 0);
+        for(int j = 0; j < devices; j++)
+        {
+            boards[i].push_back(std::make_shared<SimulatedPCA9555>());
+            simulated[i]->attach(0x20 + j, boards[i][j]);
+            expanders[i].push_back(std::make_shared<PCA9555>(name, uint_fast8_t(0x20 + j)));
+        }
+    }
+
+    // Interleave adapters, so channel numbers of one adapter are not contiguous
+    BusGroup group;
+    std::vector<std::vector<std::size_t>> channels(buses, std::vector<std::size_t>(devices));
+    for(int j = 0; j < devices; j++) {
+        for(int i = 0; i < buses; i++) {
+            channels[i][j] = group.add(*expanders[i][j]);
+        }
+    }
+    CHECK(group.size() == std::size_t(buses * devices));
+
+    BusGroup::Frame frame = group.make_frame();
+    for(int round = 0; round < 3; round++)
+    {
+        for(int i = 0; i < buses; i++) {
+            for(int j = 0; j < devices; j++) {
+                boards[i][j]->set_pins(uint_fast16_t(0x1000 * i + 0x100 * j + round));
+            }
+        }
+        // The last device of the last bus stops answering in the final round
+        simulated[buses - 1]->set_nack(0x20 + devices - 1, round == 2);
+
+        CHECK(group.capture(frame) == (round != 2));
+        CHECK(frame.sequence == uint64_t(round + 1));
+        for(int i = 0; i < buses; i++)
+        {
+            CHECK(frame.buses[i].adapter == expanders[i][0]->get_adapter());
+            CHECK(frame.buses[i].finished >= frame.buses[i].started);
+            for(int j = 0; j < devices; j++)
+            {
+                bool missing = round == 2 && i == buses - 1 && j == devices - 1;
+                CHECK(frame.valid[channels[i][j]] == (missing ? 0 : 1));
+                CHECK(frame.values[channels[i][j]] == (missing ? 0 : uint_fast32_t(0x1000 * i + 0x100 * j + round)));
+            }
+        }
+        CHECK(frame.buses[buses - 1].errors == (round == 2 ? 1u : 0u));
+    }
+    return check::result();
+}
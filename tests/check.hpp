@@ -0,0 +1,44 @@
+/**
+ * @file check.hpp
+ * @author Scott Fasone
+ *
+ * Minimal assertions for the i2cpp tests. Each test is a program registered with CTest, run against
+ * i2cpp::SimulatedBus so it needs no hardware, and fails if any check failed.
+ */
+
+#ifndef I2CPP_TESTS_CHECK_HPP
+#define I2CPP_TESTS_CHECK_HPP
+
+#include <atomic>
+#include <cstdio>
+
+namespace check
+{
+    /** Number of failed checks, from any thread */
+    static std::atomic<int> failures(0);
+
+    /** Record a check, reporting it if it failed */
+    inline bool expect(bool passed, const char* expression, const char* file, int line)
+    {
+        if(!passed) {
+            failures++;
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        }
+        return passed;
+    }
+
+    /** @returns The test program's exit status */
+    inline int result()
+    {
+        if(failures.load() > 0) {
+            std::fprintf(stderr, "%d check(s) failed\n", failures.load());
+            return 1;
+        }
+        return 0;
+    }
+}
+
+/** Check a condition, continuing the test either way */
+#define CHECK(condition) check::expect((condition), #condition, __FILE__, __LINE__)
+
+#endif //I2CPP_TESTS_CHECK_HPP
@@ -0,0 +1,132 @@
+/**
+ * @file concurrency.cpp
+ * @author Scott Fasone
+ *
+ * Threads sharing one adapter must each reach their own device, since selecting the address and the
+ * following transaction are atomic per adapter. Threads on separate adapters must not wait for each
+ * other, so realtime buses used in parallel take about as long as one of them.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/simulated_bus.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    const int threads = 8;
+    const int iterations = 2000;
+
+    /** Distinct input levels for each expander */
+    uint_fast16_t pattern(int device) { return (0x1357 * (device + 1)) & 0xffff; }
+
+    /** Run a function on one thread per device, and wait for them all */
+    template<typename F>
+    void parallel(int count, F function)
+    {
+        std::vector<std::thread> workers;
+        for(int i = 0; i < count; i++) {
+            workers.emplace_back(function, i);
+        }
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void shared_bus()
+    {
+        SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+        std::vector<SimulatedPCA9555::SharedPtr> boards;
+        for(int i = 0; i < threads; i++)
+        {
+            boards.push_back(std::make_shared<SimulatedPCA9555>());
+            boards[i]->set_pins(pattern(i));
+            bus->attach(0x20 + i, boards[i]);
+        }
+        CHECK(I2CPP::attach_adapter("test-shared", bus) >= 0);
+
+        std::atomic<int> wrong_inputs(0);
+        std::atomic<int> wrong_outputs(0);
+        parallel(threads, [&](int index) {
+            PCA9555 device("test-shared", uint_fast8_t(0x20 + index));
+            for(int i = 0; i < iterations; i++) {
+                if(device.read_input() != pattern(index)) {
+                    wrong_inputs++;
+                }
+            }
+
+            // Outputs read back through the input port, so each write must land on this thread's board
+            device.write_config(0x0000);
+            for(int i = 0; i < iterations; i++)
+            {
+                uint_fast16_t value = (pattern(index) + i * 31) & 0xffff;
+                device.write_output(value);
+                if(device.read_input() != value) {
+                    wrong_outputs++;
+                }
+            }
+        });
+        CHECK(wrong_inputs.load() == 0);
+        CHECK(wrong_outputs.load() == 0);
+        for(int i = 0; i < threads; i++) {
+            CHECK(boards[i]->get_output() == ((pattern(i) + (iterations - 1) * 31) & 0xffff));
+        }
+    }
+
+    /** Time reading one expander per thread a number of times, with each expander on its adapter of the given name */
+    double time_reads(const std::vector<std::string>& adapters, int reads)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        parallel(int(adapters.size()), [&](int index) {
+            PCA9555 device(adapters[index], uint_fast8_t(0x20 + index));
+            for(int i = 0; i < reads; i++) {
+                device.read_input();
+            }
+        });
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void separate_buses()
+    {
+        const int buses = 4;
+        const int reads = 50;
+
+        SimulatedBus::SharedPtr shared = std::make_shared<SimulatedBus>();
+        shared->set_clock(100000, true);
+        std::vector<std::string> shared_names;
+        std::vector<std::string> separate_names;
+        for(int i = 0; i < buses; i++)
+        {
+            shared->attach(0x20 + i, std::make_shared<SimulatedPCA9555>());
+            shared_names.push_back("test-timed");
+
+            SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+            bus->set_clock(100000, true);
+            bus->attach(0x20 + i, std::make_shared<SimulatedPCA9555>());
+            separate_names.push_back("test-timed-" + std::to_string(i));
+            CHECK(I2CPP::attach_adapter(separate_names[i], bus) >= 0);
+        }
+        CHECK(I2CPP::attach_adapter("test-timed", shared) >= 0);
+
+        double serialized = time_reads(shared_names, reads);
+        double parallel = time_reads(separate_names, reads);
+        std::printf("%d threads x %d reads: %.1f ms on one bus, %.1f ms on %d buses\n", buses, reads, serialized, parallel, buses);
+        CHECK(parallel < serialized * 0.6);
+    }
+}
+
+int main()
+{
+    shared_bus();
+    separate_buses();
+    return check::result();
+}
@@ -0,0 +1,61 @@
+/**
+ * @file unscheduled.cpp
+ * @author Scott Fasone
+ *
+ * Coroutines awaiting outside a Scheduler's worker threads must still complete: yield() continues at
+ * once, sleeps block the thread, and bus operations resume the task on the adapter's Executor thread.
+ */
+
+#include <chrono>
+#include <coroutine>
+#include <future>
+#include <memory>
+
+#include "check.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/simulated_bus.hpp"
+#include "i2cpp/coro/device.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** Coroutine which starts at once and frees itself when done, with no Scheduler involved */
+    struct Eager
+    {
+        struct promise_type
+        {
+            Eager get_return_object() noexcept { return Eager{}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {  }
+            void unhandled_exception() noexcept {  }
+        };
+    };
+
+    Eager poll(coro::AsyncPCA9555 device, std::promise<uint_fast16_t>& done)
+    {
+        co_await coro::yield();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        co_await coro::sleep_for(std::chrono::milliseconds(2));
+        CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(2));
+        uint_fast16_t input = co_await device.read_input();
+        done.set_value(input);
+    }
+}
+
+int main()
+{
+    SimulatedPCA9555::SharedPtr board = std::make_shared<SimulatedPCA9555>();
+    board->set_pins(0x5a5a);
+    SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+    bus->attach(0x20, board);
+    CHECK(I2CPP::attach_adapter("test-unscheduled", bus) >= 0);
+
+    std::promise<uint_fast16_t> done;
+    std::future<uint_fast16_t> input = done.get_future();
+    poll(coro::AsyncPCA9555(std::make_shared<PCA9555>("test-unscheduled", 0x20)), done);
+    CHECK(input.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    CHECK(input.get() == 0x5a5a);
+    return check::result();
+}
@@ -0,0 +1,161 @@
+/**
+ * @file debouncer.cpp
+ * @author Scott Fasone
+ *
+ * Debouncer vertical counters driven through update() and process(): edges after exactly the
+ * configured number of disagreeing sweeps, bounces restarting the count, the 1 and MAX_SAMPLES
+ * extremes, expanders in several lanes, and expanders which could not be read when added.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/debouncer.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/simulated_bus.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    const int expanders = 6;
+
+    /** A callback's report */
+    struct Edge
+    {
+        uint_fast8_t address;
+        uint_fast16_t state;
+        uint_fast16_t rising;
+        uint_fast16_t falling;
+    };
+
+    SimulatedBus::SharedPtr bus;
+    std::vector<SimulatedPCA9555::SharedPtr> boards;
+
+    /** A debouncer over every board, recording its callbacks */
+    void fill(Debouncer& debouncer, std::vector<Edge>& edges)
+    {
+        for(int i = 0; i < expanders; i++)
+        {
+            debouncer.add(std::make_shared<PCA9555>("test-debouncer", uint_fast8_t(0x20 + i)),
+                [&edges](PCA9555& device, uint_fast16_t state, uint_fast16_t rising, uint_fast16_t falling) {
+                    edges.push_back(Edge{ device.get_address(), state, rising, falling });
+                });
+        }
+    }
+
+    /** Stage an input word for one expander, every other expander repeating its state, and process them */
+    std::size_t sweep(Debouncer& debouncer, std::size_t index, uint_fast16_t input)
+    {
+        for(std::size_t i = 0; i < debouncer.size(); i++) {
+            debouncer.update(i, i == index ? input : debouncer.get_state(i));
+        }
+        return debouncer.process();
+    }
+
+    /** Sweeps disagreeing with the debounced state until the state changes, up to a limit */
+    unsigned sweeps_to_edge(Debouncer& debouncer, std::size_t index, uint_fast16_t input, unsigned limit)
+    {
+        for(unsigned i = 1; i <= limit; i++) {
+            if(sweep(debouncer, index, input) != 0) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    void counting()
+    {
+        std::vector<Edge> edges;
+        Debouncer debouncer(3);
+        fill(debouncer, edges);
+        CHECK(debouncer.size() == std::size_t(expanders));
+        CHECK(debouncer.get_state(1) == 0x0101);
+
+        // Rising on the fifth expander, in the second lane
+        CHECK(sweeps_to_edge(debouncer, 4, 0x0504, 10) == 3);
+        CHECK(edges.size() == 1);
+        CHECK(edges[0].address == 0x24 && edges[0].state == 0x0504 && edges[0].rising == 0x0100 && edges[0].falling == 0);
+        CHECK(debouncer.get_state(4) == 0x0504);
+
+        // A bounce back restarts the count
+        edges.clear();
+        CHECK(sweep(debouncer, 1, 0x0100) == 0);
+        CHECK(sweep(debouncer, 1, 0x0100) == 0);
+        CHECK(sweep(debouncer, 1, 0x0101) == 0);
+        CHECK(sweeps_to_edge(debouncer, 1, 0x0100, 10) == 3);
+        CHECK(edges.size() == 1 && edges[0].address == 0x21 && edges[0].falling == 0x0001 && edges[0].rising == 0);
+
+        // Pins changing on different sweeps are each counted on their own
+        edges.clear();
+        CHECK(sweep(debouncer, 0, 0x8000) == 0);
+        CHECK(sweep(debouncer, 0, 0x8001) == 0);
+        CHECK(sweep(debouncer, 0, 0x8001) == 1);
+        CHECK(edges.size() == 1 && edges[0].rising == 0x8000);
+        CHECK(sweep(debouncer, 0, 0x8001) == 1);
+        CHECK(edges.size() == 2 && edges[1].rising == 0x0001 && edges[1].state == 0x8001);
+    }
+
+    void extremes()
+    {
+        std::vector<Edge> edges;
+        Debouncer immediate(1);
+        fill(immediate, edges);
+        CHECK(sweeps_to_edge(immediate, 2, 0xffff, 10) == 1);
+        CHECK(sweeps_to_edge(immediate, 2, 0x0000, 10) == 1);
+
+        Debouncer slowest(Debouncer::MAX_SAMPLES);
+        fill(slowest, edges);
+        CHECK(sweeps_to_edge(slowest, 5, 0x00ff, 20) == Debouncer::MAX_SAMPLES);
+
+        // Out of range sample counts are clamped
+        Debouncer clamped(100);
+        fill(clamped, edges);
+        CHECK(sweeps_to_edge(clamped, 3, 0x1234, 20) == Debouncer::MAX_SAMPLES);
+    }
+
+    /** An expander unreadable when added takes its first input word as its state, with no edges */
+    void unknown_state()
+    {
+        std::vector<Edge> edges;
+        bus->set_nack(0x22, true);
+        Debouncer debouncer(2);
+        fill(debouncer, edges);
+        bus->set_nack(0x22, false);
+        CHECK(debouncer.get_state(2) == 0);
+
+        debouncer.update(2, 0xffff);
+        CHECK(debouncer.process() == 0);
+        CHECK(debouncer.get_state(2) == 0xffff);
+        CHECK(sweep(debouncer, 2, 0xffff) == 0);
+        CHECK(edges.empty());
+
+        // A later read failure in sweep() keeps the previous input word
+        bus->set_nack(0x22, true);
+        boards[2]->set_pins(0x0000);
+        debouncer.sweep();
+        debouncer.sweep();
+        CHECK(debouncer.get_state(2) == 0xffff);
+        CHECK(edges.empty());
+        bus->set_nack(0x22, false);
+        boards[2]->set_pins(0x0202);
+    }
+}
+
+int main()
+{
+    bus = std::make_shared<SimulatedBus>();
+    for(int i = 0; i < expanders; i++)
+    {
+        boards.push_back(std::make_shared<SimulatedPCA9555>());
+        boards[i]->set_pins(uint_fast16_t(0x0101 * i));
+        bus->attach(0x20 + i, boards[i]);
+    }
+    CHECK(I2CPP::attach_adapter("test-debouncer", bus) >= 0);
+
+    counting();
+    extremes();
+    unknown_state();
+    return check::result();
+}
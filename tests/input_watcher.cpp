@@ -0,0 +1,106 @@
+/**
+ * @file input_watcher.cpp
+ * @author Scott Fasone
+ *
+ * InputWatcher edges from a simulated expander signalling an eventfd, expanders which cannot be read,
+ * and callbacks watching more expanders on the line they were called for.
+ */
+
+#include <memory>
+#include <vector>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "check.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/input_watcher.hpp"
+#include "i2cpp/simulated_bus.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** A notification received by a callback */
+    struct Edge
+    {
+        uint_fast8_t address;
+        uint_fast16_t state;
+        uint_fast16_t changed;
+    };
+
+    void signal(int line)
+    {
+        uint64_t one = 1;
+        ssize_t written = write(line, &one, sizeof(one));
+        (void)written;
+    }
+
+    void watch_line()
+    {
+        SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+        SimulatedPCA9555::SharedPtr first = std::make_shared<SimulatedPCA9555>();
+        SimulatedPCA9555::SharedPtr second = std::make_shared<SimulatedPCA9555>();
+        bus->attach(0x20, first);
+        bus->attach(0x21, second);
+        CHECK(I2CPP::attach_adapter("test-watcher", bus) >= 0);
+        int line = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        first->set_pins(0x00f0);
+        second->set_pins(0x0f00);
+        first->set_interrupt_fd(line);
+        second->set_interrupt_fd(line);
+
+        std::vector<Edge> edges;
+        InputWatcher watcher;
+        InputWatcher::Callback record = [&edges](PCA9555& device, uint_fast16_t state, uint_fast16_t changed) {
+            edges.push_back(Edge{ device.get_address(), state, changed });
+        };
+        CHECK(watcher.watch(line, std::make_shared<PCA9555>("test-watcher", 0x20), record));
+
+        first->set_pins(0x00f1);
+        CHECK(watcher.poll(1000) == 1);
+        CHECK(edges.size() == 1 && edges[0].state == 0x00f1 && edges[0].changed == 0x0001);
+
+        // A read failure is no edge, neither when it happens nor once the expander answers again
+        edges.clear();
+        bus->set_nack(0x20, true);
+        signal(line);
+        CHECK(watcher.poll(1000) == 1);
+        bus->set_nack(0x20, false);
+        signal(line);
+        CHECK(watcher.poll(1000) == 1);
+        CHECK(edges.empty());
+        first->set_pins(0x0071);
+        CHECK(watcher.poll(1000) == 1);
+        CHECK(edges.size() == 1 && edges[0].state == 0x0071 && edges[0].changed == 0x0080);
+
+        // An expander unreadable when watched takes its first good read as its state, without an edge,
+        // and a callback can add it to the line it was called for
+        edges.clear();
+        bus->set_nack(0x21, true);
+        bool added = false;
+        CHECK(watcher.watch(line, std::make_shared<PCA9555>("test-watcher", 0x20), [&](PCA9555&, uint_fast16_t, uint_fast16_t) {
+            if(!added) {
+                added = watcher.watch(line, std::make_shared<PCA9555>("test-watcher", 0x21), record);
+            }
+        }));
+        first->set_pins(0x0070);
+        CHECK(watcher.poll(1000) == 1);
+        CHECK(added);
+        CHECK(edges.size() == 1 && edges[0].address == 0x20);
+        bus->set_nack(0x21, false);
+        signal(line);
+        CHECK(watcher.poll(1000) == 1);
+        CHECK(edges.size() == 1);
+        second->set_pins(0x0f01);
+        CHECK(watcher.poll(1000) == 1);
+        CHECK(edges.size() == 2 && edges[1].address == 0x21 && edges[1].state == 0x0f01 && edges[1].changed == 0x0001);
+
+        close(line);
+    }
+}
+
+int main()
+{
+    watch_line();
+    return check::result();
+}
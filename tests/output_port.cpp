@@ -0,0 +1,201 @@
+/**
+ * @file output_port.cpp
+ * @author Scott Fasone
+ *
+ * OutputPort pin operations across 64-bit word boundaries, spare bits past the last expander, and
+ * apply() writing only changed expanders, one batched call per bus, retrying failed expanders.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/output_port.hpp"
+#include "i2cpp/simulated_bus.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** Two buses, with their expanders interleaved in the port */
+    struct Rig
+    {
+        SimulatedBus::SharedPtr first;
+        SimulatedBus::SharedPtr second;
+        /** Boards in port order */
+        std::vector<SimulatedPCA9555::SharedPtr> boards;
+        std::vector<PCA9555::SharedPtr> devices;
+
+        Rig()
+        {
+            this->first = std::make_shared<SimulatedBus>();
+            this->second = std::make_shared<SimulatedBus>();
+            CHECK(I2CPP::attach_adapter("test-port-a", this->first) >= 0);
+            CHECK(I2CPP::attach_adapter("test-port-b", this->second) >= 0);
+            // Port expanders 0 to 3 and 5 on the first bus, 4 and 6 on the second
+            const int on_second[7] = { 0, 0, 0, 0, 1, 0, 1 };
+            int next[2] = { 0x20, 0x20 };
+            for(int i = 0; i < 7; i++)
+            {
+                SimulatedBus::SharedPtr bus = on_second[i] ? this->second : this->first;
+                int address = next[on_second[i]]++;
+                this->boards.push_back(std::make_shared<SimulatedPCA9555>());
+                bus->attach(address, this->boards.back());
+                this->devices.push_back(std::make_shared<PCA9555>(on_second[i] ? "test-port-b" : "test-port-a", uint_fast8_t(address)));
+            }
+        }
+
+        void reset()
+        {
+            this->first->reset_statistics();
+            this->second->reset_statistics();
+        }
+    };
+
+    /** A port is read from the boards, and its first apply() writes each bus once */
+    void initial_state(Rig& rig, OutputPort& port)
+    {
+        CHECK(port.size() == 112);
+        CHECK(port.words() == 2);
+        CHECK(port.get(0) && port.get(111));
+        CHECK(!port.get(112));
+        CHECK(port.pending() == 0);
+        // The spare expander slot of the last word stays clear
+        CHECK((port.get_bits()[1] >> 48) == 0);
+
+        port.assign(std::vector<uint64_t>(2, 0));
+        CHECK(port.pending() == 7);
+        rig.reset();
+        CHECK(port.apply());
+        CHECK(port.pending() == 0);
+        CHECK(rig.first->get_statistics().calls == 1);
+        CHECK(rig.first->get_statistics().messages == 5);
+        CHECK(rig.second->get_statistics().calls == 1);
+        CHECK(rig.second->get_statistics().messages == 2);
+        for(const SimulatedPCA9555::SharedPtr& board : rig.boards) {
+            CHECK(board->get_output() == 0x0000);
+        }
+
+        // Nothing changed, nothing written
+        rig.reset();
+        CHECK(port.apply());
+        CHECK(rig.first->get_statistics().calls == 0);
+        CHECK(rig.second->get_statistics().calls == 0);
+    }
+
+    void ranges(Rig& rig, OutputPort& port)
+    {
+        // Pins 60 to 69 span expanders 3 and 4, and the two words
+        port.set_range(60, 70);
+        for(std::size_t pin = 56; pin < 74; pin++) {
+            CHECK(port.get(pin) == (pin >= 60 && pin < 70));
+        }
+        CHECK(port.pending() == 2);
+        rig.reset();
+        CHECK(port.apply());
+        CHECK(rig.boards[3]->get_output() == 0xf000);
+        CHECK(rig.boards[4]->get_output() == 0x003f);
+        CHECK(rig.first->get_statistics().messages == 1);
+        CHECK(rig.second->get_statistics().messages == 1);
+
+        port.set_range(62, 66, false);
+        CHECK(port.get(61) && !port.get(62) && !port.get(65) && port.get(66));
+        port.set_range(100, 200);
+        CHECK(port.get(111) && !port.get(99));
+
+        // 64 pins from pin 40 take their levels from the mask, least significant bit first
+        uint64_t values = 0x0123456789abcdefull;
+        port.assign_range(40, 104, values);
+        for(std::size_t pin = 40; pin < 104; pin++) {
+            CHECK(port.get(pin) == (((values >> (pin - 40)) & 1) != 0));
+        }
+        CHECK(port.get(104) && !port.get(39));
+        // Clamped to the end of the port
+        port.assign_range(100, 164, 0);
+        CHECK(!port.get(111) && (port.get_bits()[1] >> 48) == 0);
+
+        port.set_range(0, 112, false);
+        CHECK(port.get_bits()[0] == 0 && port.get_bits()[1] == 0);
+        CHECK(port.apply());
+    }
+
+    void masks(Rig& rig, OutputPort& port)
+    {
+        // Bits past the last expander are trimmed, so they never count as a change
+        port.set_mask(std::vector<uint64_t>(2, ~uint64_t(0)));
+        CHECK((port.get_bits()[1] >> 48) == 0);
+        CHECK(port.pending() == 7);
+        port.clear_mask(std::vector<uint64_t>{ 0xffffffff0000ffffull, 0 });
+        CHECK(port.pending() == 4);
+        port.assign_mask(std::vector<uint64_t>{ 0, ~uint64_t(0) }, std::vector<uint64_t>{ ~uint64_t(0), ~uint64_t(0) });
+        CHECK((port.get_bits()[1] >> 48) == 0);
+        CHECK(port.apply());
+        CHECK(rig.boards[0]->get_output() == 0x0000);
+        CHECK(rig.boards[2]->get_output() == 0x0000);
+        CHECK(rig.boards[3]->get_output() == 0x0000);
+        CHECK(rig.boards[1]->get_output() == 0xffff);
+        CHECK(rig.boards[6]->get_output() == 0xffff);
+
+        // Changing one pin writes one expander
+        port.clear(17);
+        CHECK(port.pending() == 1);
+        rig.reset();
+        CHECK(port.apply());
+        CHECK(rig.first->get_statistics().messages == 1);
+        CHECK(rig.second->get_statistics().calls == 0);
+        CHECK(rig.boards[1]->get_output() == 0xfffd);
+    }
+
+    /** Expanders which fail keep their pending levels for the next apply(), the rest are written */
+    void retry(Rig& rig, OutputPort& port)
+    {
+        port.assign(std::vector<uint64_t>(2, 0));
+        CHECK(port.apply());
+
+        rig.first->set_nack(0x22, true);
+        port.set(0);
+        port.set(32);
+        port.set(64);
+        CHECK(!port.apply());
+        CHECK(rig.boards[0]->get_output() == 0x0001);
+        CHECK(rig.boards[2]->get_output() == 0x0000);
+        CHECK(rig.boards[4]->get_output() == 0x0001);
+        CHECK(port.pending() == 1);
+
+        rig.first->set_nack(0x22, false);
+        rig.reset();
+        CHECK(port.apply());
+        CHECK(rig.boards[2]->get_output() == 0x0001);
+        CHECK(rig.first->get_statistics().messages == 1);
+        CHECK(rig.second->get_statistics().calls == 0);
+        CHECK(port.pending() == 0);
+
+        // Forgetting the written outputs makes the next apply() write every expander
+        port.invalidate();
+        CHECK(port.pending() == 7);
+        rig.reset();
+        CHECK(port.apply());
+        CHECK(rig.first->get_statistics().messages == 5);
+        CHECK(rig.second->get_statistics().messages == 2);
+
+        // Outputs written behind the port's back are picked up by resync()
+        uint_fast8_t other[2] = { 0x80, 0x00 };
+        CHECK(I2CPP::write_register(rig.devices[5]->get_adapter(), 0x24, PCA9555::Registers::Output::address, other, 2) == 2);
+        CHECK(!port.get(87));
+        CHECK(port.resync());
+        CHECK(port.get(87) && !port.get(80));
+        CHECK(port.pending() == 0);
+    }
+}
+
+int main()
+{
+    Rig rig;
+    OutputPort port(rig.devices);
+    initial_state(rig, port);
+    ranges(rig, port);
+    masks(rig, port);
+    retry(rig, port);
+    return check::result();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file pca9555.cpp
+ * @author Scott Fasone
+ *
+ * PCA9555 shadow registers and deferred updates shared between threads and asynchronous calls, and
+ * read-modify-write pin changes with the read cache enabled.
+ */
+
+#include <memory>
+#include <thread>
+
+#include "check.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/simulated_bus.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    const int iterations = 2000;
+
+    /** Threads changing different pins of one shadowed expander must not lose each other's writes */
+    void shared_shadow(SimulatedPCA9555::SharedPtr board)
+    {
+        PCA9555 device("test-pca9555", 0x20);
+        device.enable_shadow();
+        device.write_output(0x0000);
+
+        std::thread low([&device]() {
+            for(int i = 0; i < iterations; i++) {
+                device.write_output_pin(uint_fast8_t(i % 8), i % 16 < 8);
+            }
+        });
+        for(int i = 0; i < iterations; i++)
+        {
+            device.flip_output_pin(uint_fast8_t(8 + i % 8));
+            // Queued whole-register writes of the value just read must not be lost behind the pin writes either
+            if(i % 100 == 0) {
+                device.write_polarity_async(uint_fast16_t(i)).wait();
+            }
+        }
+        low.join();
+
+        // Low pins end high after each run of 8 sets, high pins are flipped an even number of times
+        uint_fast16_t expected = ((iterations - 1) / 8) % 2 == 0 ? 0x00ff : 0x0000;
+        CHECK(device.read_output() == expected);
+        CHECK(board->get_output() == expected);
+        CHECK(board->get_polarity() == uint_fast16_t(((iterations - 1) / 100) * 100));
+        CHECK(device.read_polarity() == board->get_polarity());
+    }
+
+    /** Asynchronous writes are sent at once during a deferred update, which still commits its own values */
+    void deferred_async(SimulatedPCA9555::SharedPtr board)
+    {
+        PCA9555 device("test-pca9555", 0x20);
+        device.write_output(0x0000);
+
+        device.begin_update();
+        // Staging the value already on the board would normally be skipped by the commit
+        device.write_output_pin(0, false);
+        CHECK(device.write_output_async(0x1230).get());
+        CHECK(board->get_output() == 0x1230);
+        CHECK(device.read_output_async().get() == 0x1230);
+        CHECK(device.read_output() == 0x0000);
+        CHECK(device.commit_update());
+        CHECK(board->get_output() == 0x0000);
+    }
+
+    /** Pin writes read the register from the board, not from a cached read it no longer matches */
+    void cached_pin_writes(SimulatedPCA9555::SharedPtr board)
+    {
+        PCA9555 device("test-pca9555", 0x20);
+        device.set_read_cache(true, 60000000000ull);
+        device.write_output(0x0000);
+        CHECK(device.read_output() == 0x0000);
+
+        // Written behind the device's back, such as by another process, so nothing drops the cached read
+        uint_fast8_t other[2] = { 0xf0, 0x00 };
+        CHECK(I2CPP::write_register(device.get_adapter(), 0x20, PCA9555::Registers::Output::address, other, 2) == 2);
+        CHECK(device.write_output_pin(0, true));
+        CHECK(board->get_output() == 0x00f1);
+        device.set_read_cache(false);
+    }
+}
+
+int main()
+{
+    SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+    SimulatedPCA9555::SharedPtr board = std::make_shared<SimulatedPCA9555>();
+    bus->attach(0x20, board);
+    CHECK(I2CPP::attach_adapter("test-pca9555", bus) >= 0);
+
+    shared_shadow(board);
+    deferred_async(board);
+    cached_pin_writes(board);
+    return check::result();
+}
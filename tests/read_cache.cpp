@@ -0,0 +1,105 @@
+/**
+ * @file read_cache.cpp
+ * @author Scott Fasone
+ *
+ * ReadCache entries of one adapter must be independent of every other adapter's: a write drops only
+ * its own device's results, the counters add up over every adapter, and threads reading devices on
+ * separate adapters through the cache each get their own device's input.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/read_cache.hpp"
+#include "i2cpp/simulated_bus.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    const int adapters = 6;
+    const int iterations = 2000;
+
+    /** An expander alone on an adapter of its own */
+    SimulatedPCA9555::SharedPtr attach_board(const std::string& name, uint_fast16_t pins)
+    {
+        SimulatedPCA9555::SharedPtr board = std::make_shared<SimulatedPCA9555>();
+        board->set_pins(pins);
+        SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+        bus->attach(0x20, board);
+        CHECK(I2CPP::attach_adapter(name, bus) >= 0);
+        return board;
+    }
+
+    void independent_adapters()
+    {
+        SimulatedPCA9555::SharedPtr first_board = attach_board("test-cache-a", 0x1111);
+        SimulatedPCA9555::SharedPtr second_board = attach_board("test-cache-b", 0x2222);
+        PCA9555 first("test-cache-a", 0x20);
+        PCA9555 second("test-cache-b", 0x20);
+        first.set_read_cache(true, 60000000000ull);
+        second.set_read_cache(true, 60000000000ull);
+        ReadCache::reset_statistics();
+
+        CHECK(first.read_input() == 0x1111);
+        CHECK(second.read_input() == 0x2222);
+        first_board->set_pins(0x3333);
+        second_board->set_pins(0x4444);
+        // Both results are still fresh
+        CHECK(first.read_input() == 0x1111);
+        CHECK(second.read_input() == 0x2222);
+
+        // Writing the first device drops its results alone
+        first.write_polarity(0x0000);
+        CHECK(first.read_input() == 0x3333);
+        CHECK(second.read_input() == 0x2222);
+
+        ReadCacheStatistics statistics = ReadCache::get_statistics();
+        CHECK(statistics.misses == 3);
+        CHECK(statistics.hits == 3);
+        CHECK(statistics.invalidations == 1);
+
+        ReadCache::clear();
+        CHECK(second.read_input() == 0x4444);
+    }
+
+    void parallel_adapters()
+    {
+        std::vector<SimulatedPCA9555::SharedPtr> boards;
+        for(int i = 0; i < adapters; i++) {
+            boards.push_back(attach_board("test-cache-" + std::to_string(i), uint_fast16_t(0x0101 * (i + 1))));
+        }
+
+        std::atomic<int> wrong(0);
+        std::vector<std::thread> workers;
+        for(int i = 0; i < adapters; i++)
+        {
+            workers.emplace_back([&wrong, i]() {
+                PCA9555 device("test-cache-" + std::to_string(i), 0x20);
+                device.set_read_cache(true, 0);
+                for(int j = 0; j < iterations; j++) {
+                    if(device.read_input() != uint_fast16_t(0x0101 * (i + 1))) {
+                        wrong++;
+                    }
+                }
+            });
+        }
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+        CHECK(wrong.load() == 0);
+    }
+}
+
+int main()
+{
+    independent_adapters();
+    parallel_adapters();
+    return check::result();
+}
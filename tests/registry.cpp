@@ -0,0 +1,52 @@
+/**
+ * @file registry.cpp
+ * @author Scott Fasone
+ *
+ * Registers written by a DeviceRegistry, in its batched configure() pass or through an Expander
+ * handle, must drop the devices' results from the ReadCache, so cached readers see the new values.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/i2cpp.hpp"
+#include "i2cpp/read_cache.hpp"
+#include "i2cpp/registry.hpp"
+#include "i2cpp/simulated_bus.hpp"
+#include "i2cpp/devices/pca9555.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    void invalidates_cache()
+    {
+        SimulatedPCA9555::SharedPtr board = std::make_shared<SimulatedPCA9555>();
+        board->set_pins(0x00f0);
+        SimulatedBus::SharedPtr bus = std::make_shared<SimulatedBus>();
+        bus->attach(0x20, board);
+        CHECK(I2CPP::attach_adapter("test-registry", bus) >= 0);
+
+        PCA9555 reader("test-registry", 0x20);
+        reader.set_read_cache(true, 60000000000ull);
+        CHECK(reader.read_input() == 0x00f0);
+
+        // Inverting every input changes what the input register reads
+        DeviceSpec spec(DeviceType::PCA9555, "test-registry", 0x20);
+        spec.polarity = 0xffff;
+        DeviceRegistry registry;
+        CHECK(registry.build(std::vector<DeviceSpec>(1, spec)));
+        CHECK(board->get_polarity() == 0xffff);
+        CHECK(reader.read_input() == 0xff0f);
+
+        CHECK(registry.expander(0).write_polarity(0x0000));
+        CHECK(reader.read_input() == 0x00f0);
+    }
+}
+
+int main()
+{
+    invalidates_cache();
+    return check::result();
+}
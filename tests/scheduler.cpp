@@ -0,0 +1,92 @@
+/**
+ * @file scheduler.cpp
+ * @author Scott Fasone
+ *
+ * Scheduler runs each task once per period, skips and counts the periods an overrunning task misses,
+ * and stops without waiting out its threads' sleeps.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "check.hpp"
+#include "i2cpp/scheduler.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    using Milliseconds = std::chrono::milliseconds;
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /** A 10ms task runs about once per period, and a task on another adapter runs alongside it */
+    void deadlines()
+    {
+        std::atomic<int> fast(0);
+        std::atomic<int> slow(0);
+        Scheduler scheduler;
+        int fast_task = scheduler.add_task(1000, Milliseconds(10), [&fast]() { fast++; });
+        int slow_task = scheduler.add_task(1001, Milliseconds(40), [&slow]() { slow++; });
+        CHECK(scheduler.start());
+        CHECK(!scheduler.start());
+        CHECK(scheduler.add_task(1000, Milliseconds(10), []() {  }) == -1);
+        std::this_thread::sleep_for(Milliseconds(205));
+        scheduler.stop();
+
+        // Runs at 0, 10, ... 200ms, and 0, 40, ... 200ms
+        CHECK(fast.load() >= 18 && fast.load() <= 21);
+        CHECK(slow.load() >= 5 && slow.load() <= 6);
+        Scheduler::Statistics statistics = scheduler.get_statistics(fast_task);
+        CHECK(statistics.runs == uint64_t(fast.load()));
+        CHECK(scheduler.get_statistics(slow_task).runs == uint64_t(slow.load()));
+        CHECK(scheduler.get_statistics(7).runs == 0);
+    }
+
+    /** A run outlasting two more deadlines counts both as overruns, which are skipped rather than run late */
+    void overruns()
+    {
+        std::atomic<int> runs(0);
+        Scheduler scheduler;
+        int task = scheduler.add_task(1002, Milliseconds(20), [&runs]() {
+            if(runs++ == 0) {
+                std::this_thread::sleep_for(Milliseconds(50));
+            }
+        });
+        CHECK(scheduler.start());
+        // The first run ends at 50ms, the next runs at 60, 80 and 100ms
+        std::this_thread::sleep_for(Milliseconds(110));
+        scheduler.stop();
+
+        Scheduler::Statistics statistics = scheduler.get_statistics(task);
+        CHECK(statistics.overruns == 2);
+        CHECK(runs.load() == 4);
+        CHECK(statistics.runs == 4);
+    }
+
+    /** Stopping wakes threads sleeping until a far deadline */
+    void prompt_stop()
+    {
+        std::atomic<int> runs(0);
+        Scheduler scheduler;
+        scheduler.add_task(1003, std::chrono::seconds(30), [&runs]() { runs++; });
+        CHECK(scheduler.start());
+        std::this_thread::sleep_for(Milliseconds(20));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        scheduler.stop();
+        CHECK(elapsed_ms(start) < 1000);
+        CHECK(runs.load() == 1);
+    }
+}
+
+int main()
+{
+    deadlines();
+    overruns();
+    prompt_stop();
+    return check::result();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file simulated_bus.cpp
+ * @author Scott Fasone
+ *
+ * SimulatedBus timing model, NACKs, and realtime buses overlapping in time.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "i2cpp/simulated_bus.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** Register read of a PCA9555 input port: 1 byte written, 2 bytes read, 48 clocks in all */
+    int read_input(SimulatedBus& bus, int address)
+    {
+        uint_fast8_t command = 0x00;
+        uint_fast8_t data[2] = { 0, 0 };
+        Message messages[2] = {
+            { uint_fast8_t(address), false, &command, 1, 0 },
+            { uint_fast8_t(address), true, data, 2, 0 }
+        };
+        return bus.transfer(messages, 2);
+    }
+
+    void timing_model()
+    {
+        SimulatedBus bus;
+        bus.set_clock(100000);
+        bus.attach(0x20, std::make_shared<SimulatedPCA9555>());
+
+        CHECK(read_input(bus, 0x20) == 2);
+        SimulatedBus::Statistics statistics = bus.get_statistics();
+        CHECK(statistics.calls == 1);
+        CHECK(statistics.messages == 2);
+        CHECK(statistics.bytes == 5);
+        CHECK(statistics.nacks == 0);
+        CHECK(statistics.bus_time == 480000);
+
+        bus.reset_statistics();
+        CHECK(read_input(bus, 0x21) < 0 && errno == ENXIO);
+        bus.set_nack(0x20, true);
+        CHECK(read_input(bus, 0x20) < 0 && errno == ENXIO);
+        bus.set_nack(0x20, false);
+        CHECK(read_input(bus, 0x20) == 2);
+        CHECK(bus.get_statistics().nacks == 2);
+    }
+
+    /** Realtime buses sleep out their bus time, so buses used from separate threads overlap */
+    void realtime_overlap()
+    {
+        const int buses = 4;
+        const int reads = 20;
+        const double read_time = 0.48;
+
+        std::vector<SimulatedBus::SharedPtr> simulated;
+        for(int i = 0; i < buses; i++)
+        {
+            simulated.push_back(std::make_shared<SimulatedBus>());
+            simulated[i]->set_clock(100000, true);
+            simulated[i]->attach(0x20, std::make_shared<SimulatedPCA9555>());
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for(int i = 0; i < buses; i++)
+        {
+            workers.emplace_back([&simulated, i]() {
+                for(int j = 0; j < reads; j++) {
+                    read_input(*simulated[i], 0x20);
+                }
+            });
+        }
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("%d buses x %d reads of %.2f ms: %.1f ms\n", buses, reads, read_time, elapsed);
+        CHECK(elapsed >= reads * read_time);
+        CHECK(elapsed < buses * reads * read_time * 0.6);
+    }
+}
+
+int main()
+{
+    timing_model();
+    realtime_overlap();
+    return check::result();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file i2cpp_broker.cpp
+ * @author Scott Fasone
+ *
+ * Daemon owning I2C adapters on behalf of every process using them. Each adapter is served by an
+ * i2cpp::Broker on its own thread, and client processes attach an i2cpp::BrokerTransport in its place.
+ * Runs until interrupted or terminated, then prints each adapter's counters.
+ *
+ * Usage: i2cpp_broker ADAPTER...
+ * where each ADAPTER is a bus number, such as 1 for /dev/i2c-1, or the path of an i2c-dev device file.
+ */
+
+#include <cctype>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include "i2cpp/broker.hpp"
+
+using namespace i2cpp;
+
+namespace
+{
+    /** Device file of a command line adapter */
+    std::string adapter_path(const std::string& argument)
+    {
+        for(char c : argument) {
+            if(!std::isdigit(static_cast<unsigned char>(c))) {
+                return argument;
+            }
+        }
+        return "/dev/i2c-" + argument;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        std::fprintf(stderr, "Usage: %s ADAPTER...\n", argv[0]);
+        return 2;
+    }
+
+    // Block the stop signals before any thread starts, so only sigwait() below receives them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::vector<std::string> paths;
+    std::vector<std::unique_ptr<Broker>> brokers;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string path = adapter_path(argv[i]);
+        std::unique_ptr<Broker> broker(new Broker(path));
+        if(!broker->start()) {
+            std::fprintf(stderr, "%s: cannot serve %s, it cannot be opened or another broker serves it\n", argv[0], path.c_str());
+            return 1;
+        }
+        std::fprintf(stderr, "%s: serving %s as %s\n", argv[0], path.c_str(), Broker::segment_name(path).c_str());
+        paths.push_back(path);
+        brokers.push_back(std::move(broker));
+    }
+
+    int received = 0;
+    sigwait(&signals, &received);
+
+    for(std::size_t i = 0; i < brokers.size(); i++)
+    {
+        brokers[i]->stop();
+        BrokerStatistics statistics = brokers[i]->get_statistics();
+        std::fprintf(stderr, "%s: %" PRIu64 " requests, %" PRIu64 " calls, %" PRIu64 " batched, %" PRIu64 " reaped\n",
+                     paths[i].c_str(), statistics.requests, statistics.calls, statistics.batched, statistics.reaped);
+    }
+    return 0;
+}